@@ -0,0 +1,683 @@
+//Нагрузочные тесты поискового сервера. Отдельная программа, собирается вместе с исходниками сервера без main.cpp:
+//  g++ -std=c++17 -O2 benchmark/benchmark.cpp $(ls *.cpp | grep -v '^main.cpp$') -ltbb -lpthread -o search_benchmark
+//Запуск: search_benchmark [--documents N] [--dictionary N] [--queries N] [--document-words N] [--query-words N]
+//  [--zipf S] [--minus-prob P] [--warmup N] [--repetitions N] [--seed N] [--scenarios a,b,...] [--output FILE]
+//  [--huge-pages off|transparent|explicit] [--perf 0|1]
+//Результат - JSON с конфигурацией и по каждому сценарию числом замеров, перцентилями задержки в микросекундах,
+//пропускной способностью и контрольной суммой результатов (она должна совпадать между сборками).
+//С --perf 1 к сценарию добавляются промахи TLB данных и кэша на операцию и их доли, если счетчики доступны;
+//сравнение --huge-pages off и transparent на большом корпусе показывает выигрыш от больших страниц.
+//--zipf 0 с остальными параметрами по умолчанию дает корпус прежнего Bench() из main.cpp
+#include "../corpus_loader.h"
+#include "../durable_search_server.h"
+#include "../frozen_search_server.h"
+#include "../process_queries.h"
+#include "../remove_duplicates.h"
+#include "../search_server.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct BenchmarkConfig {
+	int documents = 10'000;
+	int dictionary = 1000;
+	int queries = 100;
+	int document_words = 70;
+	int query_words = 70;
+	int max_word_length = 10;
+	double zipf = 1.0;
+	double minus_prob = 0;
+	int warmup = 1;
+	int repetitions = 5;
+	unsigned seed = mt19937::default_seed;
+	//большие страницы для массивов индекса: off, transparent или explicit
+	HugePageMode huge_pages = HugePageMode::OFF;
+	//счетчики промахов TLB и кэша на замеряемых операциях (perf_event_open), если доступны
+	bool perf_counters = false;
+	vector<string> scenarios = { "ingest"s, "ingest_wal"s, "load_corpus"s, "remove"s, "find_seq"s, "find_par"s, "find_adaptive"s, "find_page"s,
+		"find_required"s, "find_frozen"s,
+		"match"s, "process_queries"s, "remove_duplicates"s };
+	string output;
+};
+
+//Номер слова словаря: равномерно (s = 0) или по закону Ципфа с показателем s
+class WordSampler {
+public:
+	WordSampler(size_t word_count, double s)
+		: uniform_(0, static_cast<int>(word_count) - 1) {
+		if (s <= 0) {
+			return;
+		}
+		cumulative_.reserve(word_count);
+		double sum = 0;
+		for (size_t rank = 1; rank <= word_count; ++rank) {
+			sum += 1.0 / pow(static_cast<double>(rank), s);
+			cumulative_.push_back(sum);
+		}
+		for (double& value : cumulative_) {
+			value /= sum;
+		}
+	}
+
+	size_t operator()(mt19937& generator) {
+		if (cumulative_.empty()) {
+			return uniform_(generator);
+		}
+		const double value = uniform_real_distribution<>(0, 1)(generator);
+		const size_t index = upper_bound(cumulative_.begin(), cumulative_.end(), value) - cumulative_.begin();
+		return min(index, cumulative_.size() - 1);
+	}
+
+private:
+	uniform_int_distribution<int> uniform_;
+	vector<double> cumulative_;
+};
+
+string GenerateWord(mt19937& generator, int max_length) {
+	const int length = uniform_int_distribution<int>(1, max_length)(generator);
+	string word;
+	word.reserve(length);
+	for (int i = 0; i < length; ++i) {
+		word.push_back(uniform_int_distribution<int>('a', 'z')(generator));
+	}
+	return word;
+}
+
+vector<string> GenerateDictionary(mt19937& generator, int word_count, int max_length) {
+	vector<string> words;
+	words.reserve(word_count);
+	for (int i = 0; i < word_count; ++i) {
+		words.push_back(GenerateWord(generator, max_length));
+	}
+	words.erase(unique(words.begin(), words.end()), words.end());
+	return words;
+}
+
+string GenerateQuery(mt19937& generator, const vector<string>& dictionary, WordSampler& sampler,
+	int word_count, double minus_prob) {
+	string query;
+	for (int i = 0; i < word_count; ++i) {
+		if (!query.empty()) {
+			query.push_back(' ');
+		}
+		if (uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+			query.push_back('-');
+		}
+		query += dictionary[sampler(generator)];
+	}
+	return query;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, WordSampler& sampler,
+	int query_count, int word_count, double minus_prob) {
+	vector<string> queries;
+	queries.reserve(query_count);
+	for (int i = 0; i < query_count; ++i) {
+		queries.push_back(GenerateQuery(generator, dictionary, sampler, word_count, minus_prob));
+	}
+	return queries;
+}
+
+struct Corpus {
+	vector<string> dictionary;
+	vector<string> documents;
+	vector<string> queries;
+};
+
+Corpus GenerateCorpus(const BenchmarkConfig& config) {
+	mt19937 generator(config.seed);
+	Corpus corpus;
+	corpus.dictionary = GenerateDictionary(generator, config.dictionary, config.max_word_length);
+	WordSampler sampler(corpus.dictionary.size(), config.zipf);
+	corpus.documents = GenerateQueries(generator, corpus.dictionary, sampler, config.documents, config.document_words, 0);
+	corpus.queries = GenerateQueries(generator, corpus.dictionary, sampler, config.queries, config.query_words,
+		config.minus_prob);
+	return corpus;
+}
+
+//Первое (самое частое при законе Ципфа) слово словаря - стоп-слово, как в прежнем Bench()
+SearchServer BuildServer(const Corpus& corpus) {
+	SearchServer search_server(corpus.dictionary[0]);
+	//обязательные слова сценария find_required; слова корпуса - строчные буквы, операторами не бывают
+	search_server.SetBooleanQueriesEnabled(true);
+	for (size_t i = 0; i < corpus.documents.size(); ++i) {
+		search_server.AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+	}
+	return search_server;
+}
+
+//Аппаратные счетчики процесса на время замеров: одна группа perf_event_open, включаемая и выключаемая
+//вокруг каждой замеряемой операции (вне замера времени). Счетчики, которых нет (виртуальная машина
+//без PMU, kernel.perf_event_paranoid), пропускаются
+class PerfCounters {
+public:
+	enum Event { DTLB_LOADS, DTLB_LOAD_MISSES, CACHE_REFERENCES, CACHE_MISSES, EVENT_COUNT };
+
+	PerfCounters() {
+		const uint64_t dtlb = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8);
+		const pair<uint32_t, uint64_t> events[EVENT_COUNT] = {
+			{ PERF_TYPE_HW_CACHE, dtlb | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16) },
+			{ PERF_TYPE_HW_CACHE, dtlb | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		};
+		for (int event = 0; event < EVENT_COUNT; ++event) {
+			perf_event_attr attr{};
+			attr.size = sizeof(attr);
+			attr.type = events[event].first;
+			attr.config = events[event].second;
+			attr.disabled = leader_ < 0;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			files_[event] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+			if (files_[event] < 0 && error_.empty()) {
+				error_ = strerror(errno);
+			}
+			if (leader_ < 0) {
+				leader_ = files_[event];
+			}
+		}
+	}
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	~PerfCounters() {
+		for (const int file : files_) {
+			if (file >= 0) {
+				close(file);
+			}
+		}
+	}
+
+	bool IsAvailable() const {
+		return leader_ >= 0;
+	}
+
+	//причина, по которой не открылся первый недоступный счетчик
+	const string& GetError() const {
+		return error_;
+	}
+
+	void Enable() {
+		if (leader_ >= 0) {
+			ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+	}
+
+	void Disable() {
+		if (leader_ >= 0) {
+			ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		}
+	}
+
+	//значение счетчика с начала работы; nullopt - счетчик недоступен
+	optional<uint64_t> Read(Event event) const {
+		uint64_t value = 0;
+		if (files_[event] < 0 || read(files_[event], &value, sizeof(value)) != sizeof(value)) {
+			return nullopt;
+		}
+		return value;
+	}
+
+private:
+	int files_[EVENT_COUNT] = { -1, -1, -1, -1 };
+	int leader_ = -1;
+	string error_;
+};
+
+//Замеры одного прогона сценария в наносекундах
+class Recorder {
+public:
+	explicit Recorder(PerfCounters* counters = nullptr)
+		: counters_(counters) {
+	}
+
+	template<typename Function>
+	void Measure(Function function) {
+		if (counters_ != nullptr) {
+			counters_->Enable();
+		}
+		const auto start = chrono::steady_clock::now();
+		function();
+		samples_.push_back(static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now() - start).count()));
+		if (counters_ != nullptr) {
+			counters_->Disable();
+		}
+	}
+
+	vector<double>& GetSamples() {
+		return samples_;
+	}
+
+private:
+	PerfCounters* counters_;
+	vector<double> samples_;
+};
+
+//Сценарий: один прогон с замерами; возвращает контрольную сумму результатов
+using Scenario = function<double(const Corpus&, Recorder&)>;
+
+double RunIngest(const Corpus& corpus, Recorder& recorder) {
+	SearchServer search_server(corpus.dictionary[0]);
+	for (size_t i = 0; i < corpus.documents.size(); ++i) {
+		recorder.Measure([&]() {
+			search_server.AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+		});
+	}
+	return static_cast<double>(search_server.GetDocumentCount());
+}
+
+//Добавление с журналом изменений во временном каталоге (fsync групп по умолчанию)
+double RunIngestWal(const Corpus& corpus, Recorder& recorder) {
+	char directory_template[] = "/tmp/search_benchmark_XXXXXX";
+	const string directory = mkdtemp(directory_template);
+	size_t document_count = 0;
+	{
+		DurableSearchServer search_server(directory, SearchServer(corpus.dictionary[0]));
+		for (size_t i = 0; i < corpus.documents.size(); ++i) {
+			recorder.Measure([&]() {
+				search_server.AddDocument(static_cast<int>(i), corpus.documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+			});
+		}
+		recorder.Measure([&]() { search_server.Sync(); });
+		document_count = search_server.GetServer().GetDocumentCount();
+	}
+	filesystem::remove_all(directory);
+	return static_cast<double>(document_count);
+}
+
+//Загрузка того же корпуса из TSV конвейером LoadCorpus, один замер на весь корпус
+double RunLoadCorpus(const Corpus& corpus, Recorder& recorder) {
+	string text;
+	for (size_t i = 0; i < corpus.documents.size(); ++i) {
+		text += to_string(i) + "\tACTUAL\t1 2 3\t"s + corpus.documents[i] + "\n"s;
+	}
+	SearchServer search_server(corpus.dictionary[0]);
+	istringstream input(text);
+	CorpusLoadStats stats;
+	recorder.Measure([&]() { stats = LoadCorpus(search_server, input, CorpusFormat::TSV); });
+	return static_cast<double>(stats.documents);
+}
+
+double RunRemove(const Corpus& corpus, Recorder& recorder) {
+	SearchServer search_server = BuildServer(corpus);
+	for (size_t i = 0; i < corpus.documents.size(); i += 10) {
+		recorder.Measure([&]() { search_server.RemoveDocument(static_cast<int>(i)); });
+	}
+	return static_cast<double>(search_server.GetDocumentCount());
+}
+
+template<typename ExecutionPolicy>
+double RunFind(const SearchServer& search_server, const Corpus& corpus, Recorder& recorder, ExecutionPolicy policy) {
+	double total_relevance = 0;
+	for (const string& query : corpus.queries) {
+		recorder.Measure([&]() {
+			for (const Document& document : search_server.FindTopDocuments(policy, query)) {
+				total_relevance += document.relevance;
+			}
+		});
+	}
+	return total_relevance;
+}
+
+//те же запросы по замороженному индексу; контрольная сумма совпадает с find_seq
+double RunFindFrozen(const FrozenSearchServer& frozen_server, const Corpus& corpus, Recorder& recorder) {
+	double total_relevance = 0;
+	for (const string& query : corpus.queries) {
+		recorder.Measure([&]() {
+			for (const Document& document : frozen_server.FindTopDocuments(query)) {
+				total_relevance += document.relevance;
+			}
+		});
+	}
+	return total_relevance;
+}
+
+//те же запросы, но все плюс-слова обязательны ("+word"): отбор пересечением списков вхождений
+double RunFindRequired(const SearchServer& search_server, const Corpus& corpus, Recorder& recorder) {
+	double total_relevance = 0;
+	for (const string& query : corpus.queries) {
+		string required_query;
+		for (const string_view word : SplitIntoWordsView(query)) {
+			required_query += (word[0] == '-' ? ""s : "+"s) + string(word) + " "s;
+		}
+		recorder.Measure([&]() {
+			for (const Document& document : search_server.FindTopDocuments(required_query)) {
+				total_relevance += document.relevance;
+			}
+		});
+	}
+	return total_relevance;
+}
+
+//первые десять страниц по 20 документов каждого запроса через курсоры; замер на каждую страницу
+double RunFindPage(const SearchServer& search_server, const Corpus& corpus, Recorder& recorder) {
+	double total_relevance = 0;
+	for (const string& query : corpus.queries) {
+		string cursor;
+		for (int page_index = 0; page_index < 10; ++page_index) {
+			SearchPage page;
+			recorder.Measure([&]() {
+				page = search_server.FindPage(query, 20, cursor);
+			});
+			for (const Document& document : page.documents) {
+				total_relevance += document.relevance;
+			}
+			cursor = page.next_cursor;
+			if (cursor.empty()) {
+				break;
+			}
+		}
+	}
+	return total_relevance;
+}
+
+double RunMatch(const SearchServer& search_server, const Corpus& corpus, Recorder& recorder) {
+	//каждый запрос сопоставляется с десятью документами из разных частей корпуса
+	const size_t step = max<size_t>(1, corpus.documents.size() / 10);
+	double matched_words = 0;
+	for (const string& query : corpus.queries) {
+		for (size_t id = 0; id < corpus.documents.size(); id += step) {
+			recorder.Measure([&]() {
+				const auto [words, status] = search_server.MatchDocument(query, static_cast<int>(id));
+				matched_words += words.size();
+			});
+		}
+	}
+	return matched_words;
+}
+
+double RunProcessQueries(const SearchServer& search_server, const Corpus& corpus, Recorder& recorder) {
+	double total_relevance = 0;
+	recorder.Measure([&]() {
+		for (const Document& document : ProcessQueriesJoined(search_server, corpus.queries)) {
+			total_relevance += document.relevance;
+		}
+	});
+	return total_relevance;
+}
+
+double RunRemoveDuplicates(const Corpus& corpus, Recorder& recorder) {
+	//каждый десятый документ повторяется с другим id и обратным порядком слов
+	SearchServer search_server = BuildServer(corpus);
+	int id = static_cast<int>(corpus.documents.size());
+	for (size_t i = 0; i < corpus.documents.size(); i += 10) {
+		istringstream words(corpus.documents[i]);
+		vector<string> reversed{ istream_iterator<string>(words), istream_iterator<string>() };
+		reverse(reversed.begin(), reversed.end());
+		string text;
+		for (const string& word : reversed) {
+			text += word + " "s;
+		}
+		search_server.AddDocument(id++, text, DocumentStatus::ACTUAL, { 1 });
+	}
+	size_t removed = 0;
+	recorder.Measure([&]() { removed = RemoveDuplicates(search_server).size(); });
+	return static_cast<double>(removed);
+}
+
+struct ScenarioResult {
+	string name;
+	vector<double> samples;
+	double checksum = 0;
+	double wall_seconds = 0;
+	//значения счетчиков PerfCounters за все замеры (без прогрева)
+	array<optional<uint64_t>, PerfCounters::EVENT_COUNT> perf_counts;
+};
+
+double Percentile(const vector<double>& sorted, double percent) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	const size_t index = static_cast<size_t>(ceil(percent / 100 * sorted.size()));
+	return sorted[min(sorted.size() - 1, index == 0 ? 0 : index - 1)];
+}
+
+ScenarioResult RunScenario(const string& name, const Scenario& scenario, const Corpus& corpus,
+	const BenchmarkConfig& config) {
+	ScenarioResult result{ name, {}, 0, 0, {} };
+	for (int i = 0; i < config.warmup; ++i) {
+		Recorder recorder;
+		scenario(corpus, recorder);
+	}
+	optional<PerfCounters> counters;
+	if (config.perf_counters) {
+		counters.emplace();
+		if (!counters->IsAvailable()) {
+			cerr << "benchmark: perf counters unavailable: "s << counters->GetError() << endl;
+			counters.reset();
+		}
+	}
+	for (int i = 0; i < config.repetitions; ++i) {
+		Recorder recorder(counters ? &*counters : nullptr);
+		result.checksum = scenario(corpus, recorder);
+		for (const double sample : recorder.GetSamples()) {
+			result.wall_seconds += sample * 1e-9;
+		}
+		result.samples.insert(result.samples.end(), recorder.GetSamples().begin(), recorder.GetSamples().end());
+	}
+	if (counters) {
+		for (int event = 0; event < PerfCounters::EVENT_COUNT; ++event) {
+			result.perf_counts[event] = counters->Read(static_cast<PerfCounters::Event>(event));
+		}
+	}
+	return result;
+}
+
+string GetHugePageModeName(HugePageMode mode) {
+	switch (mode) {
+	case HugePageMode::TRANSPARENT:
+		return "transparent"s;
+	case HugePageMode::EXPLICIT:
+		return "explicit"s;
+	default:
+		return "off"s;
+	}
+}
+
+string FormatNumber(double value) {
+	char text[64];
+	snprintf(text, sizeof(text), "%.17g", value);
+	return text;
+}
+
+//счетчики на операцию и доли промахов; пусто, если счетчики не снимались
+string FormatPerfCounts(const ScenarioResult& result) {
+	const auto& counts = result.perf_counts;
+	const double operations = static_cast<double>(max<size_t>(result.samples.size(), 1));
+	string text;
+	const auto add = [&](const string& name, PerfCounters::Event event, PerfCounters::Event total) {
+		if (!counts[event]) {
+			return;
+		}
+		text += ", \""s + name + "_per_op\": "s + FormatNumber(*counts[event] / operations);
+		if (counts[total] && *counts[total] > 0) {
+			text += ", \""s + name + "_rate\": "s + FormatNumber(static_cast<double>(*counts[event]) / *counts[total]);
+		}
+	};
+	add("dtlb_load_misses"s, PerfCounters::DTLB_LOAD_MISSES, PerfCounters::DTLB_LOADS);
+	add("cache_misses"s, PerfCounters::CACHE_MISSES, PerfCounters::CACHE_REFERENCES);
+	return text;
+}
+
+void PrintJson(ostream& out, const BenchmarkConfig& config, const vector<ScenarioResult>& results) {
+	out << "{\n"s;
+	out << "  \"config\": {\"documents\": "s << config.documents << ", \"dictionary\": "s << config.dictionary
+		<< ", \"queries\": "s << config.queries << ", \"document_words\": "s << config.document_words
+		<< ", \"query_words\": "s << config.query_words << ", \"zipf\": "s << FormatNumber(config.zipf)
+		<< ", \"minus_prob\": "s << FormatNumber(config.minus_prob) << ", \"warmup\": "s << config.warmup
+		<< ", \"repetitions\": "s << config.repetitions << ", \"seed\": "s << config.seed
+		<< ", \"scoring_kernel\": \""s << GetScoringKernelName()
+		<< "\", \"huge_pages\": \""s << GetHugePageModeName(config.huge_pages) << "\"},\n"s;
+	out << "  \"scenarios\": [\n"s;
+	for (size_t i = 0; i < results.size(); ++i) {
+		const ScenarioResult& result = results[i];
+		vector<double> sorted = result.samples;
+		sort(sorted.begin(), sorted.end());
+		double sum = 0;
+		for (const double sample : sorted) {
+			sum += sample;
+		}
+		const double mean = sorted.empty() ? 0 : sum / sorted.size();
+		out << "    {\"name\": \""s << result.name << "\", \"samples\": "s << sorted.size()
+			<< ", \"mean_us\": "s << FormatNumber(mean / 1000)
+			<< ", \"min_us\": "s << FormatNumber((sorted.empty() ? 0 : sorted.front()) / 1000)
+			<< ", \"p50_us\": "s << FormatNumber(Percentile(sorted, 50) / 1000)
+			<< ", \"p90_us\": "s << FormatNumber(Percentile(sorted, 90) / 1000)
+			<< ", \"p99_us\": "s << FormatNumber(Percentile(sorted, 99) / 1000)
+			<< ", \"max_us\": "s << FormatNumber((sorted.empty() ? 0 : sorted.back()) / 1000)
+			<< ", \"ops_per_second\": "s << FormatNumber(result.wall_seconds > 0 ? sorted.size() / result.wall_seconds : 0)
+			<< ", \"checksum\": "s << FormatNumber(result.checksum) << FormatPerfCounts(result) << "}"s
+			<< (i + 1 < results.size() ? ",\n"s : "\n"s);
+	}
+	out << "  ]\n}\n"s;
+}
+
+vector<string> SplitList(const string& text) {
+	vector<string> items;
+	istringstream stream(text);
+	string item;
+	while (getline(stream, item, ',')) {
+		if (!item.empty()) {
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+BenchmarkConfig ParseArguments(int argc, char* argv[]) {
+	BenchmarkConfig config;
+	for (int i = 1; i < argc; ++i) {
+		const string name = argv[i];
+		if (i + 1 >= argc) {
+			throw invalid_argument("no value for "s + name);
+		}
+		const string value = argv[++i];
+		if (name == "--documents"s) {
+			config.documents = stoi(value);
+		} else if (name == "--dictionary"s) {
+			config.dictionary = stoi(value);
+		} else if (name == "--queries"s) {
+			config.queries = stoi(value);
+		} else if (name == "--document-words"s) {
+			config.document_words = stoi(value);
+		} else if (name == "--query-words"s) {
+			config.query_words = stoi(value);
+		} else if (name == "--zipf"s) {
+			config.zipf = stod(value);
+		} else if (name == "--minus-prob"s) {
+			config.minus_prob = stod(value);
+		} else if (name == "--warmup"s) {
+			config.warmup = stoi(value);
+		} else if (name == "--repetitions"s) {
+			config.repetitions = stoi(value);
+		} else if (name == "--seed"s) {
+			config.seed = static_cast<unsigned>(stoul(value));
+		} else if (name == "--scenarios"s) {
+			config.scenarios = SplitList(value);
+		} else if (name == "--huge-pages"s) {
+			if (value == "off"s) {
+				config.huge_pages = HugePageMode::OFF;
+			} else if (value == "transparent"s) {
+				config.huge_pages = HugePageMode::TRANSPARENT;
+			} else if (value == "explicit"s) {
+				config.huge_pages = HugePageMode::EXPLICIT;
+			} else {
+				throw invalid_argument("unknown huge page mode "s + value);
+			}
+		} else if (name == "--perf"s) {
+			config.perf_counters = stoi(value) != 0;
+		} else if (name == "--output"s) {
+			config.output = value;
+		} else {
+			throw invalid_argument("unknown option "s + name);
+		}
+	}
+	if (config.documents <= 0 || config.dictionary <= 0 || config.queries <= 0 || config.repetitions <= 0
+		|| config.warmup < 0) {
+		throw invalid_argument("corpus sizes and repetitions must be positive"s);
+	}
+	return config;
+}
+
+int main(int argc, char* argv[]) {
+	BenchmarkConfig config;
+	try {
+		config = ParseArguments(argc, argv);
+	} catch (const exception& error) {
+		cerr << "benchmark: "s << error.what() << endl;
+		return 2;
+	}
+	SetHugePageMode(config.huge_pages);
+	const Corpus corpus = GenerateCorpus(config);
+	//поисковые сценарии работают с одним общим индексом, он строится один раз
+	const SearchServer search_server = BuildServer(corpus);
+	const FrozenSearchServer frozen_server(search_server);
+	const vector<pair<string, Scenario>> scenarios = {
+		{ "ingest"s, RunIngest },
+		{ "ingest_wal"s, RunIngestWal },
+		{ "load_corpus"s, RunLoadCorpus },
+		{ "remove"s, RunRemove },
+		{ "find_seq"s, [&](const Corpus& corpus, Recorder& recorder) {
+			return RunFind(search_server, corpus, recorder, execution::seq); } },
+		{ "find_par"s, [&](const Corpus& corpus, Recorder& recorder) {
+			return RunFind(search_server, corpus, recorder, execution::par); } },
+		{ "find_adaptive"s, [&](const Corpus& corpus, Recorder& recorder) {
+			return RunFind(search_server, corpus, recorder, adaptive_policy); } },
+		{ "find_page"s, [&](const Corpus& corpus, Recorder& recorder) {
+			return RunFindPage(search_server, corpus, recorder); } },
+		{ "find_required"s, [&](const Corpus& corpus, Recorder& recorder) {
+			return RunFindRequired(search_server, corpus, recorder); } },
+		{ "find_frozen"s, [&](const Corpus& corpus, Recorder& recorder) {
+			return RunFindFrozen(frozen_server, corpus, recorder); } },
+		{ "match"s, [&](const Corpus& corpus, Recorder& recorder) {
+			return RunMatch(search_server, corpus, recorder); } },
+		{ "process_queries"s, [&](const Corpus& corpus, Recorder& recorder) {
+			return RunProcessQueries(search_server, corpus, recorder); } },
+		{ "remove_duplicates"s, RunRemoveDuplicates },
+	};
+	vector<ScenarioResult> results;
+	for (const string& name : config.scenarios) {
+		const auto it = find_if(scenarios.begin(), scenarios.end(),
+			[&name](const auto& scenario) { return scenario.first == name; });
+		if (it == scenarios.end()) {
+			cerr << "benchmark: unknown scenario "s << name << endl;
+			return 2;
+		}
+		cerr << name << "..."s << endl;
+		results.push_back(RunScenario(name, it->second, corpus, config));
+	}
+	if (config.output.empty()) {
+		PrintJson(cout, config, results);
+	} else {
+		ofstream out(config.output);
+		PrintJson(out, config, results);
+	}
+	return 0;
+}
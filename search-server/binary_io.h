@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+//Двоичный формат снимков индекса и журнала изменений. Числа пишутся в порядке байтов процессора,
+//поэтому файлы не переносятся между архитектурами с разным порядком
+
+template <typename Type>
+void AppendBinary(std::string& out, Type value) {
+	static_assert(std::is_trivially_copyable_v<Type>);
+	out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+//длина (uint32_t) и байты строки
+inline void AppendBinaryString(std::string& out, std::string_view text) {
+	AppendBinary(out, static_cast<uint32_t>(text.size()));
+	out.append(text.data(), text.size());
+}
+
+//число элементов (uint64_t) и элементы подряд
+template <typename Type, typename Allocator>
+void AppendBinaryVector(std::string& out, const std::vector<Type, Allocator>& values) {
+	static_assert(std::is_trivially_copyable_v<Type>);
+	AppendBinary(out, static_cast<uint64_t>(values.size()));
+	out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(Type));
+}
+
+//Чтение записанного функциями AppendBinary*; данных не хватает - std::runtime_error
+class BinaryReader {
+public:
+	explicit BinaryReader(std::string_view data)
+		: data_(data) {
+	}
+
+	template <typename Type>
+	Type Read() {
+		static_assert(std::is_trivially_copyable_v<Type>);
+		Require(sizeof(Type));
+		Type value;
+		std::memcpy(&value, data_.data() + position_, sizeof(Type));
+		position_ += sizeof(Type);
+		return value;
+	}
+
+	//строка ссылается на данные читателя
+	std::string_view ReadString() {
+		const uint32_t size = Read<uint32_t>();
+		Require(size);
+		const std::string_view text = data_.substr(position_, size);
+		position_ += size;
+		return text;
+	}
+
+	template <typename Type, typename Allocator = std::allocator<Type>>
+	std::vector<Type, Allocator> ReadVector() {
+		const uint64_t size = Read<uint64_t>();
+		if (size > (data_.size() - position_) / sizeof(Type)) {
+			throw std::runtime_error("truncated binary data");
+		}
+		std::vector<Type, Allocator> values(size);
+		std::memcpy(values.data(), data_.data() + position_, size * sizeof(Type));
+		position_ += size * sizeof(Type);
+		return values;
+	}
+
+	bool AtEnd() const {
+		return position_ == data_.size();
+	}
+
+private:
+	std::string_view data_;
+	size_t position_ = 0;
+
+	void Require(size_t size) const {
+		if (size > data_.size() - position_) {
+			throw std::runtime_error("truncated binary data");
+		}
+	}
+};
+
+//CRC-32 (полином 0xEDB88320, как в zlib); crc - значение для предыдущей части данных.
+//Таблицы на 8 байт за шаг (slicing-by-8): журнал считает сумму каждой записи при добавлении документа
+inline uint32_t ComputeCrc32(std::string_view data, uint32_t crc = 0) {
+	static const std::array<std::array<uint32_t, 256>, 8> tables = []() {
+		std::array<std::array<uint32_t, 256>, 8> result{};
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; ++bit) {
+				value = value & 1 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+			}
+			result[0][i] = value;
+		}
+		for (size_t table = 1; table < result.size(); ++table) {
+			for (uint32_t i = 0; i < 256; ++i) {
+				const uint32_t previous = result[table - 1][i];
+				result[table][i] = (previous >> 8) ^ result[0][previous & 0xFF];
+			}
+		}
+		return result;
+	}();
+	crc = ~crc;
+	const char* position = data.data();
+	size_t size = data.size();
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	for (; size >= 8; size -= 8, position += 8) {
+		uint32_t low;
+		uint32_t high;
+		std::memcpy(&low, position, sizeof(low));
+		std::memcpy(&high, position + 4, sizeof(high));
+		low ^= crc;
+		crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^ tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24]
+			^ tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^ tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+	}
+#endif
+	for (; size > 0; --size, ++position) {
+		crc = tables[0][(crc ^ static_cast<uint8_t>(*position)) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
@@ -0,0 +1,186 @@
+#include "boolean_query.h"
+
+#include <algorithm>
+#include <iterator>
+
+const int* GallopLowerBound(const int* first, const int* last, int value) {
+	if (first == last || *first >= value) {
+		return first;
+	}
+	//first[low] < value, first[high] >= value или high за концом
+	const size_t size = last - first;
+	size_t low = 0;
+	size_t high = 1;
+	while (high < size && first[high] < value) {
+		low = high;
+		high *= 2;
+	}
+	return std::lower_bound(first + low + 1, first + std::min(high, size), value);
+}
+
+BooleanMatcher::BooleanMatcher(const std::vector<BooleanNode>& nodes,
+	const std::function<const std::vector<int>*(std::string_view)>& find_slots) {
+	if (!nodes.empty()) {
+		Compile(nodes, 0, find_slots);
+	}
+}
+
+BooleanMatcher::Operand BooleanMatcher::Compile(const std::vector<BooleanNode>& nodes, int node,
+	const std::function<const std::vector<int>*(std::string_view)>& find_slots) {
+	const size_t index = groups_.size();
+	groups_.emplace_back();
+	for (const BooleanClause& clause : nodes[node].clauses) {
+		Operand operand;
+		if (clause.child < 0) {
+			const std::vector<int>* slots = find_slots(clause.word);
+			const int* begin = slots == nullptr ? nullptr : slots->data();
+			const int* end = slots == nullptr ? nullptr : slots->data() + slots->size();
+			leaves_.push_back({ begin, end });
+			operand = { true, leaves_.size() - 1 };
+		} else {
+			operand = Compile(nodes, clause.child, find_slots);
+		}
+		//ссылку на groups_ брать нельзя: вложенные группы добавляются в конец вектора
+		switch (clause.occur) {
+		case Occur::MUST:
+			groups_[index].must.push_back(operand);
+			break;
+		case Occur::SHOULD:
+			groups_[index].should.push_back(operand);
+			break;
+		case Occur::MUST_NOT:
+			groups_[index].must_not.push_back(operand);
+			break;
+		}
+	}
+	//обязательные части проверяются от самой короткой: документ отсеивается раньше
+	Group& group = groups_[index];
+	std::sort(group.must.begin(), group.must.end(),
+		[this](const Operand& lhs, const Operand& rhs) { return Estimate(lhs) < Estimate(rhs); });
+	return { false, index };
+}
+
+size_t BooleanMatcher::Estimate(const Operand& operand) const {
+	if (operand.is_leaf) {
+		const Leaf& leaf = leaves_[operand.index];
+		return leaf.end - leaf.cursor;
+	}
+	const Group& group = groups_[operand.index];
+	if (!group.must.empty()) {
+		return Estimate(group.must.front());
+	}
+	size_t estimate = 0;
+	for (const Operand& should : group.should) {
+		estimate += Estimate(should);
+	}
+	return estimate;
+}
+
+std::vector<int> BooleanMatcher::FindSlots() {
+	if (groups_.empty()) {
+		return {};
+	}
+	return Materialize({ false, 0 });
+}
+
+std::vector<int> BooleanMatcher::Materialize(const Operand& operand) {
+	if (operand.is_leaf) {
+		const Leaf& leaf = leaves_[operand.index];
+		return { leaf.cursor, leaf.end };
+	}
+	const Group& group = groups_[operand.index];
+	std::vector<int> slots;
+	if (!group.must.empty()) {
+		//перебор самой короткой обязательной части, остальные только проверяются
+		slots = Materialize(group.must.front());
+		auto last = std::remove_if(slots.begin(), slots.end(), [&](int slot) {
+			for (size_t i = 1; i < group.must.size(); ++i) {
+				if (!Contains(group.must[i], slot)) {
+					return true;
+				}
+			}
+			return false;
+		});
+		slots.erase(last, slots.end());
+	} else {
+		for (const Operand& should : group.should) {
+			std::vector<int> should_slots = Materialize(should);
+			std::vector<int> united;
+			united.reserve(slots.size() + should_slots.size());
+			std::set_union(slots.begin(), slots.end(), should_slots.begin(), should_slots.end(),
+				std::back_inserter(united));
+			slots = std::move(united);
+		}
+	}
+	if (!group.must_not.empty()) {
+		auto last = std::remove_if(slots.begin(), slots.end(), [&](int slot) {
+			for (const Operand& must_not : group.must_not) {
+				if (Contains(must_not, slot)) {
+					return true;
+				}
+			}
+			return false;
+		});
+		slots.erase(last, slots.end());
+	}
+	return slots;
+}
+
+bool BooleanMatcher::Contains(const Operand& operand, int slot) {
+	if (operand.is_leaf) {
+		Leaf& leaf = leaves_[operand.index];
+		leaf.cursor = GallopLowerBound(leaf.cursor, leaf.end, slot);
+		return leaf.cursor != leaf.end && *leaf.cursor == slot;
+	}
+	const Group& group = groups_[operand.index];
+	for (const Operand& must : group.must) {
+		if (!Contains(must, slot)) {
+			return false;
+		}
+	}
+	for (const Operand& must_not : group.must_not) {
+		if (Contains(must_not, slot)) {
+			return false;
+		}
+	}
+	if (!group.must.empty()) {
+		return true;
+	}
+	for (const Operand& should : group.should) {
+		if (Contains(should, slot)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool BooleanMatcher::Matches(const std::vector<BooleanNode>& nodes,
+	const std::function<bool(std::string_view)>& contains) {
+	return !nodes.empty() && Matches(nodes, 0, contains);
+}
+
+bool BooleanMatcher::Matches(const std::vector<BooleanNode>& nodes, int node,
+	const std::function<bool(std::string_view)>& contains) {
+	bool has_must = false;
+	bool has_should = false;
+	for (const BooleanClause& clause : nodes[node].clauses) {
+		const bool is_contained = clause.child < 0 ? contains(clause.word) : Matches(nodes, clause.child, contains);
+		switch (clause.occur) {
+		case Occur::MUST:
+			if (!is_contained) {
+				return false;
+			}
+			has_must = true;
+			break;
+		case Occur::SHOULD:
+			has_should = has_should || is_contained;
+			break;
+		case Occur::MUST_NOT:
+			if (is_contained) {
+				return false;
+			}
+			break;
+		}
+	}
+	return has_must || has_should;
+}
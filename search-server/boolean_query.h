@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+//Вхождение части в группу логического запроса
+enum class Occur { SHOULD, MUST, MUST_NOT };
+
+//Часть группы: слово или вложенная группа (child - номер группы в дереве, -1 для слова)
+struct BooleanClause {
+	Occur occur = Occur::SHOULD;
+	std::string_view word;
+	int child = -1;
+};
+
+//Группа логического запроса: документ подходит, если содержит все обязательные части (MUST),
+//ни одной запрещенной (MUST_NOT) и, когда обязательных нет, хотя бы одну необязательную (SHOULD).
+//Группа без обязательных и необязательных частей не подходит ни одному документу
+struct BooleanNode {
+	std::vector<BooleanClause> clauses;
+	//варианты одного слова запроса (раскрытие префикса или нечеткий поиск)
+	bool is_alternatives = false;
+};
+
+//Галопирующий поиск: первый элемент [first, last), не меньший value. Шаг растет вдвое от first,
+//поэтому переход на d элементов вперед стоит O(log d) - выгодно при движении по списку вперед
+const int* GallopLowerBound(const int* first, const int* last, int value);
+
+//Отбор документов логическим запросом по отсортированным спискам номеров документов.
+//Группа с обязательными частями перебирает номера самой короткой из них, остальные части
+//проверяются галопирующим поиском с продвижением только вперед, поэтому запрос с обязательным
+//словом стоит примерно столько, сколько его самый короткий список
+class BooleanMatcher {
+public:
+	//nodes[0] - корень; find_slots(word) - номера документов со словом по возрастанию или nullptr
+	BooleanMatcher(const std::vector<BooleanNode>& nodes,
+		const std::function<const std::vector<int>*(std::string_view)>& find_slots);
+
+	//номера подходящих документов по возрастанию; вызывается один раз
+	std::vector<int> FindSlots();
+
+	//проверка одного документа; contains(word) - есть ли слово в документе
+	static bool Matches(const std::vector<BooleanNode>& nodes,
+		const std::function<bool(std::string_view)>& contains);
+
+private:
+	//список номеров слова с текущим положением поиска
+	struct Leaf {
+		const int* cursor;
+		const int* end;
+	};
+	//часть группы: слово (номер в leaves_) или группа (номер в groups_)
+	struct Operand {
+		bool is_leaf;
+		size_t index;
+	};
+	struct Group {
+		std::vector<Operand> must;
+		std::vector<Operand> should;
+		std::vector<Operand> must_not;
+	};
+	std::vector<Leaf> leaves_;
+	std::vector<Group> groups_;
+
+	Operand Compile(const std::vector<BooleanNode>& nodes, int node,
+		const std::function<const std::vector<int>*(std::string_view)>& find_slots);
+
+	//верхняя оценка числа подходящих документов
+	size_t Estimate(const Operand& operand) const;
+
+	std::vector<int> Materialize(const Operand& operand);
+
+	//номера должны запрашиваться по возрастанию
+	bool Contains(const Operand& operand, int slot);
+
+	static bool Matches(const std::vector<BooleanNode>& nodes, int node,
+		const std::function<bool(std::string_view)>& contains);
+};
@@ -0,0 +1,590 @@
+#include "corpus_loader.h"
+#include "string_processing.h"
+
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+namespace {
+
+constexpr size_t CORPUS_BLOCK_SIZE = 1 << 20;
+constexpr size_t CORPUS_QUEUE_DEPTH = 4;
+
+std::runtime_error SystemError(const std::string& what) {
+	return std::runtime_error(what + ": "s + std::strerror(errno));
+}
+
+int ParseInteger(std::string_view text) {
+	int value = 0;
+	const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (text.empty() || error != std::errc{} || end != text.data() + text.size()) {
+		throw std::invalid_argument("invalid integer \""s + std::string{ text } + "\""s);
+	}
+	return value;
+}
+
+DocumentStatus ParseDocumentStatus(std::string_view name) {
+	if (name == "ACTUAL") {
+		return DocumentStatus::ACTUAL;
+	}
+	if (name == "IRRELEVANT") {
+		return DocumentStatus::IRRELEVANT;
+	}
+	if (name == "BANNED") {
+		return DocumentStatus::BANNED;
+	}
+	if (name == "REMOVED") {
+		return DocumentStatus::REMOVED;
+	}
+	throw std::invalid_argument("unknown status \""s + std::string{ name } + "\""s);
+}
+
+CorpusRecord ParseTsvLine(std::string_view line) {
+	std::string_view fields[3];
+	for (std::string_view& field : fields) {
+		const size_t tab = line.find('\t');
+		if (tab == std::string_view::npos) {
+			throw std::invalid_argument("expected 4 tab-separated fields"s);
+		}
+		field = line.substr(0, tab);
+		line.remove_prefix(tab + 1);
+	}
+	CorpusRecord record;
+	record.id = ParseInteger(fields[0]);
+	record.status = ParseDocumentStatus(fields[1]);
+	for (const std::string_view& rating : SplitIntoWordsView(fields[2])) {
+		record.ratings.push_back(ParseInteger(rating));
+	}
+	record.text = std::string{ line };
+	return record;
+}
+
+//Разбор одного объекта JSON без построения дерева: значения читаются по мере надобности
+class JsonCursor {
+public:
+	explicit JsonCursor(std::string_view text)
+		: text_(text) {
+	}
+
+	bool AtEnd() {
+		SkipSpaces();
+		return position_ == text_.size();
+	}
+
+	//пропускает c, если оно следующее
+	bool Consume(char c) {
+		SkipSpaces();
+		if (position_ < text_.size() && text_[position_] == c) {
+			++position_;
+			return true;
+		}
+		return false;
+	}
+
+	void Expect(char c) {
+		if (!Consume(c)) {
+			throw std::invalid_argument("expected '"s + c + "' at offset "s + std::to_string(position_));
+		}
+	}
+
+	std::string ReadString() {
+		Expect('"');
+		std::string result;
+		while (true) {
+			if (position_ == text_.size()) {
+				throw std::invalid_argument("unterminated string"s);
+			}
+			const char c = text_[position_++];
+			if (c == '"') {
+				return result;
+			}
+			if (c != '\\') {
+				result += c;
+				continue;
+			}
+			if (position_ == text_.size()) {
+				throw std::invalid_argument("unterminated string"s);
+			}
+			const char escape = text_[position_++];
+			switch (escape) {
+			case '"': case '\\': case '/':
+				result += escape;
+				break;
+			case 'b':
+				result += '\b';
+				break;
+			case 'f':
+				result += '\f';
+				break;
+			case 'n':
+				result += '\n';
+				break;
+			case 'r':
+				result += '\r';
+				break;
+			case 't':
+				result += '\t';
+				break;
+			case 'u':
+				AppendUtf8(ReadCodePoint(), result);
+				break;
+			default:
+				throw std::invalid_argument("bad escape \"\\"s + escape + "\""s);
+			}
+		}
+	}
+
+	int ReadInteger() {
+		SkipSpaces();
+		const size_t begin = position_;
+		if (position_ < text_.size() && text_[position_] == '-') {
+			++position_;
+		}
+		while (position_ < text_.size() && text_[position_] >= '0' && text_[position_] <= '9') {
+			++position_;
+		}
+		return ParseInteger(text_.substr(begin, position_ - begin));
+	}
+
+	//пропуск значения любого типа
+	void SkipValue() {
+		SkipSpaces();
+		if (position_ == text_.size()) {
+			throw std::invalid_argument("expected value"s);
+		}
+		const char c = text_[position_];
+		if (c == '"') {
+			ReadString();
+		} else if (c == '{' || c == '[') {
+			const char close = c == '{' ? '}' : ']';
+			++position_;
+			if (Consume(close)) {
+				return;
+			}
+			do {
+				if (c == '{') {
+					ReadString();
+					Expect(':');
+				}
+				SkipValue();
+			} while (Consume(','));
+			Expect(close);
+		} else {
+			//число, true, false или null
+			const size_t begin = position_;
+			while (position_ < text_.size() && std::strchr(",]} \t\r\n", text_[position_]) == nullptr) {
+				++position_;
+			}
+			if (position_ == begin) {
+				throw std::invalid_argument("expected value at offset "s + std::to_string(begin));
+			}
+		}
+	}
+
+private:
+	std::string_view text_;
+	size_t position_ = 0;
+
+	void SkipSpaces() {
+		while (position_ < text_.size() && (text_[position_] == ' ' || text_[position_] == '\t'
+			|| text_[position_] == '\r' || text_[position_] == '\n')) {
+			++position_;
+		}
+	}
+
+	unsigned ReadHex4() {
+		if (text_.size() - position_ < 4) {
+			throw std::invalid_argument("bad \\u escape"s);
+		}
+		unsigned value = 0;
+		const auto [end, error] = std::from_chars(text_.data() + position_, text_.data() + position_ + 4, value, 16);
+		if (error != std::errc{} || end != text_.data() + position_ + 4) {
+			throw std::invalid_argument("bad \\u escape"s);
+		}
+		position_ += 4;
+		return value;
+	}
+
+	//\uXXXX после "\u", суррогатная пара собирается в одну кодовую точку
+	unsigned ReadCodePoint() {
+		const unsigned high = ReadHex4();
+		if (high < 0xD800 || high > 0xDBFF) {
+			return high;
+		}
+		if (text_.substr(position_, 2) != "\\u") {
+			throw std::invalid_argument("unpaired surrogate in \\u escape"s);
+		}
+		position_ += 2;
+		const unsigned low = ReadHex4();
+		if (low < 0xDC00 || low > 0xDFFF) {
+			throw std::invalid_argument("unpaired surrogate in \\u escape"s);
+		}
+		return 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+	}
+
+	static void AppendUtf8(unsigned code_point, std::string& out) {
+		if (code_point < 0x80) {
+			out += static_cast<char>(code_point);
+		} else if (code_point < 0x800) {
+			out += static_cast<char>(0xC0 | (code_point >> 6));
+			out += static_cast<char>(0x80 | (code_point & 0x3F));
+		} else if (code_point < 0x10000) {
+			out += static_cast<char>(0xE0 | (code_point >> 12));
+			out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (code_point & 0x3F));
+		} else {
+			out += static_cast<char>(0xF0 | (code_point >> 18));
+			out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (code_point & 0x3F));
+		}
+	}
+};
+
+CorpusRecord ParseJsonLine(std::string_view line) {
+	JsonCursor cursor(line);
+	CorpusRecord record;
+	bool has_id = false;
+	bool has_text = false;
+	cursor.Expect('{');
+	if (!cursor.Consume('}')) {
+		do {
+			const std::string key = cursor.ReadString();
+			cursor.Expect(':');
+			if (key == "id") {
+				record.id = cursor.ReadInteger();
+				has_id = true;
+			} else if (key == "status") {
+				record.status = ParseDocumentStatus(cursor.ReadString());
+			} else if (key == "ratings") {
+				cursor.Expect('[');
+				if (!cursor.Consume(']')) {
+					do {
+						record.ratings.push_back(cursor.ReadInteger());
+					} while (cursor.Consume(','));
+					cursor.Expect(']');
+				}
+			} else if (key == "text") {
+				record.text = cursor.ReadString();
+				has_text = true;
+			} else {
+				cursor.SkipValue();
+			}
+		} while (cursor.Consume(','));
+		cursor.Expect('}');
+	}
+	if (!cursor.AtEnd()) {
+		throw std::invalid_argument("trailing characters after object"s);
+	}
+	if (!has_id) {
+		throw std::invalid_argument("missing \"id\""s);
+	}
+	if (!has_text) {
+		throw std::invalid_argument("missing \"text\""s);
+	}
+	return record;
+}
+
+//Очередь ограниченной длины между стадиями конвейера. Close закрывает ее с любой стороны:
+//Push после этого возвращает false, Pop отдает оставшееся и затем nullopt
+template <typename Type>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(size_t capacity)
+		: capacity_(capacity) {
+	}
+
+	bool Push(Type value) {
+		std::unique_lock lock(mutex_);
+		not_full_.wait(lock, [this]() { return items_.size() < capacity_ || closed_; });
+		if (closed_) {
+			return false;
+		}
+		items_.push_back(std::move(value));
+		not_empty_.notify_one();
+		return true;
+	}
+
+	std::optional<Type> Pop() {
+		std::unique_lock lock(mutex_);
+		not_empty_.wait(lock, [this]() { return !items_.empty() || closed_; });
+		if (items_.empty()) {
+			return std::nullopt;
+		}
+		Type value = std::move(items_.front());
+		items_.pop_front();
+		not_full_.notify_one();
+		return value;
+	}
+
+	void Close() {
+		{
+			std::lock_guard guard(mutex_);
+			closed_ = true;
+		}
+		not_full_.notify_all();
+		not_empty_.notify_all();
+	}
+
+private:
+	const size_t capacity_;
+	std::deque<Type> items_;
+	bool closed_ = false;
+	std::mutex mutex_;
+	std::condition_variable not_full_;
+	std::condition_variable not_empty_;
+};
+
+//Блок целых строк: прочитанный в storage или лежащий в отображенном файле (mapped)
+struct LineBlock {
+	std::string storage;
+	std::string_view mapped;
+
+	std::string_view GetText() const {
+		return mapped.data() != nullptr ? mapped : std::string_view{ storage };
+	}
+};
+
+struct ParsedLine {
+	size_t line_number;
+	CorpusRecord record;
+};
+
+struct ParsedBlock {
+	std::vector<ParsedLine> records;
+	std::vector<CorpusLoadError> errors;
+	size_t lines = 0;
+	size_t bytes = 0;
+};
+
+void AddLoadError(CorpusLoadStats& stats, CorpusLoadError error) {
+	++stats.rejected;
+	if (stats.errors.size() < CorpusLoadStats::MAX_ERRORS) {
+		stats.errors.push_back(std::move(error));
+	}
+}
+
+//блоки идут по порядку, поэтому номер строки ведет единственный поток разбора
+ParsedBlock ParseBlock(const LineBlock& block, CorpusFormat format, size_t& line_number) {
+	ParsedBlock parsed;
+	std::string_view text = block.GetText();
+	parsed.bytes = text.size();
+	while (!text.empty()) {
+		const size_t end = text.find('\n');
+		std::string_view line = text.substr(0, end);
+		text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+		++line_number;
+		++parsed.lines;
+		if (!line.empty() && line.back() == '\r') {
+			line.remove_suffix(1);
+		}
+		if (line.empty()) {
+			continue;
+		}
+		try {
+			parsed.records.push_back({ line_number, ParseCorpusLine(line, format) });
+		} catch (const std::invalid_argument& error) {
+			parsed.errors.push_back({ line_number, error.what() });
+		}
+	}
+	return parsed;
+}
+
+//read_blocks(push) передает блоки целых строк в push, пока тот возвращает true
+template <typename ReadBlocks>
+CorpusLoadStats RunLoadPipeline(SearchServer& search_server, CorpusFormat format, ReadBlocks read_blocks) {
+	const auto start = std::chrono::steady_clock::now();
+	BoundedQueue<LineBlock> blocks(CORPUS_QUEUE_DEPTH);
+	BoundedQueue<ParsedBlock> parsed_blocks(CORPUS_QUEUE_DEPTH);
+	std::exception_ptr reader_error;
+	std::exception_ptr parser_error;
+	std::thread reader([&]() {
+		try {
+			read_blocks([&blocks](LineBlock block) { return blocks.Push(std::move(block)); });
+		} catch (...) {
+			reader_error = std::current_exception();
+		}
+		blocks.Close();
+	});
+	std::thread parser([&]() {
+		try {
+			size_t line_number = 0;
+			while (std::optional<LineBlock> block = blocks.Pop()) {
+				if (!parsed_blocks.Push(ParseBlock(*block, format, line_number))) {
+					break;
+				}
+			}
+		} catch (...) {
+			parser_error = std::current_exception();
+		}
+		//остановка разбора останавливает и чтение
+		blocks.Close();
+		parsed_blocks.Close();
+	});
+
+	CorpusLoadStats stats;
+	std::exception_ptr indexer_error;
+	try {
+		while (std::optional<ParsedBlock> block = parsed_blocks.Pop()) {
+			stats.lines += block->lines;
+			stats.bytes += block->bytes;
+			//ошибки разбора и индексации сливаются в порядке строк
+			auto error = block->errors.begin();
+			for (ParsedLine& line : block->records) {
+				for (; error != block->errors.end() && error->line_number < line.line_number; ++error) {
+					AddLoadError(stats, std::move(*error));
+				}
+				try {
+					search_server.AddDocument(line.record.id, line.record.text, line.record.status, line.record.ratings);
+					++stats.documents;
+				} catch (const std::invalid_argument& add_error) {
+					AddLoadError(stats, { line.line_number, add_error.what() });
+				}
+			}
+			for (; error != block->errors.end(); ++error) {
+				AddLoadError(stats, std::move(*error));
+			}
+		}
+	} catch (...) {
+		indexer_error = std::current_exception();
+	}
+	parsed_blocks.Close();
+	blocks.Close();
+	parser.join();
+	reader.join();
+	for (const std::exception_ptr& error : { indexer_error, parser_error, reader_error }) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+//Файл, отображенный в память только для чтения
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path) {
+		const int file = open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			throw SystemError("open "s + path);
+		}
+		struct stat file_stat {};
+		if (fstat(file, &file_stat) < 0) {
+			const std::runtime_error error = SystemError("stat "s + path);
+			close(file);
+			throw error;
+		}
+		size_ = static_cast<size_t>(file_stat.st_size);
+		if (size_ > 0) {
+			void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+			if (data == MAP_FAILED) {
+				const std::runtime_error error = SystemError("mmap "s + path);
+				close(file);
+				throw error;
+			}
+			data_ = static_cast<const char*>(data);
+			madvise(data, size_, MADV_SEQUENTIAL);
+		}
+		close(file);
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() {
+		if (data_ != nullptr) {
+			munmap(const_cast<char*>(data_), size_);
+		}
+	}
+
+	std::string_view GetText() const {
+		return { data_, size_ };
+	}
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+};
+
+} // namespace
+
+double CorpusLoadStats::GetDocumentsPerSecond() const {
+	return seconds > 0 ? documents / seconds : 0;
+}
+
+double CorpusLoadStats::GetMegabytesPerSecond() const {
+	return seconds > 0 ? bytes / seconds / (1 << 20) : 0;
+}
+
+CorpusRecord ParseCorpusLine(std::string_view line, CorpusFormat format) {
+	return format == CorpusFormat::TSV ? ParseTsvLine(line) : ParseJsonLine(line);
+}
+
+CorpusLoadStats LoadCorpus(SearchServer& search_server, std::istream& input, CorpusFormat format) {
+	return RunLoadPipeline(search_server, format, [&input](auto push) {
+		//хвост блока после последнего '\n' переходит в начало следующего
+		std::string tail;
+		while (true) {
+			LineBlock block;
+			block.storage = std::move(tail);
+			const size_t old_size = block.storage.size();
+			block.storage.resize(old_size + CORPUS_BLOCK_SIZE);
+			input.read(&block.storage[old_size], CORPUS_BLOCK_SIZE);
+			if (input.bad()) {
+				throw std::runtime_error("corpus read error"s);
+			}
+			const size_t read_count = static_cast<size_t>(input.gcount());
+			block.storage.resize(old_size + read_count);
+			const bool is_last = read_count < CORPUS_BLOCK_SIZE;
+			tail.clear();
+			if (!is_last) {
+				const size_t cut = block.storage.rfind('\n') + 1;
+				tail.assign(block.storage, cut, std::string::npos);
+				block.storage.resize(cut);
+			}
+			if (!block.storage.empty() && !push(std::move(block))) {
+				return;
+			}
+			if (is_last) {
+				return;
+			}
+		}
+	});
+}
+
+CorpusLoadStats LoadCorpusFile(SearchServer& search_server, const std::string& path, CorpusFormat format) {
+	const MappedFile file(path);
+	return RunLoadPipeline(search_server, format, [&file](auto push) {
+		std::string_view text = file.GetText();
+		while (!text.empty()) {
+			size_t cut = text.size();
+			if (text.size() > CORPUS_BLOCK_SIZE) {
+				const size_t newline = text.find('\n', CORPUS_BLOCK_SIZE);
+				cut = newline == std::string_view::npos ? text.size() : newline + 1;
+			}
+			LineBlock block;
+			block.mapped = text.substr(0, cut);
+			text.remove_prefix(cut);
+			if (!push(std::move(block))) {
+				return;
+			}
+		}
+	});
+}
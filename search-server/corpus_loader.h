@@ -0,0 +1,58 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Формат корпуса, одна строка - один документ, пустые строки пропускаются:
+//TSV - id<TAB>статус<TAB>рейтинги через пробел<TAB>текст (текст - весь остаток строки);
+//JSONL - {"id": 1, "status": "ACTUAL", "ratings": [1, 2], "text": "..."}, status и ratings необязательны,
+//прочие поля пропускаются. Статус - имя значения DocumentStatus
+enum class CorpusFormat { TSV, JSONL };
+
+struct CorpusRecord {
+	int id = 0;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	std::vector<int> ratings;
+	std::string text;
+};
+
+//Строка, не попавшая в индекс: ошибка разбора или отказ AddDocument (номер строки с 1)
+struct CorpusLoadError {
+	size_t line_number = 0;
+	std::string message;
+};
+
+//Итоги загрузки. Сохраняются только первые MAX_ERRORS ошибок, rejected считает все
+struct CorpusLoadStats {
+	static constexpr size_t MAX_ERRORS = 100;
+
+	size_t documents = 0;
+	size_t lines = 0;
+	size_t bytes = 0;
+	size_t rejected = 0;
+	double seconds = 0;
+	std::vector<CorpusLoadError> errors;
+
+	double GetDocumentsPerSecond() const;
+
+	double GetMegabytesPerSecond() const;
+};
+
+//разбор строки без '\n'; при ошибке - std::invalid_argument
+CorpusRecord ParseCorpusLine(std::string_view line, CorpusFormat format);
+
+//Загрузка корпуса конвейером: поток чтения блоками по 1 МБ, поток разбора строк и индексация
+//в вызывающем потоке (разбиение текста на слова идет в AddDocument, ему нужен словарь сервера).
+//Стадии связаны очередями ограниченной длины, поэтому память не растет с размером корпуса.
+//Плохие строки попадают в errors и не прерывают загрузку; ошибка чтения - std::runtime_error.
+//Для std::cin стоит заранее вызвать std::ios::sync_with_stdio(false)
+CorpusLoadStats LoadCorpus(SearchServer& search_server, std::istream& input, CorpusFormat format);
+
+//То же для файла, отображенного в память; если файл не открывается - std::runtime_error
+CorpusLoadStats LoadCorpusFile(SearchServer& search_server, const std::string& path, CorpusFormat format);
@@ -0,0 +1,112 @@
+#include "durable_search_server.h"
+#include "binary_io.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace std::string_literals;
+
+DurableSearchServer::DurableSearchServer(const std::string& directory, SearchServer server,
+	const WriteAheadLogOptions& options)
+	: snapshot_path_(directory + "/snapshot"s)
+	, server_(std::move(server))
+	, wal_(directory + "/wal"s, options) {
+	Recover();
+}
+
+void DurableSearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	Log({ 0, WalRecordType::ADD_DOCUMENT, document_id, status, ratings, document });
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+	Log({ 0, WalRecordType::REMOVE_DOCUMENT, document_id });
+}
+
+void DurableSearchServer::SetStopWords(const std::string_view& text) {
+	Log({ 0, WalRecordType::SET_STOP_WORDS, 0, DocumentStatus::ACTUAL, {}, text });
+}
+
+void DurableSearchServer::RemoveStopWords(const std::string_view& text) {
+	Log({ 0, WalRecordType::REMOVE_STOP_WORDS, 0, DocumentStatus::ACTUAL, {}, text });
+}
+
+void DurableSearchServer::Sync() {
+	wal_.Sync();
+}
+
+void DurableSearchServer::Checkpoint() {
+	wal_.Sync();
+	//снимок: номер последнего учтенного изменения и снимок сервера
+	std::ostringstream output;
+	std::string header;
+	AppendBinary(header, wal_.GetLastSequence());
+	output << header;
+	server_.SaveSnapshot(output);
+	WriteFileDurably(snapshot_path_, output.str());
+	//после падения здесь записи журнала с номерами из снимка пропускаются при восстановлении
+	wal_.Truncate();
+}
+
+const SearchServer& DurableSearchServer::GetServer() const {
+	return server_;
+}
+
+const RecoveryStats& DurableSearchServer::GetRecoveryStats() const {
+	return recovery_stats_;
+}
+
+void DurableSearchServer::Recover() {
+	std::ifstream snapshot(snapshot_path_, std::ios::binary);
+	if (snapshot) {
+		char header[sizeof(uint64_t)];
+		if (!snapshot.read(header, sizeof(header))) {
+			throw std::runtime_error("corrupted snapshot "s + snapshot_path_);
+		}
+		recovery_stats_.snapshot_sequence = BinaryReader(std::string_view{ header, sizeof(header) }).Read<uint64_t>();
+		server_.LoadSnapshot(snapshot);
+		recovery_stats_.snapshot_loaded = true;
+	}
+	recovery_stats_.discarded_bytes = wal_.GetDiscardedBytes();
+	wal_.Replay([this](const WalRecord& record) {
+		if (record.sequence <= recovery_stats_.snapshot_sequence) {
+			++recovery_stats_.skipped_records;
+			return;
+		}
+		try {
+			Apply(record);
+		} catch (const std::logic_error&) {
+			//сервер проверяет изменение до того, как его менять, и в том же состоянии отвергает его снова
+			++recovery_stats_.rejected_records;
+			return;
+		}
+		++recovery_stats_.replayed_records;
+	});
+	wal_.AdvanceSequence(recovery_stats_.snapshot_sequence);
+}
+
+void DurableSearchServer::Log(const WalRecord& record) {
+	wal_.Append(record);
+	Apply(record);
+}
+
+void DurableSearchServer::Apply(const WalRecord& record) {
+	switch (record.type) {
+	case WalRecordType::ADD_DOCUMENT:
+		server_.AddDocument(record.document_id, record.text, record.status, record.ratings);
+		break;
+	case WalRecordType::REMOVE_DOCUMENT:
+		server_.RemoveDocument(record.document_id);
+		break;
+	case WalRecordType::SET_STOP_WORDS:
+		server_.SetStopWords(record.text);
+		break;
+	case WalRecordType::REMOVE_STOP_WORDS:
+		server_.RemoveStopWords(record.text);
+		break;
+	default:
+		throw std::runtime_error("unknown log record type"s);
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Итоги восстановления при открытии
+struct RecoveryStats {
+	bool snapshot_loaded = false;
+	//номер последнего изменения, вошедшего в снимок
+	uint64_t snapshot_sequence = 0;
+	size_t replayed_records = 0;
+	//записи журнала, уже учтенные в снимке (падение между сохранением снимка и очисткой журнала)
+	size_t skipped_records = 0;
+	//записи изменений, которые сервер отверг и при записи (например, повторный id)
+	size_t rejected_records = 0;
+	size_t discarded_bytes = 0;
+};
+
+//Сервер, изменения которого переживают падение без повторной загрузки корпуса. В каталоге directory
+//лежат снимок индекса (snapshot) и журнал изменений после него (wal). При открытии загружается снимок
+//и повторяются записи журнала; Checkpoint сохраняет новый снимок и очищает журнал.
+//Изменение сначала записывается в журнал и только затем применяется к серверу: если запись не удалась,
+//сервер не меняется. Изменение, отвергнутое сервером (исключение), в журнале остается и при
+//восстановлении отвергается снова. На диске изменение надежно после сброса своей группы или Sync
+class DurableSearchServer {
+public:
+	//server - пустой сервер с нужными настройками (стоп-слова, позиционный индекс, модель ранжирования);
+	//индекс заменяется снимком, если он есть
+	DurableSearchServer(const std::string& directory, SearchServer server, const WriteAheadLogOptions& options = {});
+
+	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+		const std::vector<int>& ratings);
+
+	void RemoveDocument(int document_id);
+
+	void SetStopWords(const std::string_view& text);
+
+	void RemoveStopWords(const std::string_view& text);
+
+	//сброс всех записанных изменений на диск
+	void Sync();
+
+	//снимок индекса вместо журнала: журнал очищается после того, как снимок надежно записан
+	void Checkpoint();
+
+	const SearchServer& GetServer() const;
+
+	const RecoveryStats& GetRecoveryStats() const;
+
+private:
+	std::string snapshot_path_;
+	SearchServer server_;
+	RecoveryStats recovery_stats_;
+	WriteAheadLog wal_;
+
+	void Recover();
+
+	//запись в журнал, затем применение к серверу
+	void Log(const WalRecord& record);
+
+	void Apply(const WalRecord& record);
+};
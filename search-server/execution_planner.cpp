@@ -0,0 +1,73 @@
+#include "execution_planner.h"
+
+#include "search_server.h"
+
+#include <chrono>
+#include <execution>
+#include <string>
+#include <thread>
+
+using namespace std::string_literals;
+
+namespace {
+
+//лучшее время из нескольких повторов, в наносекундах
+template<typename ExecutionPolicy>
+double MeasureQuery(const SearchServer& search_server, const std::string& query, ExecutionPolicy policy) {
+	double best = std::numeric_limits<double>::max();
+	for (int repetition = 0; repetition < 3; ++repetition) {
+		const auto start = std::chrono::steady_clock::now();
+		search_server.FindTopDocuments(policy, query);
+		const auto duration = std::chrono::steady_clock::now() - start;
+		best = std::min(best, static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+	}
+	return best;
+}
+
+}
+
+ExecutionPlan ExecutionPlanner::Choose(size_t plus_word_count, size_t total_postings) const {
+	if (plus_word_count > 0 && parallel_min_postings != std::numeric_limits<size_t>::max()
+		&& total_postings >= parallel_min_postings) {
+		return ExecutionPlan::RANGE_PARALLEL;
+	}
+	return ExecutionPlan::SEQUENTIAL;
+}
+
+ExecutionPlanner ExecutionPlanner::Calibrate() {
+	ExecutionPlanner planner;
+	if (std::thread::hardware_concurrency() < 2) {
+		return planner;
+	}
+	//все слова во всех документах: объем вхождений запроса растет на document_count с каждым словом
+	constexpr int document_count = 16384;
+	constexpr int word_count = 16;
+	std::string text;
+	for (int word = 0; word < word_count; ++word) {
+		text += " w"s + std::to_string(word);
+	}
+	SearchServer search_server(""s);
+	for (int id = 0; id < document_count; ++id) {
+		search_server.AddDocument(id, text, DocumentStatus::ACTUAL, { 0 });
+	}
+	//запросы по возрастанию объема вхождений: первый, на котором par быстрее seq, задает порог
+	std::string query;
+	size_t postings = 0;
+	for (int word = 0; word < word_count; ++word) {
+		query += " w"s + std::to_string(word);
+		postings += document_count;
+		if (MeasureQuery(search_server, query, std::execution::par) < MeasureQuery(search_server, query, std::execution::seq)) {
+			planner.parallel_min_postings = postings;
+			break;
+		}
+	}
+	return planner;
+}
+
+ExecutionPlanner ExecutionPlanner::GetDefault() {
+	ExecutionPlanner planner;
+	if (std::thread::hardware_concurrency() >= 2) {
+		planner.parallel_min_postings = DEFAULT_PARALLEL_MIN_POSTINGS;
+	}
+	return planner;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+
+//Политика выполнения, которая выбирается для каждого запроса по оценке его стоимости:
+//server.FindTopDocuments(adaptive_policy, "query")
+struct AdaptivePolicy {
+};
+
+inline constexpr AdaptivePolicy adaptive_policy{};
+
+//План выполнения поискового запроса
+enum class ExecutionPlan { SEQUENTIAL, RANGE_PARALLEL };
+
+//Порог параллельного подсчета по умолчанию: объем вхождений на две части по MIN_RANGE_WORK.
+//Меньший запрос все равно считается одной частью, и параллельный план только добавляет накладные расходы
+constexpr size_t DEFAULT_PARALLEL_MIN_POSTINGS = 65536;
+
+//Выбор плана по длинам списков вхождений плюс-слов. Параллельный подсчет по частям пространства
+//документов окупается только при большом объеме вхождений; порог фиксирован (GetDefault)
+//или подбирается замером (Calibrate)
+struct ExecutionPlanner {
+	//наименьшее суммарное число вхождений плюс-слов, при котором выгоден параллельный подсчет;
+	//максимальное значение - никогда
+	size_t parallel_min_postings = std::numeric_limits<size_t>::max();
+
+	ExecutionPlan Choose(size_t plus_word_count, size_t total_postings) const;
+
+	//замер на синтетическом индексе: сравнение seq и par на запросах растущего объема.
+	//Строит индекс из 16384 документов и выполняет до 96 запросов, порог зависит от загрузки машины,
+	//поэтому вызывается явно при запуске: server.SetExecutionPlanner(ExecutionPlanner::Calibrate()).
+	//На машине с одним потоком параллельный план не выбирается никогда
+	static ExecutionPlanner Calibrate();
+
+	//план без замера: порог DEFAULT_PARALLEL_MIN_POSTINGS, на машине с одним потоком - никогда
+	static ExecutionPlanner GetDefault();
+};
@@ -0,0 +1,81 @@
+#include "forward_index.h"
+#include "memory_stats.h"
+
+#include <algorithm>
+
+void ForwardIndex::Add(int slot, const std::vector<ForwardEntry>& entries) {
+	ranges_.resize(slot + 1, Range{ pool_.size(), 0 });
+	ranges_[slot] = { pool_.size(), static_cast<uint32_t>(entries.size()) };
+	pool_.insert(pool_.end(), entries.begin(), entries.end());
+}
+
+void ForwardIndex::Remove(int slot) {
+	if (static_cast<size_t>(slot) >= ranges_.size()) {
+		return;
+	}
+	garbage_ += ranges_[slot].size;
+	ranges_[slot].size = 0;
+	if (garbage_ > pool_.size() - garbage_) {
+		Compact();
+	}
+}
+
+void ForwardIndex::Replace(int slot, const std::vector<ForwardEntry>& entries) {
+	Range& range = ranges_[slot];
+	if (entries.size() <= range.size) {
+		std::copy(entries.begin(), entries.end(), pool_.begin() + range.begin);
+		garbage_ += range.size - entries.size();
+		range.size = static_cast<uint32_t>(entries.size());
+	} else {
+		garbage_ += range.size;
+		range = { pool_.size(), static_cast<uint32_t>(entries.size()) };
+		pool_.insert(pool_.end(), entries.begin(), entries.end());
+	}
+	if (garbage_ > pool_.size() - garbage_) {
+		Compact();
+	}
+}
+
+void ForwardIndex::Clear() {
+	pool_.clear();
+	pool_.shrink_to_fit();
+	ranges_.clear();
+	ranges_.shrink_to_fit();
+	garbage_ = 0;
+}
+
+const ForwardEntry* ForwardIndex::begin(int slot) const {
+	return static_cast<size_t>(slot) < ranges_.size() ? pool_.data() + ranges_[slot].begin : nullptr;
+}
+
+const ForwardEntry* ForwardIndex::end(int slot) const {
+	return static_cast<size_t>(slot) < ranges_.size() ? pool_.data() + ranges_[slot].begin + ranges_[slot].size : nullptr;
+}
+
+void ForwardIndex::ShrinkToFit() {
+	if (garbage_ > 0) {
+		Compact();
+	}
+	pool_.shrink_to_fit();
+	ranges_.shrink_to_fit();
+}
+
+size_t ForwardIndex::GetMemoryUsage() const {
+	return sizeof(*this) + GetHeapSize(pool_) + GetHeapSize(ranges_);
+}
+
+size_t ForwardIndex::GetAddGrowthSize(int slot, size_t entry_count) const {
+	return GetGrowthSize(pool_, entry_count) + GetGrowthSize(ranges_, slot + 1 - std::min<size_t>(ranges_.size(), slot + 1));
+}
+
+void ForwardIndex::Compact() {
+	std::vector<ForwardEntry> pool;
+	pool.reserve(pool_.size() - garbage_);
+	for (Range& range : ranges_) {
+		const size_t begin = pool.size();
+		pool.insert(pool.end(), pool_.begin() + range.begin, pool_.begin() + range.begin + range.size);
+		range.begin = begin;
+	}
+	pool_ = std::move(pool);
+	garbage_ = 0;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//Слово документа в прямом индексе: номер слова и число его вхождений в документ
+struct ForwardEntry {
+	uint32_t term_id;
+	uint32_t word_count;
+};
+
+//Прямой индекс: для каждого документа (по плотному номеру) массив ForwardEntry по возрастанию term_id.
+//Все массивы лежат подряд в одном пуле; место удаленных документов освобождается уплотнением пула,
+//когда мусора становится больше, чем живых записей
+class ForwardIndex {
+public:
+	//документы добавляются по возрастанию номера без пропусков
+	void Add(int slot, const std::vector<ForwardEntry>& entries);
+
+	void Remove(int slot);
+
+	//замена слов уже добавленного документа; меньший массив пишется на место старого, больший - в конец пула
+	void Replace(int slot, const std::vector<ForwardEntry>& entries);
+
+	void Clear();
+
+	//уплотнение пула и освобождение запаса емкости
+	void ShrinkToFit();
+
+	const ForwardEntry* begin(int slot) const;
+
+	const ForwardEntry* end(int slot) const;
+
+	size_t GetMemoryUsage() const;
+
+	//прирост памяти при добавлении документа из entry_count слов
+	size_t GetAddGrowthSize(int slot, size_t entry_count) const;
+
+private:
+	struct Range {
+		size_t begin;
+		uint32_t size;
+	};
+	std::vector<ForwardEntry> pool_;
+	std::vector<Range> ranges_;
+	size_t garbage_ = 0;
+
+	void Compact();
+};
+
+//Легкое представление частот слов документа (TF): пары <слово, TF> в порядке номеров слов.
+//Ссылается на данные сервера и действительно до его изменения; если прямой индекс не хранится,
+//держит восстановленный массив у себя
+class WordFrequencies {
+public:
+	class Iterator {
+	public:
+		using value_type = std::pair<std::string_view, double>;
+		using difference_type = std::ptrdiff_t;
+		using reference = value_type;
+		using pointer = void;
+		using iterator_category = std::input_iterator_tag;
+
+		Iterator(const ForwardEntry* entry, const WordFrequencies* owner)
+			: entry_(entry), owner_(owner) {
+		}
+
+		value_type operator*() const {
+			return { (*owner_->term_words_)[entry_->term_id], owner_->ComputeTermFreq(entry_->word_count) };
+		}
+		Iterator& operator++() {
+			++entry_;
+			return *this;
+		}
+		bool operator==(const Iterator& other) const {
+			return entry_ == other.entry_;
+		}
+		bool operator!=(const Iterator& other) const {
+			return entry_ != other.entry_;
+		}
+
+	private:
+		const ForwardEntry* entry_;
+		const WordFrequencies* owner_;
+	};
+
+	WordFrequencies() = default;
+
+	WordFrequencies(const ForwardEntry* begin, const ForwardEntry* end,
+		const std::vector<std::string_view>* term_words, int document_length)
+		: begin_(begin), end_(end), term_words_(term_words), document_length_(document_length) {
+	}
+
+	WordFrequencies(std::vector<ForwardEntry> entries,
+		const std::vector<std::string_view>* term_words, int document_length)
+		: owned_(std::move(entries)), term_words_(term_words), document_length_(document_length) {
+		begin_ = owned_.data();
+		end_ = owned_.data() + owned_.size();
+	}
+
+	WordFrequencies(const WordFrequencies& other) {
+		*this = other;
+	}
+
+	WordFrequencies& operator=(const WordFrequencies& other) {
+		owned_ = other.owned_;
+		term_words_ = other.term_words_;
+		document_length_ = other.document_length_;
+		if (owned_.empty()) {
+			begin_ = other.begin_;
+			end_ = other.end_;
+		} else {
+			begin_ = owned_.data();
+			end_ = owned_.data() + owned_.size();
+		}
+		return *this;
+	}
+
+	Iterator begin() const {
+		return { begin_, this };
+	}
+	Iterator end() const {
+		return { end_, this };
+	}
+	size_t size() const {
+		return end_ - begin_;
+	}
+	bool empty() const {
+		return begin_ == end_;
+	}
+
+	//записи прямого индекса документа по возрастанию term_id
+	std::pair<const ForwardEntry*, const ForwardEntry*> GetEntries() const {
+		return { begin_, end_ };
+	}
+
+	operator std::map<std::string_view, double>() const {
+		std::map<std::string_view, double> result;
+		for (const auto [word, term_freq] : *this) {
+			result.emplace(word, term_freq);
+		}
+		return result;
+	}
+
+private:
+	std::vector<ForwardEntry> owned_;
+	const ForwardEntry* begin_ = nullptr;
+	const ForwardEntry* end_ = nullptr;
+	const std::vector<std::string_view>* term_words_ = nullptr;
+	int document_length_ = 0;
+
+	//TF той же формулой, что и вес вхождения при поиске (число вхождений, деленное на длину)
+	double ComputeTermFreq(uint32_t word_count) const {
+		return static_cast<double>(word_count) / document_length_;
+	}
+};
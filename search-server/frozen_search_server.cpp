@@ -0,0 +1,186 @@
+#include "frozen_search_server.h"
+#include "memory_stats.h"
+#include "string_processing.h"
+
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+FrozenSearchServer::FrozenSearchServer(const SearchServer& server)
+	: stop_words_(server.stop_words_.begin(), server.stop_words_.end())
+	, weight_form_(server.GetPostingWeightForm())
+	, kernel_(GetScoringKernel(server.GetDocumentCount()))
+	, prefix_expansion_limit_(server.prefix_expansion_limit_)
+	, boolean_queries_enabled_(server.boolean_queries_enabled_) {
+	//удаленные документы выбрасываются, остальные нумеруются подряд в прежнем порядке,
+	//поэтому кандидаты просматриваются в том же порядке, что и у сервера
+	std::vector<int> slot_map(server.slot_ids_.size(), -1);
+	for (size_t slot = 0; slot < server.slot_ids_.size(); ++slot) {
+		if (server.slot_ids_[slot] < 0) {
+			continue;
+		}
+		slot_map[slot] = static_cast<int>(slot_ids_.size());
+		slot_ids_.push_back(server.slot_ids_[slot]);
+		slot_ratings_.push_back(server.slot_ratings_[slot]);
+		slot_statuses_.push_back(server.slot_statuses_[slot]);
+		slot_norms_.push_back(server.slot_norms_[slot]);
+	}
+	document_ids_ = server.document_ids_;
+
+	size_t posting_count = 0;
+	for (const auto& [word, postings] : server.word_to_document_freqs_) {
+		posting_count += postings.slots.size();
+	}
+	posting_slots_.reserve(posting_count);
+	posting_word_counts_.reserve(posting_count);
+	posting_offsets_.push_back(0);
+	term_offsets_.push_back(0);
+	for (const auto& [word, postings] : server.word_to_document_freqs_) {
+		//слова удаленных документов остаются в сервере с пустыми списками, в словарь они не попадают
+		if (postings.slots.empty()) {
+			continue;
+		}
+		term_bytes_ += word;
+		term_offsets_.push_back(term_bytes_.size());
+		for (size_t i = 0; i < postings.slots.size(); ++i) {
+			posting_slots_.push_back(slot_map[postings.slots[i]]);
+			posting_word_counts_.push_back(postings.word_counts[i]);
+		}
+		posting_offsets_.push_back(posting_slots_.size());
+		term_weights_.push_back(server.scorer_->TermWeight(server.GetDocumentCount(), postings.slots.size()));
+	}
+}
+
+std::vector<Document> FrozenSearchServer::FindTopDocuments(const std::string_view& raw_query) const {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> FrozenSearchServer::FindTopDocuments(const std::string_view& raw_query,
+	DocumentStatus filter_status) const {
+	return FindTopDocuments(raw_query,
+		[filter_status](int document_id, DocumentStatus status, int rating) { return status == filter_status; });
+}
+
+size_t FrozenSearchServer::GetDocumentCount() const {
+	return document_ids_.size();
+}
+
+std::vector<int>::const_iterator FrozenSearchServer::begin() const {
+	return document_ids_.begin();
+}
+
+std::vector<int>::const_iterator FrozenSearchServer::end() const {
+	return document_ids_.end();
+}
+
+size_t FrozenSearchServer::GetMemoryUsage() const {
+	size_t bytes = sizeof(*this) + GetHeapSize(term_bytes_) + GetHeapSize(term_offsets_) + GetHeapSize(posting_offsets_)
+		+ GetHeapSize(posting_slots_) + GetHeapSize(posting_word_counts_) + GetHeapSize(term_weights_)
+		+ GetHeapSize(stop_words_) + GetHeapSize(slot_ids_) + GetHeapSize(slot_ratings_) + GetHeapSize(slot_statuses_)
+		+ GetHeapSize(slot_norms_) + GetHeapSize(document_ids_);
+	for (const std::string& word : stop_words_) {
+		bytes += GetHeapSize(word);
+	}
+	return bytes;
+}
+
+size_t FrozenSearchServer::GetTermCount() const {
+	return term_weights_.size();
+}
+
+std::string_view FrozenSearchServer::GetTerm(size_t id) const {
+	return std::string_view{ term_bytes_ }.substr(term_offsets_[id], term_offsets_[id + 1] - term_offsets_[id]);
+}
+
+size_t FrozenSearchServer::LowerBound(std::string_view word) const {
+	size_t first = 0;
+	size_t count = GetTermCount();
+	while (count > 0) {
+		const size_t half = count / 2;
+		if (GetTerm(first + half) < word) {
+			first += half + 1;
+			count -= half + 1;
+		} else {
+			count = half;
+		}
+	}
+	return first;
+}
+
+bool FrozenSearchServer::IsStopWord(std::string_view word) const {
+	const auto it = std::lower_bound(stop_words_.begin(), stop_words_.end(), word,
+		[](const std::string& stop_word, std::string_view value) { return stop_word < value; });
+	return it != stop_words_.end() && *it == word;
+}
+
+FrozenSearchServer::Query FrozenSearchServer::ParseQuery(const std::string_view& raw_query) const {
+	Query query;
+	for (std::string_view word : SplitIntoWordsView(raw_query)) {
+		//те же проверки и сообщения, что у SearchServer::ParseQueryWord
+		if (!IsValidWord(word)) {
+			throw std::invalid_argument("control character in query words"s);
+		}
+		//без логических запросов у сервера операторы - обычные слова, как и у него
+		if (boolean_queries_enabled_ && (word == "AND" || word == "OR" || word == "NOT" || word[0] == '+'
+			|| word[0] == '(' || word.back() == ')' || word.substr(0, 2) == "-(")) {
+			throw std::invalid_argument("boolean query is not supported by frozen index"s);
+		}
+		bool is_minus = false;
+		if (word[0] == '-') {
+			is_minus = true;
+			word.remove_prefix(1);
+			if (word.empty()) {
+				throw std::invalid_argument("no characters after \"-\" in query"s);
+			}
+			if (word[0] == '-') {
+				throw std::invalid_argument("double \"-\" in query minus-word"s);
+			}
+		}
+		std::vector<uint32_t>& terms = is_minus ? query.minus_terms : query.plus_terms;
+		if (word.back() == '*') {
+			word.remove_suffix(1);
+			if (word.empty()) {
+				throw std::invalid_argument("no characters before \"*\" in query"s);
+			}
+			//префикс раскрывается и для стоп-слова, как у сервера
+			size_t id = LowerBound(word);
+			for (size_t found = 0; id < GetTermCount() && found < prefix_expansion_limit_; ++id, ++found) {
+				if (GetTerm(id).substr(0, word.size()) != word) {
+					break;
+				}
+				terms.push_back(static_cast<uint32_t>(id));
+			}
+			continue;
+		}
+		if (IsStopWord(word)) {
+			continue;
+		}
+		const size_t id = LowerBound(word);
+		if (id < GetTermCount() && GetTerm(id) == word) {
+			terms.push_back(static_cast<uint32_t>(id));
+		}
+	}
+	for (std::vector<uint32_t>* terms : { &query.plus_terms, &query.minus_terms }) {
+		std::sort(terms->begin(), terms->end());
+		terms->erase(std::unique(terms->begin(), terms->end()), terms->end());
+	}
+	return query;
+}
+
+const IndexVector<double>& FrozenSearchServer::AccumulateRelevance(const Query& query) const {
+	thread_local IndexVector<double> accumulator;
+	//-0.0 - документ не затронут запросом (см. SearchServer::AccumulateRelevance);
+	//слова идут по алфавиту, как у сервера, поэтому баллы совпадают побитово
+	accumulator.assign(slot_ids_.size(), -0.0);
+	for (const uint32_t term : query.plus_terms) {
+		const size_t first = posting_offsets_[term];
+		kernel_(posting_slots_.data() + first, posting_word_counts_.data() + first,
+			posting_offsets_[term + 1] - first, slot_norms_.data(), weight_form_, term_weights_[term], accumulator.data());
+	}
+	for (const uint32_t term : query.minus_terms) {
+		for (size_t i = posting_offsets_[term]; i < posting_offsets_[term + 1]; ++i) {
+			accumulator[posting_slots_[i]] = -0.0;
+		}
+	}
+	return accumulator;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "document.h"
+#include "huge_pages.h"
+#include "scoring_kernels.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Неизменяемый индекс для реплик, которые после загрузки только ищут. Списки вхождений всех слов
+//лежат подряд в общих массивах, словарь - отсортированные слова в одной строке, веса слов (IDF)
+//посчитаны заранее. Общие данные на пути запроса только читаются: нет ни мьютексов, ни атомарных
+//переменных, ни метрик, ни ленивых кэшей, аккумулятор у каждого потока свой. Поэтому один объект
+//можно без синхронизации использовать из любого числа потоков.
+//Запросы - как у сервера без позиционного индекса и нечеткого поиска: плюс- и минус-слова и префиксы
+//"connect*"; логические операторы, скобки и обязательные слова - std::invalid_argument.
+//Релевантность совпадает с FindTopDocuments исходного сервера побитово
+class FrozenSearchServer {
+public:
+	//снимок текущего состояния сервера; дальнейшие изменения сервера на него не влияют
+	explicit FrozenSearchServer(const SearchServer& server);
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus filter_status) const;
+
+	template <typename Predic>
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, Predic predic) const;
+
+	size_t GetDocumentCount() const;
+
+	std::vector<int>::const_iterator begin() const;
+
+	std::vector<int>::const_iterator end() const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	//слова запроса номерами словаря по возрастанию (то есть по алфавиту), слова вне индекса отброшены
+	struct Query {
+		std::vector<uint32_t> plus_terms;
+		std::vector<uint32_t> minus_terms;
+	};
+
+	//словарь: слова с вхождениями по возрастанию подряд, term_offsets_[id] - начало слова id
+	std::string term_bytes_;
+	std::vector<size_t> term_offsets_;
+	//вхождения слова id - [posting_offsets_[id], posting_offsets_[id + 1]) в posting_slots_ и posting_word_counts_;
+	//общие массивы вхождений и колонки документов выделяются с учетом SetHugePageMode
+	std::vector<size_t> posting_offsets_;
+	IndexVector<int> posting_slots_;
+	IndexVector<int> posting_word_counts_;
+	//вес слова по модели ранжирования сервера
+	std::vector<double> term_weights_;
+	//стоп-слова по возрастанию
+	std::vector<std::string> stop_words_;
+	//колонки документов по плотному номеру; номера удаленных документов не занимают места
+	IndexVector<int> slot_ids_;
+	IndexVector<int> slot_ratings_;
+	IndexVector<DocumentStatus> slot_statuses_;
+	IndexVector<double> slot_norms_;
+	//id документов в порядке их добавления
+	std::vector<int> document_ids_;
+	PostingWeightForm weight_form_;
+	//ядро подсчета выбирается при построении по числу документов, запрос не проверяет однократную инициализацию
+	AccumulateTermRelevanceKernel kernel_;
+	size_t prefix_expansion_limit_;
+	//логические запросы включены у исходного сервера; замороженный индекс их не выполняет
+	bool boolean_queries_enabled_;
+
+	size_t GetTermCount() const;
+
+	std::string_view GetTerm(size_t id) const;
+
+	//номер первого слова, не меньшего word (GetTermCount(), если такого нет)
+	size_t LowerBound(std::string_view word) const;
+
+	bool IsStopWord(std::string_view word) const;
+
+	Query ParseQuery(const std::string_view& raw_query) const;
+
+	//релевантность по плотным номерам в аккумуляторе потока; -0.0 - документ не найден
+	const IndexVector<double>& AccumulateRelevance(const Query& query) const;
+};
+
+template <typename Predic>
+std::vector<Document> FrozenSearchServer::FindTopDocuments(const std::string_view& raw_query, Predic predic) const {
+	const IndexVector<double>& accumulator = AccumulateRelevance(ParseQuery(raw_query));
+	std::vector<Document> result;
+	for (size_t slot = 0; slot < accumulator.size(); ++slot) {
+		const double relevance = accumulator[slot];
+		if (std::signbit(relevance)) {
+			continue;
+		}
+		const Document document{ slot_ids_[slot], relevance, slot_ratings_[slot] };
+		if (predic(document.id, slot_statuses_[slot], document.rating)) {
+			result.push_back(document);
+		}
+	}
+	//тот же отбор, что у сервера, чтобы документы с равной релевантностью шли в том же порядке
+	if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
+		std::partial_sort(result.begin(), result.begin() + MAX_RESULT_DOCUMENT_COUNT, result.end(), IsMoreRelevant);
+		result.resize(MAX_RESULT_DOCUMENT_COUNT);
+	}
+	std::sort(result.begin(), result.end(), IsMoreRelevant);
+	return result;
+}
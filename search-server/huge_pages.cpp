@@ -0,0 +1,124 @@
+#include "huge_pages.h"
+#include "memory_stats.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include <sys/mman.h>
+
+namespace {
+
+//Заголовок большого выделения: режим, в котором блок выделен, и длина отображения.
+//Освобождение и учет памяти читают их отсюда, а не текущий режим, который мог смениться.
+//Заголовок занимает строку кэша, поэтому данные за ним выровнены по ней
+struct BlockHeader {
+	HugePageMode mode;
+	size_t length;
+};
+
+constexpr size_t HEADER_SIZE = 64;
+
+static_assert(sizeof(BlockHeader) <= HEADER_SIZE);
+
+std::atomic<HugePageMode> huge_page_mode{ HugePageMode::OFF };
+
+size_t RoundUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void* MapExplicitHugePages(size_t length) {
+#ifdef MAP_HUGETLB
+	void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (mapping != MAP_FAILED) {
+		return mapping;
+	}
+#endif
+	return nullptr;
+}
+
+//отображение с запасом в одну большую страницу, от которого отрезаются края до выровненной области
+void* MapTransparentHugePages(size_t length) {
+	void* raw = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED) {
+		throw std::bad_alloc();
+	}
+	const uintptr_t begin = reinterpret_cast<uintptr_t>(raw);
+	const uintptr_t aligned = RoundUp(begin, HUGE_PAGE_SIZE);
+	if (aligned > begin) {
+		munmap(raw, aligned - begin);
+	}
+	const size_t tail = begin + length + HUGE_PAGE_SIZE - (aligned + length);
+	if (tail > 0) {
+		munmap(reinterpret_cast<void*>(aligned + length), tail);
+	}
+	void* mapping = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+	//отказ (ядро без THP) не ошибка: память просто останется на обычных страницах
+	madvise(mapping, length, MADV_HUGEPAGE);
+#endif
+	return mapping;
+}
+
+} // namespace
+
+void SetHugePageMode(HugePageMode mode) {
+	huge_page_mode.store(mode, std::memory_order_relaxed);
+}
+
+HugePageMode GetHugePageMode() {
+	return huge_page_mode.load(std::memory_order_relaxed);
+}
+
+void* AllocateIndexMemory(size_t bytes) {
+	if (bytes < HUGE_PAGE_SIZE) {
+		return ::operator new(bytes);
+	}
+	BlockHeader header{ GetHugePageMode(), 0 };
+	void* block = nullptr;
+	if (header.mode == HugePageMode::OFF) {
+		block = ::operator new(bytes + HEADER_SIZE, std::align_val_t{ HEADER_SIZE });
+	} else {
+		header.length = RoundUp(bytes + HEADER_SIZE, HUGE_PAGE_SIZE);
+		if (header.mode == HugePageMode::EXPLICIT) {
+			block = MapExplicitHugePages(header.length);
+		}
+		if (block == nullptr) {
+			header.mode = HugePageMode::TRANSPARENT;
+			block = MapTransparentHugePages(header.length);
+		}
+	}
+	*static_cast<BlockHeader*>(block) = header;
+	return static_cast<char*>(block) + HEADER_SIZE;
+}
+
+void DeallocateIndexMemory(void* data, size_t bytes) {
+	if (bytes < HUGE_PAGE_SIZE) {
+		::operator delete(data);
+		return;
+	}
+	void* block = static_cast<char*>(data) - HEADER_SIZE;
+	const BlockHeader header = *static_cast<const BlockHeader*>(block);
+	if (header.mode == HugePageMode::OFF) {
+		::operator delete(block, std::align_val_t{ HEADER_SIZE });
+	} else {
+		munmap(block, header.length);
+	}
+}
+
+size_t GetIndexAllocationSize(size_t bytes) {
+	if (bytes < HUGE_PAGE_SIZE) {
+		return GetAllocationSize(bytes);
+	}
+	if (GetHugePageMode() == HugePageMode::OFF) {
+		return GetAllocationSize(bytes + HEADER_SIZE);
+	}
+	return RoundUp(bytes + HEADER_SIZE, HUGE_PAGE_SIZE);
+}
+
+size_t GetIndexAllocationSize(const void* data, size_t bytes) {
+	if (data == nullptr || bytes < HUGE_PAGE_SIZE) {
+		return GetAllocationSize(bytes);
+	}
+	const BlockHeader& header = *reinterpret_cast<const BlockHeader*>(static_cast<const char*>(data) - HEADER_SIZE);
+	return header.mode == HugePageMode::OFF ? GetAllocationSize(bytes + HEADER_SIZE) : header.length;
+}
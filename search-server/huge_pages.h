@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+//Выделение больших массивов индекса (колонки документов, аккумулятор релевантности, общие массивы
+//вхождений замороженного индекса). Доступ к ним по номеру документа случаен, и при индексе в гигабайты
+//промахи TLB на обычных 4-килобайтных страницах занимают заметную часть подсчета релевантности
+enum class HugePageMode {
+	//обычные страницы (по умолчанию)
+	OFF,
+	//прозрачные большие страницы: область выровнена по HUGE_PAGE_SIZE и помечена madvise(MADV_HUGEPAGE)
+	TRANSPARENT,
+	//явные большие страницы mmap(MAP_HUGETLB) из пула ядра (vm.nr_hugepages); если пул исчерпан - как TRANSPARENT
+	EXPLICIT,
+};
+
+constexpr size_t HUGE_PAGE_SIZE = size_t{ 2 } << 20;
+
+//Режим для следующих выделений; уже выделенные массивы остаются как есть, поэтому режим
+//стоит задать до заполнения индекса
+void SetHugePageMode(HugePageMode mode);
+
+HugePageMode GetHugePageMode();
+
+//Массив меньше HUGE_PAGE_SIZE выделяется обычным operator new в любом режиме. Большой - с заголовком,
+//по которому освобождение узнает, как он был выделен: при OFF выровненным operator new, иначе отдельным
+//отображением памяти. Данные большого массива выровнены по строке кэша (64 байта)
+void* AllocateIndexMemory(size_t bytes);
+
+void DeallocateIndexMemory(void* data, size_t bytes);
+
+//память, которую займет новое выделение bytes байт в текущем режиме (с заголовком и округлением)
+size_t GetIndexAllocationSize(size_t bytes);
+
+//память, которую занимает уже выделенный массив data из bytes байт (по режиму из его заголовка)
+size_t GetIndexAllocationSize(const void* data, size_t bytes);
+
+//Распределитель для std::vector поверх AllocateIndexMemory; все экземпляры взаимозаменяемы
+template <typename Type>
+class HugePageAllocator {
+public:
+	using value_type = Type;
+
+	HugePageAllocator() = default;
+
+	template <typename Other>
+	HugePageAllocator(const HugePageAllocator<Other>&) {
+	}
+
+	Type* allocate(size_t count) {
+		if (count > static_cast<size_t>(-1) / sizeof(Type)) {
+			throw std::bad_array_new_length();
+		}
+		return static_cast<Type*>(AllocateIndexMemory(count * sizeof(Type)));
+	}
+
+	void deallocate(Type* data, size_t count) {
+		DeallocateIndexMemory(data, count * sizeof(Type));
+	}
+};
+
+template <typename Type, typename Other>
+bool operator==(const HugePageAllocator<Type>&, const HugePageAllocator<Other>&) {
+	return true;
+}
+
+template <typename Type, typename Other>
+bool operator!=(const HugePageAllocator<Type>&, const HugePageAllocator<Other>&) {
+	return false;
+}
+
+template <typename Type>
+using IndexVector = std::vector<Type, HugePageAllocator<Type>>;
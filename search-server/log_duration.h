@@ -2,6 +2,8 @@
 
 #include <chrono>
 #include <iostream>
+#include <string>
+#include <string_view>
 
 #define PROFILE_CONCAT_INTERNAL(X, Y) X##Y
 #define PROFILE_CONCAT(X, Y) PROFILE_CONCAT_INTERNAL(X, Y)
@@ -15,10 +17,10 @@ public:
 	// с помощью using для удобства
 	using Clock = std::chrono::steady_clock;
 
-	LogDuration(const std::string& id)
+	LogDuration(std::string_view id)
 		: id_(id), out_(std::cerr) {
 	}
-	LogDuration(const std::string& id, std::ostream& out)
+	LogDuration(std::string_view id, std::ostream& out)
 		: id_(id), out_(out) {
 	}
 
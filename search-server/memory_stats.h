@@ -0,0 +1,93 @@
+#pragma once
+
+#include "huge_pages.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//Размер блока в куче по модели распределителя glibc: запрошенный размер и 8 байт заголовка,
+//выровненные до 16, но не меньше 32
+inline size_t GetAllocationSize(size_t bytes) {
+	return bytes == 0 ? 0 : std::max<size_t>(32, (bytes + 8 + 15) & ~size_t{ 15 });
+}
+
+//узел std::map или std::set: цвет и три указателя перед значением
+template <typename Value>
+size_t GetTreeNodeSize() {
+	return GetAllocationSize(4 * sizeof(void*) + sizeof(Value));
+}
+
+//буфер вектора емкости capacity
+template <typename Type, typename Allocator>
+size_t GetBufferSize(const std::vector<Type, Allocator>& values, size_t capacity) {
+	return GetAllocationSize(capacity * sizeof(Type));
+}
+
+//текущий буфер учитывается по режиму, в котором он выделен, новый - по текущему режиму
+template <typename Type>
+size_t GetBufferSize(const IndexVector<Type>& values, size_t capacity) {
+	if (capacity == values.capacity()) {
+		return GetIndexAllocationSize(values.data(), capacity * sizeof(Type));
+	}
+	return GetIndexAllocationSize(capacity * sizeof(Type));
+}
+
+//буфер вектора по его емкости
+template <typename Type, typename Allocator>
+size_t GetHeapSize(const std::vector<Type, Allocator>& values) {
+	return GetBufferSize(values, values.capacity());
+}
+
+//короткая строка хранится внутри объекта и в куче места не занимает
+inline size_t GetHeapSize(const std::string& text) {
+	const char* data = text.data();
+	const char* object = reinterpret_cast<const char*>(&text);
+	return data >= object && data < object + sizeof(text) ? 0 : GetAllocationSize(text.capacity() + 1);
+}
+
+//строка длины length, созданная из string_view: емкость по длине, если не помещается в объект
+inline size_t GetStringHeapSize(size_t length) {
+	static const size_t local_capacity = std::string{}.capacity();
+	return length <= local_capacity ? 0 : GetAllocationSize(length + 1);
+}
+
+//прирост буфера вектора при добавлении added элементов (емкость растет вдвое, как в libstdc++)
+template <typename Type, typename Allocator>
+size_t GetGrowthSize(const std::vector<Type, Allocator>& values, size_t added) {
+	if (values.size() + added <= values.capacity()) {
+		return 0;
+	}
+	const size_t capacity = std::max(values.size() + added, 2 * values.capacity());
+	return GetBufferSize(values, capacity) - GetHeapSize(values);
+}
+
+//Память сервера в байтах по структурам, с узлами деревьев и заголовками блоков кучи
+struct MemoryStats {
+	//стоп-слова и слова документов (std::set<std::string>)
+	size_t stop_words = 0;
+	size_t words = 0;
+	//списки вхождений (узлы словаря и массивы номеров и чисел вхождений)
+	size_t postings = 0;
+	//слова по номерам
+	size_t term_words = 0;
+	size_t forward_index = 0;
+	//id документа - рейтинг, статус, номер
+	size_t documents = 0;
+	size_t document_ids = 0;
+	//колонки данных документов по плотному номеру (id, рейтинг, статус, длина, норма)
+	size_t slot_columns = 0;
+	size_t positions = 0;
+	//вхождения слов, ставших стоп-словами после индексации
+	size_t stopped_postings = 0;
+	//словарь для префиксов и нечеткого поиска, если построен
+	size_t term_dictionary = 0;
+	//сам объект сервера
+	size_t object = 0;
+
+	size_t GetTotal() const {
+		return stop_words + words + postings + term_words + forward_index + documents + document_ids + slot_columns
+			+ positions + stopped_postings + term_dictionary + object;
+	}
+};
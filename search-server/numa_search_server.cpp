@@ -0,0 +1,214 @@
+#include "numa_search_server.h"
+
+#include <algorithm>
+
+namespace {
+
+int64_t SteadyNanoseconds() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+NumaNodeShard::NumaNodeShard(const NumaTopology& topology, size_t node, const std::string_view& stop_words)
+	: node_id_(topology.GetNodes().at(node).id)
+	, server_(stop_words)
+	, stats_start_nanoseconds_(SteadyNanoseconds()) {
+	const size_t worker_count = std::clamp<size_t>(topology.GetNodes()[node].cpus.size(), 1, MAX_THREADS);
+	for (size_t i = 0; i < worker_count; ++i) {
+		workers_.emplace_back([this, topology, node]() { WorkerLoop(topology, node); });
+	}
+}
+
+NumaNodeShard::~NumaNodeShard() {
+	{
+		std::lock_guard guard(tasks_mutex_);
+		stopping_ = true;
+	}
+	tasks_cv_.notify_all();
+	for (std::thread& worker : workers_) {
+		worker.join();
+	}
+}
+
+void NumaNodeShard::AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	Run([&]() {
+		std::unique_lock lock(server_mutex_);
+		server_.AddDocument(document_id, document, status, ratings);
+		return 0;
+	});
+}
+
+void NumaNodeShard::RemoveDocument(int document_id) {
+	Run([&]() {
+		std::unique_lock lock(server_mutex_);
+		server_.RemoveDocument(document_id);
+		return 0;
+	});
+}
+
+size_t NumaNodeShard::GetDocumentCount() const {
+	std::shared_lock lock(server_mutex_);
+	return server_.GetDocumentCount();
+}
+
+CorpusStatistics NumaNodeShard::GetQueryStatistics(const std::string_view& raw_query) const {
+	return RunRead([&]() { return server_.GetQueryStatistics(raw_query); }, false);
+}
+
+std::vector<Document> NumaNodeShard::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+	const CorpusStatistics& corpus_statistics) const {
+	return FindTopDocuments(raw_query,
+		[status](int document_id, DocumentStatus document_status, int rating) { return document_status == status; },
+		corpus_statistics);
+}
+
+std::vector<Document> NumaNodeShard::FindTopDocuments(const std::string_view& raw_query, const ShardPredicate& predic,
+	const CorpusStatistics& corpus_statistics) const {
+	return RunRead([&]() {
+		return server_.FindTopDocuments(std::execution::seq, raw_query, predic, corpus_statistics);
+	}, true);
+}
+
+std::vector<Document> NumaNodeShard::FindTopDocuments(const std::string_view& raw_query,
+	const ShardPredicate& predic) const {
+	return RunRead([&]() { return server_.FindTopDocuments(std::execution::seq, raw_query, predic); }, true);
+}
+
+NumaNodeStats NumaNodeShard::GetStats() const {
+	NumaNodeStats stats;
+	stats.node = node_id_;
+	stats.queries = queries_;
+	stats.busy_seconds = busy_nanoseconds_ * 1e-9;
+	const double elapsed_seconds = (SteadyNanoseconds() - stats_start_nanoseconds_) * 1e-9;
+	stats.queries_per_second = elapsed_seconds > 0 ? stats.queries / elapsed_seconds : 0;
+	return stats;
+}
+
+void NumaNodeShard::ResetStats() {
+	queries_ = 0;
+	busy_nanoseconds_ = 0;
+	stats_start_nanoseconds_ = SteadyNanoseconds();
+}
+
+void NumaNodeShard::WorkerLoop(const NumaTopology& topology, size_t node) {
+	topology.PinCurrentThread(node);
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock lock(tasks_mutex_);
+			tasks_cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+			if (tasks_.empty()) {
+				return;
+			}
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+		}
+		task();
+	}
+}
+
+NumaSearchServer::NumaSearchServer(const NumaTopology& topology, const std::string_view& stop_words,
+	NumaPlacement placement)
+	: topology_(topology)
+	, placement_(placement) {
+	std::vector<std::unique_ptr<NumaNodeShard>> shards;
+	for (size_t node = 0; node < topology_.GetNodeCount(); ++node) {
+		shards.push_back(std::make_unique<NumaNodeShard>(topology_, node, stop_words));
+		node_shards_.push_back(shards.back().get());
+	}
+	if (placement_ == NumaPlacement::REPLICATED) {
+		replicas_ = std::move(shards);
+	} else {
+		sharded_ = std::make_unique<ShardedSearchServer>(
+			std::vector<std::unique_ptr<SearchShard>>(std::make_move_iterator(shards.begin()),
+				std::make_move_iterator(shards.end())));
+	}
+}
+
+void NumaSearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	if (sharded_) {
+		sharded_->AddDocument(document_id, document, status, ratings);
+		return;
+	}
+	//первая копия проверяет документ; если она его отвергла, остальные не меняются. Если следующая
+	//копия не смогла добавить документ (бюджет памяти, нехватка памяти), он удаляется из копий,
+	//уже получивших его, и исключение пробрасывается: копии не должны расходиться
+	for (size_t i = 0; i < replicas_.size(); ++i) {
+		try {
+			replicas_[i]->AddDocument(document_id, document, status, ratings);
+		} catch (...) {
+			for (size_t added = 0; added < i; ++added) {
+				replicas_[added]->RemoveDocument(document_id);
+			}
+			throw;
+		}
+	}
+}
+
+void NumaSearchServer::RemoveDocument(int document_id) {
+	if (sharded_) {
+		sharded_->RemoveDocument(document_id);
+		return;
+	}
+	for (const auto& replica : replicas_) {
+		replica->RemoveDocument(document_id);
+	}
+}
+
+std::vector<Document> NumaSearchServer::FindTopDocuments(const std::string_view& raw_query) const {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> NumaSearchServer::FindTopDocuments(const std::string_view& raw_query,
+	DocumentStatus status) const {
+	if (sharded_) {
+		return sharded_->FindTopDocuments(raw_query, status);
+	}
+	return FindTopDocumentsImpl(raw_query,
+		[status](int document_id, DocumentStatus document_status, int rating) { return document_status == status; });
+}
+
+size_t NumaSearchServer::GetDocumentCount() const {
+	return sharded_ ? sharded_->GetDocumentCount() : replicas_.front()->GetDocumentCount();
+}
+
+const NumaTopology& NumaSearchServer::GetTopology() const {
+	return topology_;
+}
+
+NumaPlacement NumaSearchServer::GetPlacement() const {
+	return placement_;
+}
+
+std::vector<NumaNodeStats> NumaSearchServer::GetNodeStats() const {
+	std::vector<NumaNodeStats> stats;
+	for (const NumaNodeShard* shard : node_shards_) {
+		stats.push_back(shard->GetStats());
+	}
+	return stats;
+}
+
+void NumaSearchServer::ResetNodeStats() {
+	for (NumaNodeShard* shard : node_shards_) {
+		shard->ResetStats();
+	}
+}
+
+std::vector<Document> NumaSearchServer::FindTopDocumentsImpl(const std::string_view& raw_query,
+	const ShardPredicate& predic) const {
+	if (sharded_) {
+		return sharded_->FindTopDocuments(raw_query, predic);
+	}
+	return GetLocalReplica().FindTopDocuments(raw_query, predic);
+}
+
+const NumaNodeShard& NumaSearchServer::GetLocalReplica() const {
+	if (topology_.IsSimulated()) {
+		return *replicas_[next_replica_++ % replicas_.size()];
+	}
+	return *replicas_[topology_.GetCurrentNode()];
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "document.h"
+#include "numa_topology.h"
+#include "search_server.h"
+#include "sharded_search_server.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+//Нагрузка на узел NUMA с момента создания сервера или последнего ResetNodeStats
+struct NumaNodeStats {
+	int node = 0;
+	uint64_t queries = 0;
+	double busy_seconds = 0;
+	double queries_per_second = 0;
+};
+
+//Как документы распределяются по узлам: каждому узлу своя часть или каждому узлу полная копия
+enum class NumaPlacement { SHARDED, REPLICATED };
+
+//Индекс, привязанный к узлу NUMA. Все операции выполняют потоки, закрепленные за процессорами узла,
+//поэтому память индекса выделяется (по правилу первого касания) и читается локально для узла
+class NumaNodeShard : public SearchShard {
+public:
+	NumaNodeShard(const NumaTopology& topology, size_t node, const std::string_view& stop_words);
+
+	~NumaNodeShard() override;
+
+	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+		const std::vector<int>& ratings) override;
+
+	void RemoveDocument(int document_id) override;
+
+	size_t GetDocumentCount() const override;
+
+	CorpusStatistics GetQueryStatistics(const std::string_view& raw_query) const override;
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+		const CorpusStatistics& corpus_statistics) const override;
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, const ShardPredicate& predic,
+		const CorpusStatistics& corpus_statistics) const override;
+
+	//поиск по статистике самого узла (для полной копии индекса)
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, const ShardPredicate& predic) const;
+
+	NumaNodeStats GetStats() const;
+
+	void ResetStats();
+
+private:
+	int node_id_;
+	SearchServer server_;
+	mutable std::shared_mutex server_mutex_;
+
+	std::vector<std::thread> workers_;
+	mutable std::mutex tasks_mutex_;
+	mutable std::condition_variable tasks_cv_;
+	mutable std::deque<std::function<void()>> tasks_;
+	bool stopping_ = false;
+
+	mutable std::atomic<uint64_t> queries_{ 0 };
+	mutable std::atomic<uint64_t> busy_nanoseconds_{ 0 };
+	std::atomic<int64_t> stats_start_nanoseconds_{ 0 };
+
+	void WorkerLoop(const NumaTopology& topology, size_t node);
+
+	//выполнение function потоком узла с ожиданием результата; исключения пробрасываются вызывающему
+	template<typename Function>
+	auto Run(Function function) const -> decltype(function());
+
+	//чтение под разделяемой блокировкой с учетом времени работы узла; is_query - считать ли его запросом
+	template<typename Function>
+	auto RunRead(Function function, bool is_query) const -> decltype(function());
+};
+
+//Сервер, размещающий индекс по узлам NUMA: части (запрос рассылается всем узлам)
+//или копии (запрос выполняется на узле вызывающего потока)
+class NumaSearchServer {
+public:
+	NumaSearchServer(const NumaTopology& topology, const std::string_view& stop_words,
+		NumaPlacement placement = NumaPlacement::SHARDED);
+
+	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+		const std::vector<int>& ratings);
+
+	void RemoveDocument(int document_id);
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
+
+	template<typename Predic>
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, Predic predic) const;
+
+	size_t GetDocumentCount() const;
+
+	const NumaTopology& GetTopology() const;
+
+	NumaPlacement GetPlacement() const;
+
+	std::vector<NumaNodeStats> GetNodeStats() const;
+
+	void ResetNodeStats();
+
+private:
+	NumaTopology topology_;
+	NumaPlacement placement_;
+	std::vector<NumaNodeShard*> node_shards_;
+	//в режиме SHARDED узлами владеет sharded_, в режиме REPLICATED - replicas_
+	std::unique_ptr<ShardedSearchServer> sharded_;
+	std::vector<std::unique_ptr<NumaNodeShard>> replicas_;
+	//в смоделированной топологии потоки не закреплены, и копии выбираются по кругу
+	mutable std::atomic<size_t> next_replica_{ 0 };
+
+	std::vector<Document> FindTopDocumentsImpl(const std::string_view& raw_query, const ShardPredicate& predic) const;
+
+	const NumaNodeShard& GetLocalReplica() const;
+};
+
+template<typename Function>
+auto NumaNodeShard::Run(Function function) const -> decltype(function()) {
+	using Result = decltype(function());
+	auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+	std::future<Result> result = task->get_future();
+	{
+		std::lock_guard guard(tasks_mutex_);
+		tasks_.push_back([task]() { (*task)(); });
+	}
+	tasks_cv_.notify_one();
+	return result.get();
+}
+
+template<typename Function>
+auto NumaNodeShard::RunRead(Function function, bool is_query) const -> decltype(function()) {
+	return Run([this, &function, is_query]() {
+		const auto start = std::chrono::steady_clock::now();
+		std::shared_lock lock(server_mutex_);
+		auto result = function();
+		busy_nanoseconds_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+		if (is_query) {
+			++queries_;
+		}
+		return result;
+	});
+}
+
+template<typename Predic>
+std::vector<Document> NumaSearchServer::FindTopDocuments(const std::string_view& raw_query, Predic predic) const {
+	return FindTopDocumentsImpl(raw_query, ShardPredicate(predic));
+}
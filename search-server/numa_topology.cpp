@@ -0,0 +1,131 @@
+#include "numa_topology.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std::string_literals;
+
+std::vector<int> ParseCpuList(const std::string& text) {
+	std::vector<int> cpus;
+	size_t begin = 0;
+	while (begin < text.size()) {
+		size_t end = text.find(',', begin);
+		if (end == std::string::npos) {
+			end = text.size();
+		}
+		const std::string range = text.substr(begin, end - begin);
+		const size_t dash = range.find('-');
+		if (!range.empty() && range.find_first_not_of(" \n") != std::string::npos) {
+			const int first = std::stoi(range.substr(0, dash));
+			const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+			for (int cpu = first; cpu <= last; ++cpu) {
+				cpus.push_back(cpu);
+			}
+		}
+		begin = end + 1;
+	}
+	return cpus;
+}
+
+NumaTopology NumaTopology::Detect() {
+	NumaTopology topology;
+	std::ifstream online("/sys/devices/system/node/online"s);
+	std::string node_list;
+	if (std::getline(online, node_list)) {
+		for (const int id : ParseCpuList(node_list)) {
+			std::ifstream cpu_list_file("/sys/devices/system/node/node"s + std::to_string(id) + "/cpulist"s);
+			std::string cpu_list;
+			std::getline(cpu_list_file, cpu_list);
+			NumaNode node{ id, ParseCpuList(cpu_list) };
+			//узлы только с памятью (без процессоров) для размещения потоков не годятся
+			if (!node.cpus.empty()) {
+				topology.nodes_.push_back(std::move(node));
+			}
+		}
+	}
+	if (topology.nodes_.empty()) {
+		NumaNode node;
+		for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+			node.cpus.push_back(static_cast<int>(cpu));
+		}
+		topology.nodes_.push_back(std::move(node));
+	}
+	topology.IndexCpus();
+	return topology;
+}
+
+NumaTopology NumaTopology::Simulate(size_t node_count) {
+	if (node_count == 0) {
+		throw std::invalid_argument("node count must be positive"s);
+	}
+	NumaTopology topology;
+	topology.simulated_ = true;
+	topology.nodes_.resize(node_count);
+	const unsigned cpu_count = std::max(1u, std::thread::hardware_concurrency());
+	for (size_t i = 0; i < node_count; ++i) {
+		topology.nodes_[i].id = static_cast<int>(i);
+	}
+	//процессоров может быть меньше узлов: тогда у узла остается один общий процессор
+	for (unsigned cpu = 0; cpu < std::max<size_t>(cpu_count, node_count); ++cpu) {
+		topology.nodes_[cpu % node_count].cpus.push_back(static_cast<int>(cpu % cpu_count));
+	}
+	topology.IndexCpus();
+	return topology;
+}
+
+const std::vector<NumaNode>& NumaTopology::GetNodes() const {
+	return nodes_;
+}
+
+size_t NumaTopology::GetNodeCount() const {
+	return nodes_.size();
+}
+
+bool NumaTopology::IsSimulated() const {
+	return simulated_;
+}
+
+size_t NumaTopology::GetCurrentNode() const {
+	const int cpu = sched_getcpu();
+	if (cpu < 0 || static_cast<size_t>(cpu) >= cpu_to_node_.size()) {
+		return 0;
+	}
+	return cpu_to_node_[cpu];
+}
+
+bool NumaTopology::PinCurrentThread(size_t node) const {
+	if (simulated_ || node >= nodes_.size()) {
+		return false;
+	}
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	for (const int cpu : nodes_[node].cpus) {
+		if (cpu < CPU_SETSIZE) {
+			CPU_SET(cpu, &cpu_set);
+		}
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+}
+
+void NumaTopology::IndexCpus() {
+	//процессор, общий для нескольких смоделированных узлов, относится к первому из них
+	cpu_to_node_.clear();
+	std::vector<bool> assigned;
+	for (size_t node = 0; node < nodes_.size(); ++node) {
+		for (const int cpu : nodes_[node].cpus) {
+			if (static_cast<size_t>(cpu) >= cpu_to_node_.size()) {
+				cpu_to_node_.resize(cpu + 1, 0);
+				assigned.resize(cpu + 1, false);
+			}
+			if (!assigned[cpu]) {
+				cpu_to_node_[cpu] = node;
+				assigned[cpu] = true;
+			}
+		}
+	}
+}
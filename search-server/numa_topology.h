@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//Узел NUMA: номер и процессоры, память которых для него локальна
+struct NumaNode {
+	int id = 0;
+	std::vector<int> cpus;
+};
+
+//Топология NUMA машины. Определяется по /sys/devices/system/node без libnuma;
+//если сведений нет, вся машина считается одним узлом.
+//Смоделированная топология делит процессоры на узлы условно и ничего не закрепляет -
+//так размещение по узлам проверяется на машине с одним узлом
+class NumaTopology {
+public:
+	static NumaTopology Detect();
+
+	static NumaTopology Simulate(size_t node_count);
+
+	const std::vector<NumaNode>& GetNodes() const;
+
+	size_t GetNodeCount() const;
+
+	bool IsSimulated() const;
+
+	//индекс (в GetNodes) узла, на процессоре которого выполняется текущий поток
+	size_t GetCurrentNode() const;
+
+	//закрепляет текущий поток за процессорами узла; false, если это не удалось или топология смоделирована
+	bool PinCurrentThread(size_t node) const;
+
+private:
+	std::vector<NumaNode> nodes_;
+	std::vector<size_t> cpu_to_node_;
+	bool simulated_ = false;
+
+	void IndexCpus();
+};
+
+//разбор списка процессоров вида "0-3,8,10-11"
+std::vector<int> ParseCpuList(const std::string& text);
@@ -1,5 +1,8 @@
 #pragma once
 #include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <utility>
 #include <vector>
 
 template <typename Iterator>
@@ -53,3 +56,75 @@ Paginator<Iterator>::Paginator(const Iterator begin, const Iterator end, int pag
 	}
 	pages_.push_back({current_page_begin, end});
 }
+
+//Постраничный обход источника, который выдает страницы по требованию: source.NextPage(page_size)
+//возвращает следующую страницу, пустая страница - конец. Следующая страница запрашивается
+//только при переходе к ней, поэтому обход можно прервать, не посчитав остальные страницы
+template <typename PageSource>
+class LazyPaginator {
+public:
+	using Page = decltype(std::declval<PageSource&>().NextPage(size_t{}));
+
+	class Iterator {
+	public:
+		using value_type = Page;
+		using difference_type = std::ptrdiff_t;
+		using reference = const Page&;
+		using pointer = const Page*;
+		using iterator_category = std::input_iterator_tag;
+
+		Iterator() = default;
+
+		Iterator(PageSource* source, size_t page_size)
+			: source_(source), page_size_(page_size) {
+			Fetch();
+		}
+
+		reference operator*() const {
+			return page_;
+		}
+		pointer operator->() const {
+			return &page_;
+		}
+		Iterator& operator++() {
+			Fetch();
+			return *this;
+		}
+		//итераторы равны, только если оба в конце
+		bool operator==(const Iterator& other) const {
+			return source_ == nullptr && other.source_ == nullptr;
+		}
+		bool operator!=(const Iterator& other) const {
+			return !(*this == other);
+		}
+
+	private:
+		PageSource* source_ = nullptr;
+		size_t page_size_ = 0;
+		Page page_;
+
+		void Fetch() {
+			page_ = source_->NextPage(page_size_);
+			if (page_.empty()) {
+				source_ = nullptr;
+			}
+		}
+	};
+
+	LazyPaginator(PageSource& source, size_t page_size)
+		: source_(source), page_size_(page_size) {
+		assert(page_size > 0);
+	}
+
+	//начинает чтение с текущего места источника
+	Iterator begin() const {
+		return { &source_, page_size_ };
+	}
+	Iterator end() const {
+		return {};
+	}
+
+private:
+	PageSource& source_;
+	size_t page_size_;
+};
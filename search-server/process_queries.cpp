@@ -21,4 +21,14 @@ std::list<Document> ProcessQueriesJoined(
 		}
 	}
 	return documents_list;
+}
+
+std::vector<std::vector<Document>> ProcessQueries(
+	const NumaSearchServer& search_server,
+	const std::vector<std::string>& queries) {
+	std::vector<std::vector<Document>> documents_lists(queries.size());
+	std::transform(std::execution::par, queries.begin(), queries.end(),
+		documents_lists.begin(),
+		[&search_server](const std::string& query) { return search_server.FindTopDocuments(query); });
+	return documents_lists;
 }
\ No newline at end of file
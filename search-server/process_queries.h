@@ -1,6 +1,7 @@
 #pragma once
 
 #include "document.h"
+#include "numa_search_server.h"
 #include "search_server.h"
 
 #include <algorithm>
@@ -14,4 +15,9 @@ std::vector<std::vector<Document>> ProcessQueries(
 
 std::list<Document> ProcessQueriesJoined(
 	const SearchServer& search_server,
+	const std::vector<std::string>& queries);
+
+//Запросы выполняются параллельно, каждый на узле NUMA своего потока (или на всех узлах для частей)
+std::vector<std::vector<Document>> ProcessQueries(
+	const NumaSearchServer& search_server,
 	const std::vector<std::string>& queries);
\ No newline at end of file
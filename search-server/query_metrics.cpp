@@ -0,0 +1,295 @@
+#include "query_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <thread>
+
+using namespace std::string_literals;
+
+namespace {
+
+std::atomic<uint64_t> next_metrics_id{ 1 };
+
+//единственный писатель - свой поток, поэтому хватает обычных чтения и записи без lock-префикса
+void Increase(std::atomic<uint64_t>& counter, uint64_t value) {
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+std::string FormatNumber(double value) {
+	char text[64];
+	std::snprintf(text, sizeof(text), "%.9g", value);
+	return text;
+}
+
+}
+
+std::string_view GetQueryStageName(QueryStage stage) {
+	switch (stage) {
+	case QueryStage::PARSE:
+		return "parse";
+	case QueryStage::POSTING_FETCH:
+		return "posting_fetch";
+	case QueryStage::SCORING:
+		return "scoring";
+	case QueryStage::MINUS_FILTER:
+		return "minus_filter";
+	case QueryStage::TOP_K:
+		return "top_k";
+	case QueryStage::RESULT_BUILD:
+		return "result_build";
+	}
+	return "unknown";
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+	constexpr uint64_t sub_bucket_count = uint64_t{ 1 } << SUB_BUCKET_BITS;
+	if (value < sub_bucket_count) {
+		return static_cast<size_t>(value);
+	}
+	const int exponent = std::min(63 - __builtin_clzll(value), MAX_VALUE_BITS - 1);
+	const int shift = exponent - SUB_BUCKET_BITS;
+	if (value >> exponent > 1) {
+		return BUCKET_COUNT - 1;
+	}
+	const uint64_t sub_bucket = (value >> shift) & (sub_bucket_count - 1);
+	return (static_cast<size_t>(shift + 1) << SUB_BUCKET_BITS) + static_cast<size_t>(sub_bucket);
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) {
+	constexpr size_t sub_bucket_count = size_t{ 1 } << SUB_BUCKET_BITS;
+	if (index < sub_bucket_count) {
+		return index;
+	}
+	const int shift = static_cast<int>(index >> SUB_BUCKET_BITS) - 1;
+	const uint64_t lower = static_cast<uint64_t>(sub_bucket_count + (index & (sub_bucket_count - 1))) << shift;
+	return lower + (uint64_t{ 1 } << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value, uint64_t count) {
+	buckets_[GetBucketIndex(value)] += count;
+	count_ += count;
+	sum_ += value * count;
+	max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+	for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+		buckets_[i] += other.buckets_[i];
+	}
+	count_ += other.count_;
+	sum_ += other.sum_;
+	max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+	return count_;
+}
+
+uint64_t LatencyHistogram::GetSum() const {
+	return sum_;
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+	return max_;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percent) const {
+	if (count_ == 0) {
+		return 0;
+	}
+	const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percent / 100 * count_)));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+		seen += buckets_[i];
+		if (seen >= rank) {
+			return std::min(GetBucketUpperBound(i), max_);
+		}
+	}
+	return max_;
+}
+
+std::string QueryProfile::ToString() const {
+	const auto yes_no = [](bool value) { return value ? "yes"s : "no"s; };
+	std::string text = "path: "s + execution_path + (adaptive ? " (adaptive)"s : ""s) + ", kernel: "s + scoring_kernel
+		+ ", pruning: "s + yes_no(pruning) + ", cache hit: "s + yes_no(cache_hit) + "\n"s;
+	for (const TermProfile& term : terms) {
+		text += "term "s + (term.is_minus ? "-"s : "+"s) + term.word + ": postings "s
+			+ std::to_string(term.posting_list_length);
+		if (!term.is_minus) {
+			text += ", idf "s + FormatNumber(term.inverse_document_freq);
+		}
+		text += ", scanned "s + std::to_string(term.postings_scanned)
+			+ ", skipped "s + std::to_string(term.postings_skipped) + "\n"s;
+	}
+	text += "candidates: "s + std::to_string(candidates) + ", after minus filter: "s
+		+ std::to_string(candidates_after_minus) + ", after predicate: "s + std::to_string(candidates_after_predicate)
+		+ ", results: "s + std::to_string(results) + "\n"s;
+	text += "stages (us):"s;
+	for (size_t i = 0; i < QUERY_STAGE_COUNT; ++i) {
+		text += " "s + std::string(GetQueryStageName(static_cast<QueryStage>(i))) + " "s
+			+ FormatNumber(stage_nanoseconds[i] / 1000.0);
+	}
+	text += "\n"s;
+	return text;
+}
+
+const LatencyHistogram& MetricsSnapshot::GetStage(QueryStage stage) const {
+	return stages[static_cast<size_t>(stage)];
+}
+
+std::string RenderPrometheus(const MetricsSnapshot& snapshot, std::string_view prefix) {
+	const std::string name(prefix);
+	std::string text;
+	const auto counter = [&](const std::string& metric, const std::string& help, uint64_t value) {
+		text += "# HELP "s + name + "_"s + metric + " "s + help + "\n"s;
+		text += "# TYPE "s + name + "_"s + metric + " counter\n"s;
+		text += name + "_"s + metric + " "s + std::to_string(value) + "\n"s;
+	};
+	counter("queries_total"s, "Search queries processed."s, snapshot.queries);
+	counter("postings_scanned_total"s, "Posting list entries scored."s, snapshot.postings_scanned);
+	counter("documents_matched_total"s, "Documents that passed filtering before top-K."s, snapshot.documents_matched);
+	const std::string metric = name + "_stage_duration_seconds"s;
+	text += "# HELP "s + metric + " Time spent in each query stage.\n"s;
+	text += "# TYPE "s + metric + " summary\n"s;
+	for (size_t i = 0; i < QUERY_STAGE_COUNT; ++i) {
+		const LatencyHistogram& histogram = snapshot.stages[i];
+		const std::string stage(GetQueryStageName(static_cast<QueryStage>(i)));
+		for (const double quantile : { 0.5, 0.9, 0.99, 0.999 }) {
+			text += metric + "{stage=\""s + stage + "\",quantile=\""s + FormatNumber(quantile) + "\"} "s
+				+ FormatNumber(histogram.GetPercentile(quantile * 100) * 1e-9) + "\n"s;
+		}
+		text += metric + "_sum{stage=\""s + stage + "\"} "s + FormatNumber(histogram.GetSum() * 1e-9) + "\n"s;
+		text += metric + "_count{stage=\""s + stage + "\"} "s + std::to_string(histogram.GetCount()) + "\n"s;
+	}
+	return text;
+}
+
+struct QueryMetrics::ThreadCounters {
+	//поток-владелец: по нему счетчики находятся снова, если выпали из кеша потока
+	std::thread::id owner;
+	std::array<std::array<std::atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT>, QUERY_STAGE_COUNT> buckets{};
+	std::array<std::atomic<uint64_t>, QUERY_STAGE_COUNT> sums{};
+	std::array<std::atomic<uint64_t>, QUERY_STAGE_COUNT> maxima{};
+	std::atomic<uint64_t> queries{ 0 };
+	std::atomic<uint64_t> postings_scanned{ 0 };
+	std::atomic<uint64_t> documents_matched{ 0 };
+};
+
+QueryMetrics::QueryMetrics()
+	: id_(next_metrics_id++) {
+}
+
+QueryMetrics::QueryMetrics(const QueryMetrics& other)
+	: QueryMetrics() {
+	enabled_ = other.IsEnabled();
+}
+
+QueryMetrics& QueryMetrics::operator=(const QueryMetrics& other) {
+	enabled_ = other.IsEnabled();
+	return *this;
+}
+
+QueryMetrics::~QueryMetrics() = default;
+
+void QueryMetrics::SetEnabled(bool enabled) {
+	enabled_ = enabled;
+}
+
+bool QueryMetrics::IsEnabled() const {
+	return enabled_.load(std::memory_order_relaxed);
+}
+
+void QueryMetrics::Record(QueryStage stage, uint64_t nanoseconds) {
+	ThreadCounters& counters = GetThreadCounters();
+	const size_t index = static_cast<size_t>(stage);
+	Increase(counters.buckets[index][LatencyHistogram::GetBucketIndex(nanoseconds)], 1);
+	Increase(counters.sums[index], nanoseconds);
+	if (nanoseconds > counters.maxima[index].load(std::memory_order_relaxed)) {
+		counters.maxima[index].store(nanoseconds, std::memory_order_relaxed);
+	}
+}
+
+void QueryMetrics::AddQuery(uint64_t postings_scanned, uint64_t documents_matched) {
+	ThreadCounters& counters = GetThreadCounters();
+	Increase(counters.queries, 1);
+	Increase(counters.postings_scanned, postings_scanned);
+	Increase(counters.documents_matched, documents_matched);
+}
+
+MetricsSnapshot QueryMetrics::GetSnapshot() const {
+	MetricsSnapshot snapshot;
+	std::lock_guard guard(mutex_);
+	for (const auto& counters : threads_) {
+		snapshot.queries += counters->queries.load(std::memory_order_relaxed);
+		snapshot.postings_scanned += counters->postings_scanned.load(std::memory_order_relaxed);
+		snapshot.documents_matched += counters->documents_matched.load(std::memory_order_relaxed);
+		for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+			LatencyHistogram histogram;
+			for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+				const uint64_t count = counters->buckets[stage][i].load(std::memory_order_relaxed);
+				if (count != 0) {
+					histogram.Record(LatencyHistogram::GetBucketUpperBound(i), count);
+				}
+			}
+			snapshot.stages[stage].Merge(histogram);
+		}
+	}
+	//суммы и максимумы точные, а не по границам корзин
+	for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+		uint64_t sum = 0;
+		uint64_t max = 0;
+		for (const auto& counters : threads_) {
+			sum += counters->sums[stage].load(std::memory_order_relaxed);
+			max = std::max(max, counters->maxima[stage].load(std::memory_order_relaxed));
+		}
+		snapshot.stages[stage].sum_ = sum;
+		snapshot.stages[stage].max_ = max;
+	}
+	return snapshot;
+}
+
+void QueryMetrics::Reset() {
+	//счетчики обнуляются, а не удаляются: потоки держат на них указатели.
+	//Запись, идущая одновременно со сбросом, может потеряться
+	std::lock_guard guard(mutex_);
+	for (const auto& counters : threads_) {
+		for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+			for (auto& bucket : counters->buckets[stage]) {
+				bucket.store(0, std::memory_order_relaxed);
+			}
+			counters->sums[stage].store(0, std::memory_order_relaxed);
+			counters->maxima[stage].store(0, std::memory_order_relaxed);
+		}
+		counters->queries.store(0, std::memory_order_relaxed);
+		counters->postings_scanned.store(0, std::memory_order_relaxed);
+		counters->documents_matched.store(0, std::memory_order_relaxed);
+	}
+}
+
+QueryMetrics::ThreadCounters& QueryMetrics::GetThreadCounters() {
+	//у потока небольшой кеш счетчиков по id метрик; id не повторяются, поэтому записи умерших метрик не мешают
+	thread_local std::vector<std::pair<uint64_t, ThreadCounters*>> cache;
+	for (const auto& [id, counters] : cache) {
+		if (id == id_) {
+			return *counters;
+		}
+	}
+	//при переполнении вытесняется самая старая запись; счетчики потока не теряются,
+	//а находятся в threads_ по владельцу, поэтому у потока в каждых метриках ровно одни счетчики
+	if (cache.size() >= 16) {
+		cache.erase(cache.begin());
+	}
+	const std::thread::id owner = std::this_thread::get_id();
+	std::lock_guard guard(mutex_);
+	auto it = std::find_if(threads_.begin(), threads_.end(),
+		[owner](const auto& counters) { return counters->owner == owner; });
+	if (it == threads_.end()) {
+		threads_.push_back(std::make_unique<ThreadCounters>());
+		threads_.back()->owner = owner;
+		it = std::prev(threads_.end());
+	}
+	cache.emplace_back(id_, it->get());
+	return **it;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "query_profile.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+//Этапы обработки поискового запроса
+enum class QueryStage { PARSE, POSTING_FETCH, SCORING, MINUS_FILTER, TOP_K, RESULT_BUILD };
+
+constexpr size_t QUERY_STAGE_COUNT = std::tuple_size_v<decltype(QueryProfile::stage_nanoseconds)>;
+
+std::string_view GetQueryStageName(QueryStage stage);
+
+//Гистограмма с логарифмическими корзинами, как HDR Histogram: каждая степень двойки делится
+//на 2^SUB_BUCKET_BITS равных корзин, поэтому относительная погрешность значения не больше 1/32.
+//Значения от 2^MAX_VALUE_BITS попадают в последнюю корзину
+class LatencyHistogram {
+public:
+	static constexpr int SUB_BUCKET_BITS = 5;
+	static constexpr int MAX_VALUE_BITS = 40;
+	static constexpr size_t BUCKET_COUNT = static_cast<size_t>(MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+	static size_t GetBucketIndex(uint64_t value);
+
+	//наибольшее значение, попадающее в корзину index
+	static uint64_t GetBucketUpperBound(size_t index);
+
+	void Record(uint64_t value, uint64_t count = 1);
+
+	void Merge(const LatencyHistogram& other);
+
+	uint64_t GetCount() const;
+
+	uint64_t GetSum() const;
+
+	uint64_t GetMax() const;
+
+	//значение, не меньше которого percent процентов записанных (с точностью до корзины)
+	uint64_t GetPercentile(double percent) const;
+
+private:
+	friend class QueryMetrics;
+
+	std::array<uint64_t, BUCKET_COUNT> buckets_{};
+	uint64_t count_ = 0;
+	uint64_t sum_ = 0;
+	uint64_t max_ = 0;
+};
+
+//Снимок метрик поиска; длительности этапов в наносекундах
+struct MetricsSnapshot {
+	uint64_t queries = 0;
+	uint64_t postings_scanned = 0;
+	uint64_t documents_matched = 0;
+	std::array<LatencyHistogram, QUERY_STAGE_COUNT> stages;
+
+	const LatencyHistogram& GetStage(QueryStage stage) const;
+};
+
+//Метрики в текстовом формате Prometheus: счетчики и summary длительностей этапов в секундах
+std::string RenderPrometheus(const MetricsSnapshot& snapshot, std::string_view prefix = "search_server");
+
+//Метрики поиска. Каждый поток пишет в свои счетчики без блокировок и атомарных операций
+//чтения-изменения-записи; снимок суммирует счетчики всех потоков.
+//При копировании сервера метрики не копируются: у копии они начинаются с нуля
+class QueryMetrics {
+public:
+	QueryMetrics();
+
+	QueryMetrics(const QueryMetrics&);
+
+	QueryMetrics& operator=(const QueryMetrics&);
+
+	~QueryMetrics();
+
+	void SetEnabled(bool enabled);
+
+	bool IsEnabled() const;
+
+	void Record(QueryStage stage, uint64_t nanoseconds);
+
+	void AddQuery(uint64_t postings_scanned, uint64_t documents_matched);
+
+	MetricsSnapshot GetSnapshot() const;
+
+	void Reset();
+
+private:
+	struct ThreadCounters;
+
+	uint64_t id_;
+	std::atomic<bool> enabled_{ true };
+	mutable std::mutex mutex_;
+	mutable std::vector<std::unique_ptr<ThreadCounters>> threads_;
+
+	ThreadCounters& GetThreadCounters();
+};
+
+//Замер этапов одного запроса: Lap записывает время с предыдущего Lap (или создания) в этап stage
+//в метрики и, если передан, в профиль запроса. Если метрики выключены и профиля нет, часы не читаются
+class QueryTimer {
+public:
+	explicit QueryTimer(QueryMetrics& metrics, QueryProfile* profile = nullptr)
+		: metrics_(metrics)
+		, profile_(profile)
+		, enabled_(metrics.IsEnabled()) {
+		if (enabled_ || profile_ != nullptr) {
+			last_ = std::chrono::steady_clock::now();
+		}
+	}
+
+	void Lap(QueryStage stage) {
+		if (!enabled_ && profile_ == nullptr) {
+			return;
+		}
+		const auto now = std::chrono::steady_clock::now();
+		const uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_).count();
+		if (enabled_) {
+			metrics_.Record(stage, nanoseconds);
+		}
+		if (profile_ != nullptr) {
+			profile_->stage_nanoseconds[static_cast<size_t>(stage)] += nanoseconds;
+		}
+		last_ = now;
+	}
+
+	//профиль запроса или nullptr, если он не нужен
+	QueryProfile* GetProfile() const {
+		return profile_;
+	}
+
+	void AddPostingsScanned(size_t count) {
+		postings_scanned_ += count;
+	}
+
+	void AddDocumentsMatched(size_t count) {
+		documents_matched_ += count;
+	}
+
+	//учет завершенного запроса
+	void Finish() {
+		if (enabled_) {
+			metrics_.AddQuery(postings_scanned_, documents_matched_);
+		}
+	}
+
+private:
+	QueryMetrics& metrics_;
+	QueryProfile* profile_;
+	const bool enabled_;
+	std::chrono::steady_clock::time_point last_;
+	uint64_t postings_scanned_ = 0;
+	uint64_t documents_matched_ = 0;
+};
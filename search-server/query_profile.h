@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Слово запроса в профиле: размер его списка вхождений, вес (IDF; для минус-слов 0)
+//и сколько вхождений просмотрено и пропущено
+struct TermProfile {
+	std::string word;
+	bool is_minus = false;
+	size_t posting_list_length = 0;
+	double inverse_document_freq = 0;
+	size_t postings_scanned = 0;
+	size_t postings_skipped = 0;
+};
+
+//Профиль выполнения одного запроса (EXPLAIN): как он выполнялся, сколько кандидатов осталось
+//после каждого отбора и сколько времени занял каждый этап (индексы - QueryStage)
+struct QueryProfile {
+	std::string execution_path;
+	//путь выбран политикой adaptive_policy
+	bool adaptive = false;
+	std::string scoring_kernel;
+	bool pruning = false;
+	bool cache_hit = false;
+	std::vector<TermProfile> terms;
+	size_t candidates = 0;
+	size_t candidates_after_minus = 0;
+	size_t candidates_after_predicate = 0;
+	size_t results = 0;
+	std::array<uint64_t, 6> stage_nanoseconds{};
+
+	//многострочное описание для чтения человеком
+	std::string ToString() const;
+};
@@ -1,21 +1,180 @@
 #include "remove_duplicates.h"
 
-void RemoveDuplicates(SearchServer& search_server) {
-	std::set<int> duplicates;
-	std::set<std::set<std::string>> check_dulicates;
-	for (int i : search_server) {
-		std::set<std::string> set_of_keys;
-		for (const auto& [key, value] : search_server.GetWordFrequencies(i)) {
-			set_of_keys.insert(key);
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <numeric>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+//перемешивание битов из splitmix64
+uint64_t Mix(uint64_t value) {
+	value += 0x9E3779B97F4A7C15ull;
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
+
+struct DocumentTerms {
+	int id;
+	std::vector<uint32_t> term_ids;
+};
+
+//номера слов всех документов по возрастанию id
+std::vector<DocumentTerms> CollectDocumentTerms(const SearchServer& search_server) {
+	std::vector<DocumentTerms> documents;
+	for (const int id : search_server) {
+		documents.push_back({ id, {} });
+	}
+	std::sort(documents.begin(), documents.end(),
+		[](const DocumentTerms& lhs, const DocumentTerms& rhs) { return lhs.id < rhs.id; });
+	std::for_each(std::execution::par, documents.begin(), documents.end(),
+		[&search_server](DocumentTerms& document) {
+			const WordFrequencies word_freqs = search_server.GetWordFrequencies(document.id);
+			const auto [begin, end] = word_freqs.GetEntries();
+			document.term_ids.reserve(end - begin);
+			for (auto entry = begin; entry != end; ++entry) {
+				document.term_ids.push_back(entry->term_id);
+			}
+		});
+	return documents;
+}
+
+double ComputeJaccard(const std::vector<uint32_t>& lhs, const std::vector<uint32_t>& rhs) {
+	size_t common = 0;
+	for (size_t l = 0, r = 0; l < lhs.size() && r < rhs.size();) {
+		if (lhs[l] < rhs[r]) {
+			++l;
+		} else if (rhs[r] < lhs[l]) {
+			++r;
+		} else {
+			++common;
+			++l;
+			++r;
+		}
+	}
+	return common * 1.0 / (lhs.size() + rhs.size() - common);
+}
+
+} // namespace
+
+std::vector<int> FindDuplicates(const SearchServer& search_server) {
+	const std::vector<DocumentTerms> documents = CollectDocumentTerms(search_server);
+	//128-битный хеш набора: два независимых 64-битных хеша отсортированной последовательности номеров
+	struct HashedDocument {
+		uint64_t high;
+		uint64_t low;
+		int id;
+	};
+	std::vector<HashedDocument> hashes(documents.size());
+	std::transform(std::execution::par, documents.begin(), documents.end(), hashes.begin(),
+		[](const DocumentTerms& document) {
+			uint64_t high = Mix(document.term_ids.size());
+			uint64_t low = Mix(~document.term_ids.size());
+			for (const uint32_t term_id : document.term_ids) {
+				high = Mix(high ^ term_id);
+				low = Mix(low + term_id * 0xD6E8FEB86659FD93ull);
+			}
+			return HashedDocument{ high, low, document.id };
+		});
+	std::sort(std::execution::par, hashes.begin(), hashes.end(),
+		[](const HashedDocument& lhs, const HashedDocument& rhs) {
+			return std::tie(lhs.high, lhs.low, lhs.id) < std::tie(rhs.high, rhs.low, rhs.id);
+		});
+	std::vector<int> duplicates;
+	for (size_t i = 1; i < hashes.size(); ++i) {
+		if (hashes[i].high == hashes[i - 1].high && hashes[i].low == hashes[i - 1].low) {
+			duplicates.push_back(hashes[i].id);
+		}
+	}
+	std::sort(duplicates.begin(), duplicates.end());
+	return duplicates;
+}
+
+std::vector<int> FindNearDuplicates(const SearchServer& search_server, double threshold, int bands, int rows) {
+	if (threshold <= 0 || threshold > 1 || bands <= 0 || rows <= 0) {
+		throw std::invalid_argument("invalid near-duplicate search parameters"s);
+	}
+	const std::vector<DocumentTerms> documents = CollectDocumentTerms(search_server);
+	const size_t signature_size = static_cast<size_t>(bands) * rows;
+	std::vector<std::vector<uint64_t>> signatures(documents.size());
+	std::transform(std::execution::par, documents.begin(), documents.end(), signatures.begin(),
+		[signature_size](const DocumentTerms& document) {
+			std::vector<uint64_t> signature(signature_size, UINT64_MAX);
+			for (const uint32_t term_id : document.term_ids) {
+				const uint64_t term_hash = Mix(term_id);
+				for (size_t i = 0; i < signature_size; ++i) {
+					signature[i] = std::min(signature[i], Mix(term_hash ^ (i * 0x9E3779B97F4A7C15ull)));
+				}
+			}
+			return signature;
+		});
+
+	//флаг дубликата по индексу документа; каждая полоса отмечает документы, похожие на документ
+	//с меньшим id из той же корзины
+	std::vector<char> is_duplicate(documents.size(), 0);
+	std::vector<int> band_indexes(bands);
+	std::iota(band_indexes.begin(), band_indexes.end(), 0);
+	std::vector<std::vector<size_t>> band_duplicates(bands);
+	std::for_each(std::execution::par, band_indexes.begin(), band_indexes.end(),
+		[&](int band) {
+			std::vector<std::pair<uint64_t, size_t>> buckets;
+			buckets.reserve(documents.size());
+			for (size_t index = 0; index < documents.size(); ++index) {
+				if (documents[index].term_ids.empty()) {
+					continue;
+				}
+				uint64_t band_hash = Mix(band);
+				for (int row = 0; row < rows; ++row) {
+					band_hash = Mix(band_hash ^ signatures[index][band * rows + row]);
+				}
+				buckets.emplace_back(band_hash, index);
+			}
+			std::sort(buckets.begin(), buckets.end());
+			for (size_t begin = 0, end = 0; begin < buckets.size(); begin = end) {
+				while (end < buckets.size() && buckets[end].first == buckets[begin].first) {
+					++end;
+				}
+				//индексы в корзине идут по возрастанию id
+				for (size_t i = begin + 1; i < end; ++i) {
+					for (size_t j = begin; j < i; ++j) {
+						if (ComputeJaccard(documents[buckets[i].second].term_ids,
+							documents[buckets[j].second].term_ids) >= threshold) {
+							band_duplicates[band].push_back(buckets[i].second);
+							break;
+						}
+					}
+				}
+			}
+		});
+	for (const auto& duplicates : band_duplicates) {
+		for (const size_t index : duplicates) {
+			is_duplicate[index] = 1;
 		}
-		auto [it, is_inserted] = check_dulicates.insert(set_of_keys);
-		if (!is_inserted) {
-			duplicates.insert(i);
+	}
+	std::vector<int> duplicates;
+	for (size_t index = 0; index < documents.size(); ++index) {
+		if (is_duplicate[index]) {
+			duplicates.push_back(documents[index].id);
 		}
 	}
-	for (int i : duplicates) {
-		std::cout << "Found duplicate document id "s << i << std::endl;
-		search_server.RemoveDocument(i);
+	return duplicates;
+}
+
+std::vector<int> RemoveDuplicates(SearchServer& search_server) {
+	const std::vector<int> duplicates = FindDuplicates(search_server);
+	for (const int id : duplicates) {
+		search_server.RemoveDocument(id);
 	}
+	return duplicates;
 }
 
+std::vector<int> RemoveNearDuplicates(SearchServer& search_server, double threshold) {
+	const std::vector<int> duplicates = FindNearDuplicates(search_server, threshold);
+	for (const int id : duplicates) {
+		search_server.RemoveDocument(id);
+	}
+	return duplicates;
+}
@@ -1,6 +1,21 @@
 #pragma once
 #include "search_server.h"
 #include <string>
+#include <vector>
 using  std::string_literals::operator ""s;
 
-void RemoveDuplicates(SearchServer& search_server);
+//Поиск дубликатов: документов с тем же набором слов, что и у документа с меньшим id.
+//Наборы номеров слов сравниваются по 128-битным хешам, хеши считаются параллельно
+std::vector<int> FindDuplicates(const SearchServer& search_server);
+
+//Поиск почти-дубликатов: документов, у которых сходство Жаккара наборов слов с каким-либо документом
+//с меньшим id не меньше threshold. Пары-кандидаты отбираются по MinHash-сигнатурам из bands * rows
+//значений с разбиением на полосы (LSH) и проверяются точным сходством
+std::vector<int> FindNearDuplicates(const SearchServer& search_server, double threshold,
+	int bands = 16, int rows = 4);
+
+//Удаление дубликатов, документ с наименьшим id остается; возвращает id удаленных по возрастанию
+std::vector<int> RemoveDuplicates(SearchServer& search_server);
+
+//Удаление почти-дубликатов, возвращает id удаленных по возрастанию
+std::vector<int> RemoveNearDuplicates(SearchServer& search_server, double threshold);
@@ -0,0 +1,49 @@
+#include "scorer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+double Scorer::PostingWeight(int word_count, int document_length, double average_document_length) const {
+	return ComputePostingWeight(GetPostingWeightForm(average_document_length), word_count, DocumentNorm(document_length));
+}
+
+double TfIdfScorer::TermWeight(size_t document_count, size_t document_freq) const {
+	return log(document_count * 1.0 / document_freq);
+}
+
+double TfIdfScorer::DocumentNorm(int document_length) const {
+	return document_length;
+}
+
+PostingWeightForm TfIdfScorer::GetPostingWeightForm(double average_document_length) const {
+	//TF - число вхождений, деленное на длину (норму документа)
+	return { PostingWeightKind::TERM_FREQUENCY, 1.0 };
+}
+
+Bm25Scorer::Bm25Scorer(double k1, double b)
+	: k1_(k1), b_(b) {
+	if (k1 < 0 || b < 0 || b > 1) {
+		throw std::invalid_argument("BM25 parameters out of range"s);
+	}
+}
+
+double Bm25Scorer::TermWeight(size_t document_count, size_t document_freq) const {
+	//в double: при несогласованной статистике (например, собранной с частей корпуса в разное время)
+	//document_freq может оказаться больше document_count
+	const double documents_without_word = std::max(0.0, static_cast<double>(document_count) - document_freq);
+	return log(1.0 + (documents_without_word + 0.5) / (document_freq + 0.5));
+}
+
+double Bm25Scorer::DocumentNorm(int document_length) const {
+	return document_length;
+}
+
+PostingWeightForm Bm25Scorer::GetPostingWeightForm(double average_document_length) const {
+	//k1 * (1 - b + b * длина / средняя длина); без документов средней длины нет, и длина не учитывается
+	const double length_scale = average_document_length > 0 ? k1_ * b_ / average_document_length : 0.0;
+	const double offset = average_document_length > 0 ? k1_ * (1 - b_) : k1_;
+	return { PostingWeightKind::SATURATION, k1_ + 1, offset, length_scale };
+}
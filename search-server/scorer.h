@@ -0,0 +1,54 @@
+#pragma once
+
+#include "scoring_kernels.h"
+
+#include <cstddef>
+
+//Модель ранжирования. Релевантность документа - сумма по плюс-словам TermWeight * PostingWeight.
+//Индекс хранит только число вхождений слова и норму документа (DocumentNorm), вес вхождения выводится
+//из них в ядре подсчета по виду GetPostingWeightForm. TermWeight и вид веса считаются один раз на запрос
+//по текущей статистике корпуса, поэтому стоимость подсчета на одно вхождение не зависит от модели,
+//а норма документа не зависит от остальных документов и не пересчитывается при их добавлении.
+class Scorer {
+public:
+	virtual ~Scorer() = default;
+
+	//вес слова запроса по числу документов в индексе и числу документов со словом
+	virtual double TermWeight(size_t document_count, size_t document_freq) const = 0;
+
+	//норма документа из document_length слов, одна на документ
+	virtual double DocumentNorm(int document_length) const = 0;
+
+	//как вес вхождения получается из числа вхождений и нормы документа при средней длине документа
+	//average_document_length (0 - корпус пуст)
+	virtual PostingWeightForm GetPostingWeightForm(double average_document_length) const = 0;
+
+	//вес вхождения слова word_count раз в документ из document_length слов
+	double PostingWeight(int word_count, int document_length, double average_document_length) const;
+};
+
+//TF-IDF: TF = word_count / document_length, IDF = log(document_count / document_freq)
+class TfIdfScorer : public Scorer {
+public:
+	double TermWeight(size_t document_count, size_t document_freq) const override;
+
+	double DocumentNorm(int document_length) const override;
+
+	PostingWeightForm GetPostingWeightForm(double average_document_length) const override;
+};
+
+//Okapi BM25 с настраиваемыми k1 и b
+class Bm25Scorer : public Scorer {
+public:
+	explicit Bm25Scorer(double k1 = 1.2, double b = 0.75);
+
+	double TermWeight(size_t document_count, size_t document_freq) const override;
+
+	double DocumentNorm(int document_length) const override;
+
+	PostingWeightForm GetPostingWeightForm(double average_document_length) const override;
+
+private:
+	double k1_;
+	double b_;
+};
@@ -0,0 +1,206 @@
+#include "scoring_kernels.h"
+
+//GCC по умолчанию сливает умножение и сложение в FMA, причем не во всех ветвях одинаково:
+//векторный блок и хвост одного вызова тогда округляют по-разному
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SCORING_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using Kernel = AccumulateTermRelevanceKernel;
+
+//Номера документов в списке вхождений идут вразброс по аккумулятору и нормам, и на большом индексе
+//каждое чтение по номеру - промах кэша и TLB. Поэтому строки для вхождения, до которого осталось
+//PREFETCH_DISTANCE шагов, запрашиваются заранее, и к его обработке они уже загружены.
+//Пока массивы помещаются в кэш, запросы только занимают порты загрузки, поэтому у каждого ядра
+//два варианта, и с упреждающей загрузкой работает только тот, что выбран для большого индекса
+constexpr size_t PREFETCH_DISTANCE = 32;
+
+//упреждающая загрузка норм и аккумулятора для вхождений [first, first + count)
+inline void PrefetchPostings(const int* slots, size_t first, size_t count, const double* document_norms,
+	const double* accumulator) {
+#if defined(__GNUC__) || defined(__clang__)
+	for (size_t i = first; i < first + count; ++i) {
+		__builtin_prefetch(document_norms + slots[i], 0);
+		__builtin_prefetch(accumulator + slots[i], 1);
+	}
+#endif
+}
+
+template <bool Prefetch>
+void AccumulateTermRelevanceScalar(const int* slots, const int* word_counts, size_t count, const double* document_norms,
+	const PostingWeightForm& form, double inverse_document_freq, double* accumulator) {
+	for (size_t i = 0; i < count; ++i) {
+		if (Prefetch && i + PREFETCH_DISTANCE < count) {
+			PrefetchPostings(slots, i + PREFETCH_DISTANCE, 1, document_norms, accumulator);
+		}
+		const double relevance = ComputePostingWeight(form, word_counts[i], document_norms[slots[i]]) * inverse_document_freq;
+		accumulator[slots[i]] += relevance;
+	}
+}
+
+#ifdef SCORING_KERNELS_X86
+
+//Сбор values[index[i]] по всем полосам. Маскированный gather с явным нулевым источником:
+//у немаскированного источник не инициализирован, и компилятор предупреждает об этом
+__attribute__((target("avx2")))
+__m256d GatherAvx2(const double* values, __m128i index) {
+	const __m256d all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+	return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), values, index, all_lanes, 8);
+}
+
+__attribute__((target("avx512f")))
+__m512d GatherAvx512(const double* values, __m256i index) {
+	return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, index, values, 8);
+}
+
+//вес за одно деление (или умножение и деление) на полосу, как в ComputePostingWeight
+__attribute__((target("avx2")))
+__m256d PostingWeightAvx2(__m128i word_counts, __m256d norms, const PostingWeightForm& form) {
+	const __m256d counts = _mm256_cvtepi32_pd(word_counts);
+	if (form.kind == PostingWeightKind::SATURATION) {
+		const __m256d length_norms = _mm256_add_pd(_mm256_set1_pd(form.offset),
+			_mm256_mul_pd(_mm256_set1_pd(form.length_scale), norms));
+		return _mm256_div_pd(_mm256_mul_pd(counts, _mm256_set1_pd(form.scale)), _mm256_add_pd(counts, length_norms));
+	}
+	return _mm256_div_pd(counts, norms);
+}
+
+//4 вхождения за инструкцию: gather норм и аккумулятора, вес, умножение и сложение векторами, запись по одному
+template <bool Prefetch>
+__attribute__((target("avx2")))
+void AccumulateTermRelevanceAvx2(const int* slots, const int* word_counts, size_t count, const double* document_norms,
+	const PostingWeightForm& form, double inverse_document_freq, double* accumulator) {
+	const __m256d idf = _mm256_set1_pd(inverse_document_freq);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		if (Prefetch && i + PREFETCH_DISTANCE + 4 <= count) {
+			PrefetchPostings(slots, i + PREFETCH_DISTANCE, 4, document_norms, accumulator);
+		}
+		const __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(slots + i));
+		const __m128i counts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(word_counts + i));
+		const __m256d norms = GatherAvx2(document_norms, index);
+		const __m256d current = GatherAvx2(accumulator, index);
+		const __m256d relevance = _mm256_mul_pd(PostingWeightAvx2(counts, norms, form), idf);
+		alignas(32) double lanes[4];
+		_mm256_store_pd(lanes, _mm256_add_pd(current, relevance));
+		accumulator[slots[i]] = lanes[0];
+		accumulator[slots[i + 1]] = lanes[1];
+		accumulator[slots[i + 2]] = lanes[2];
+		accumulator[slots[i + 3]] = lanes[3];
+	}
+	for (; i < count; ++i) {
+		const double relevance = ComputePostingWeight(form, word_counts[i], document_norms[slots[i]]) * inverse_document_freq;
+		accumulator[slots[i]] += relevance;
+	}
+}
+
+__attribute__((target("avx512f")))
+__m512d PostingWeightAvx512(__m256i word_counts, __m512d norms, const PostingWeightForm& form) {
+	const __m512d counts = _mm512_maskz_cvtepi32_pd(0xFF, word_counts);
+	if (form.kind == PostingWeightKind::SATURATION) {
+		const __m512d length_norms = _mm512_add_pd(_mm512_set1_pd(form.offset),
+			_mm512_mul_pd(_mm512_set1_pd(form.length_scale), norms));
+		return _mm512_div_pd(_mm512_mul_pd(counts, _mm512_set1_pd(form.scale)), _mm512_add_pd(counts, length_norms));
+	}
+	return _mm512_div_pd(counts, norms);
+}
+
+//8 вхождений за инструкцию, два блока за итерацию: gather норм и аккумулятора, scatter аккумулятора
+template <bool Prefetch>
+__attribute__((target("avx512f")))
+void AccumulateTermRelevanceAvx512(const int* slots, const int* word_counts, size_t count, const double* document_norms,
+	const PostingWeightForm& form, double inverse_document_freq, double* accumulator) {
+	const __m512d idf = _mm512_set1_pd(inverse_document_freq);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		if (Prefetch && i + PREFETCH_DISTANCE + 16 <= count) {
+			PrefetchPostings(slots, i + PREFETCH_DISTANCE, 16, document_norms, accumulator);
+		}
+		const __m256i index0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slots + i));
+		const __m256i index1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slots + i + 8));
+		const __m256i counts0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(word_counts + i));
+		const __m256i counts1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(word_counts + i + 8));
+		const __m512d norms0 = GatherAvx512(document_norms, index0);
+		const __m512d norms1 = GatherAvx512(document_norms, index1);
+		const __m512d current0 = GatherAvx512(accumulator, index0);
+		const __m512d current1 = GatherAvx512(accumulator, index1);
+		const __m512d relevance0 = _mm512_mul_pd(PostingWeightAvx512(counts0, norms0, form), idf);
+		const __m512d relevance1 = _mm512_mul_pd(PostingWeightAvx512(counts1, norms1, form), idf);
+		_mm512_i32scatter_pd(accumulator, index0, _mm512_add_pd(current0, relevance0), 8);
+		_mm512_i32scatter_pd(accumulator, index1, _mm512_add_pd(current1, relevance1), 8);
+	}
+	for (; i + 8 <= count; i += 8) {
+		const __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(slots + i));
+		const __m256i counts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(word_counts + i));
+		const __m512d norms = GatherAvx512(document_norms, index);
+		const __m512d current = GatherAvx512(accumulator, index);
+		const __m512d relevance = _mm512_mul_pd(PostingWeightAvx512(counts, norms, form), idf);
+		_mm512_i32scatter_pd(accumulator, index, _mm512_add_pd(current, relevance), 8);
+	}
+	for (; i < count; ++i) {
+		const double relevance = ComputePostingWeight(form, word_counts[i], document_norms[slots[i]]) * inverse_document_freq;
+		accumulator[slots[i]] += relevance;
+	}
+}
+
+#endif
+
+struct SelectedKernel {
+	Kernel kernel;
+	Kernel prefetching_kernel;
+	const char* name;
+};
+
+SelectedKernel SelectKernel() {
+#ifdef SCORING_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		return { AccumulateTermRelevanceAvx512<false>, AccumulateTermRelevanceAvx512<true>, "avx512" };
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return { AccumulateTermRelevanceAvx2<false>, AccumulateTermRelevanceAvx2<true>, "avx2" };
+	}
+#endif
+	return { AccumulateTermRelevanceScalar<false>, AccumulateTermRelevanceScalar<true>, "portable" };
+}
+
+const SelectedKernel& GetSelectedKernel() {
+	static const SelectedKernel selected = SelectKernel();
+	return selected;
+}
+
+} // namespace
+
+double ComputePostingWeight(const PostingWeightForm& form, int word_count, double document_norm) {
+	if (form.kind == PostingWeightKind::SATURATION) {
+		return word_count * form.scale / (word_count + (form.offset + form.length_scale * document_norm));
+	}
+	return word_count / document_norm;
+}
+
+void AccumulateTermRelevancePortable(const int* slots, const int* word_counts, size_t count, const double* document_norms,
+	const PostingWeightForm& form, double inverse_document_freq, double* accumulator) {
+	AccumulateTermRelevanceScalar<false>(slots, word_counts, count, document_norms, form, inverse_document_freq,
+		accumulator);
+}
+
+void AccumulateTermRelevance(const int* slots, const int* word_counts, size_t count, const double* document_norms,
+	const PostingWeightForm& form, double inverse_document_freq, double* accumulator) {
+	GetSelectedKernel().kernel(slots, word_counts, count, document_norms, form, inverse_document_freq, accumulator);
+}
+
+const char* GetScoringKernelName() {
+	return GetSelectedKernel().name;
+}
+
+AccumulateTermRelevanceKernel GetScoringKernel(size_t document_count) {
+	const SelectedKernel& selected = GetSelectedKernel();
+	return document_count >= PREFETCH_MIN_DOCUMENTS ? selected.prefetching_kernel : selected.kernel;
+}
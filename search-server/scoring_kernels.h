@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+
+//Вид веса вхождения, который ядро подсчета получает из числа вхождений слова и нормы документа
+enum class PostingWeightKind {
+	//word_count / норма: TF при норме, равной длине документа
+	TERM_FREQUENCY,
+	//word_count * scale / (word_count + (offset + length_scale * норма)): насыщение BM25 при норме,
+	//равной длине документа; offset и length_scale зависят от средней длины и задаются на запрос
+	SATURATION,
+};
+
+struct PostingWeightForm {
+	PostingWeightKind kind = PostingWeightKind::TERM_FREQUENCY;
+	double scale = 1.0;
+	double offset = 0.0;
+	double length_scale = 1.0;
+};
+
+//Вес одного вхождения. Векторные реализации считают его теми же операциями в том же порядке
+double ComputePostingWeight(const PostingWeightForm& form, int word_count, double document_norm);
+
+//Прибавляет ComputePostingWeight(form, word_counts[i], document_norms[slots[i]]) * inverse_document_freq
+//к accumulator[slots[i]] для всех i < count.
+//Номера slots в пределах одного вызова не должны повторяться (в списке вхождений слова так и есть).
+//Реализация выбирается один раз при первом вызове по возможностям процессора: AVX-512, AVX2 или переносимая.
+//Умножение и сложение выполняются раздельно во всех реализациях, поэтому результат побитово совпадает.
+void AccumulateTermRelevance(const int* slots, const int* word_counts, size_t count, const double* document_norms,
+	const PostingWeightForm& form, double inverse_document_freq, double* accumulator);
+
+//Переносимая реализация без векторных инструкций
+void AccumulateTermRelevancePortable(const int* slots, const int* word_counts, size_t count, const double* document_norms,
+	const PostingWeightForm& form, double inverse_document_freq, double* accumulator);
+
+//Имя выбранной реализации: "avx512", "avx2" или "portable"
+const char* GetScoringKernelName();
+
+using AccumulateTermRelevanceKernel = void (*)(const int* slots, const int* word_counts, size_t count,
+	const double* document_norms, const PostingWeightForm& form, double inverse_document_freq, double* accumulator);
+
+//Число документов, с которого аккумулятор и нормы (по 8 байт на документ) уже не помещаются в кэш L2
+//и ядру выгодно заранее запрашивать строки для следующих вхождений
+constexpr size_t PREFETCH_MIN_DOCUMENTS = size_t{ 1 } << 17;
+
+//Выбранная реализация для аккумулятора на document_count документов (с упреждающей загрузкой начиная
+//с PREFETCH_MIN_DOCUMENTS, результат тот же): ее можно запомнить заранее и вызывать без проверки
+//однократной инициализации
+AccumulateTermRelevanceKernel GetScoringKernel(size_t document_count);
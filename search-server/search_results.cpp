@@ -0,0 +1,85 @@
+#include "search_results.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+using namespace std::string_literals;
+
+bool IsRankedBefore(const Document& lhs, const Document& rhs) {
+	if (lhs.relevance != rhs.relevance) {
+		return lhs.relevance > rhs.relevance;
+	}
+	if (lhs.rating != rhs.rating) {
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.id < rhs.id;
+}
+
+//релевантность записывается в шестнадцатеричном виде, чтобы пережить перевод в строку побитово
+std::string EncodeSearchCursor(const SearchCursor& cursor) {
+	char text[128];
+	std::snprintf(text, sizeof(text), "%a:%d:%d:%llu", cursor.after.relevance, cursor.after.rating, cursor.after.id,
+		static_cast<unsigned long long>(cursor.stop_words_version));
+	return text;
+}
+
+SearchCursor DecodeSearchCursor(std::string_view cursor) {
+	const std::string text{ cursor };
+	SearchCursor result;
+	Document& document = result.after;
+	unsigned long long stop_words_version = 0;
+	int consumed = 0;
+	if (std::sscanf(text.c_str(), "%lf:%d:%d:%llu%n", &document.relevance, &document.rating, &document.id,
+			&stop_words_version, &consumed) != 4
+		|| static_cast<size_t>(consumed) != text.size() || std::isnan(document.relevance)) {
+		throw std::invalid_argument("invalid search cursor ("s + text + ")"s);
+	}
+	result.stop_words_version = stop_words_version;
+	return result;
+}
+
+SearchResults::SearchResults(std::vector<Document> documents)
+	: documents_(std::move(documents)) {
+}
+
+std::vector<Document> SearchResults::NextPage(size_t page_size) {
+	const size_t count = std::min(page_size, documents_.size() - position_);
+	const auto page_begin = documents_.begin() + position_;
+	const auto page_end = page_begin + count;
+	std::partial_sort(page_begin, page_end, documents_.end(), IsRankedBefore);
+	position_ += count;
+	return { page_begin, page_end };
+}
+
+size_t SearchResults::GetMatchedCount() const {
+	return documents_.size();
+}
+
+size_t SearchResults::GetRemainingCount() const {
+	return documents_.size() - position_;
+}
+
+size_t SearchFacets::GetStatusCount(DocumentStatus status) const {
+	return status_counts[static_cast<size_t>(status)];
+}
+
+int SearchFacets::GetRatingBucket(int rating) const {
+	int bucket = rating / rating_bucket_width;
+	if (rating % rating_bucket_width < 0) {
+		--bucket;
+	}
+	return bucket * rating_bucket_width;
+}
+
+SearchFacets& SearchFacets::operator+=(const SearchFacets& other) {
+	for (size_t i = 0; i < status_counts.size(); ++i) {
+		status_counts[i] += other.status_counts[i];
+	}
+	for (const auto& [bucket, count] : other.rating_counts) {
+		rating_counts[bucket] += count;
+	}
+	return *this;
+}
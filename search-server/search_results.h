@@ -0,0 +1,79 @@
+#pragma once
+
+#include "document.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Строгий порядок постраничной выдачи: по убыванию релевантности, затем по убыванию рейтинга,
+//затем по возрастанию id. В отличие от IsMoreRelevant релевантность сравнивается точно,
+//поэтому порядок не зависит от набора документов и курсор однозначно задает место в выдаче
+bool IsRankedBefore(const Document& lhs, const Document& rhs);
+
+//Курсор - последний документ страницы и версия стоп-слов сервера, выдавшего страницу
+//(SearchServer::GetStopWordsVersion); следующая страница начинается с первого документа,
+//идущего после него в порядке IsRankedBefore
+struct SearchCursor {
+	Document after;
+	uint64_t stop_words_version = 0;
+};
+
+//курсор в виде непрозрачной строки
+std::string EncodeSearchCursor(const SearchCursor& cursor);
+
+//при неверном формате - std::invalid_argument
+SearchCursor DecodeSearchCursor(std::string_view cursor);
+
+//Страница выдачи и курсор следующей страницы (пустой, если страниц больше нет)
+struct SearchPage {
+	std::vector<Document> documents;
+	std::string next_cursor;
+};
+
+//Все найденные документы запроса, сохраненные для постраничного чтения. Документы упорядочиваются
+//по мере чтения: следующая страница - частичная сортировка еще не выданного остатка,
+//без повторного подсчета релевантности. Не зависит от сервера после создания
+class SearchResults {
+public:
+	SearchResults() = default;
+
+	explicit SearchResults(std::vector<Document> documents);
+
+	//следующие page_size документов (меньше на последней странице, пусто в конце)
+	std::vector<Document> NextPage(size_t page_size);
+
+	size_t GetMatchedCount() const;
+
+	size_t GetRemainingCount() const;
+
+private:
+	std::vector<Document> documents_;
+	size_t position_ = 0;
+};
+
+//Счетчики найденных запросом документов (до отбора предикатом): по статусу и по корзинам рейтинга
+//ширины rating_bucket_width; корзина задается нижней границей, [-5, -1] при ширине 5 - это -5
+struct SearchFacets {
+	int rating_bucket_width = 1;
+	std::array<size_t, 4> status_counts{};
+	std::map<int, size_t> rating_counts;
+
+	size_t GetStatusCount(DocumentStatus status) const;
+
+	//нижняя граница корзины рейтинга rating
+	int GetRatingBucket(int rating) const;
+
+	//сложение счетчиков двух частей выдачи с одинаковой шириной корзин
+	SearchFacets& operator+=(const SearchFacets& other);
+};
+
+//Лучшие документы запроса и счетчики всех найденных
+struct FacetedDocuments {
+	std::vector<Document> documents;
+	SearchFacets facets;
+};
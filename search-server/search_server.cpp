@@ -1,5 +1,51 @@
 #include "search_server.h"
 
+TermExpansion& TermExpansion::operator+=(const TermExpansion& other) {
+	//у каждой части первые по алфавиту слова на ее наименьшем расстоянии, поэтому первые limit слов
+	//объединения на наименьшем из расстояний - те же, что дал бы общий словарь
+	if (other.distance < distance) {
+		words = other.words;
+		distance = other.distance;
+	} else if (other.distance == distance) {
+		words.insert(words.end(), other.words.begin(), other.words.end());
+		std::sort(words.begin(), words.end());
+		words.erase(std::unique(words.begin(), words.end()), words.end());
+	}
+	limit = std::min(limit, other.limit);
+	if (words.size() > limit) {
+		words.resize(limit);
+	}
+	return *this;
+}
+
+CorpusStatistics& CorpusStatistics::operator+=(const CorpusStatistics& other) {
+	document_count += other.document_count;
+	total_document_length += other.total_document_length;
+	for (const auto& [word, document_freq] : other.document_freqs) {
+		document_freqs[word] += document_freq;
+	}
+	const auto merge = [](std::map<std::string, TermExpansion, std::less<>>& expansions,
+		const std::map<std::string, TermExpansion, std::less<>>& other_expansions) {
+		for (const auto& [word, expansion] : other_expansions) {
+			const auto [it, inserted] = expansions.try_emplace(word, expansion);
+			if (!inserted) {
+				it->second += expansion;
+			}
+		}
+	};
+	merge(prefix_expansions, other.prefix_expansions);
+	merge(fuzzy_expansions, other.fuzzy_expansions);
+	return *this;
+}
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+	if (std::abs(lhs.relevance - rhs.relevance) < RELEVANCE_TRESHOLD) {
+		return lhs.rating > rhs.rating;
+	} else {
+		return lhs.relevance > rhs.relevance;
+	}
+}
+
 SearchServer::SearchServer(const std::string& stop_words) {
 	MakeSetOfStopWords(SplitIntoWordsView(stop_words));
 }
@@ -22,18 +68,63 @@ void SearchServer::AddDocument(int document_id, const std::string_view& document
 	} catch (const std::invalid_argument& error) {
 		throw std::invalid_argument("doc's id ("s + std::to_string(document_id) + ") - "s + error.what());
 	}
+	if (memory_budget_ > 0) {
+		CheckMemoryBudget(words);
+	}
 	document_ids_.push_back(document_id);
-	const double inv_word_count = 1.0 / words.size();
+	const int slot = static_cast<int>(slot_ids_.size());
+	const int document_length = static_cast<int>(words.size());
+	std::map<std::string_view, int> word_counts;
 	for (const std::string_view& word : words) {
 		const auto& [it, is_inserted] = words_.insert(std::string{ word });
-		word_to_document_freqs_[*it][document_id] += inv_word_count;
-		document_to_word_freqs_[document_id][*it] += inv_word_count;
+		++word_counts[*it];
+		if (is_inserted) {
+			std::atomic_store(&term_dictionary_, std::shared_ptr<const TermDictionary>{});
+		}
+	}
+	//документ получает наибольший номер, поэтому списки вхождений остаются отсортированными
+	std::vector<ForwardEntry> forward_entries;
+	forward_entries.reserve(word_counts.size());
+	for (const auto& [word, word_count] : word_counts) {
+		const auto [it, is_new_word] = word_to_document_freqs_.try_emplace(word);
+		PostingList& postings = it->second;
+		if (is_new_word) {
+			postings.term_id = static_cast<uint32_t>(term_words_.size());
+			term_words_.push_back(it->first);
+		}
+		postings.slots.push_back(slot);
+		postings.word_counts.push_back(word_count);
+		forward_entries.push_back({ postings.term_id, static_cast<uint32_t>(word_count) });
+	}
+	if (forward_index_enabled_) {
+		std::sort(forward_entries.begin(), forward_entries.end(),
+			[](const ForwardEntry& lhs, const ForwardEntry& rhs) { return lhs.term_id < rhs.term_id; });
+		forward_index_.Add(slot, forward_entries);
+	}
+	if (positions_enabled_) {
+		std::map<std::string_view, std::vector<uint32_t>> word_positions;
+		for (size_t position = 0; position < words.size(); ++position) {
+			word_positions[words[position]].push_back(static_cast<uint32_t>(position));
+		}
+		for (const auto& [word, positions] : word_positions) {
+			PositionList& position_list = word_to_positions_[word_to_document_freqs_.find(word)->first];
+			position_list.offsets.push_back(static_cast<uint32_t>(position_list.bytes.size()));
+			AppendDeltaVarints(position_list.bytes, positions);
+		}
 	}
+	const int rating = ComputeAverageRating(ratings);
 	documents_.emplace(document_id,
 		DocumentData{
-			ComputeAverageRating(ratings),
-			status
+			rating,
+			status,
+			slot
 		});
+	slot_ids_.push_back(document_id);
+	slot_ratings_.push_back(rating);
+	slot_statuses_.push_back(status);
+	slot_lengths_.push_back(document_length);
+	slot_norms_.push_back(scorer_->DocumentNorm(document_length));
+	total_document_length_ += document_length;
 }
 
 std::vector<int>::const_iterator SearchServer::begin() const {
@@ -52,57 +143,571 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
 	return rating_sum / static_cast<int>(ratings.size());
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view& word) const {
-	return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view& word,
+	const CorpusStatistics* corpus_statistics) const {
+	if (corpus_statistics != nullptr) {
+		const auto it = corpus_statistics->document_freqs.find(word);
+		if (it != corpus_statistics->document_freqs.end()) {
+			return scorer_->TermWeight(corpus_statistics->document_count, it->second);
+		}
+	}
+	return scorer_->TermWeight(GetDocumentCount(), word_to_document_freqs_.at(word).slots.size());
+}
+
+PostingWeightForm SearchServer::GetPostingWeightForm(const CorpusStatistics* corpus_statistics) const {
+	if (corpus_statistics != nullptr && corpus_statistics->document_count > 0) {
+		return scorer_->GetPostingWeightForm(corpus_statistics->total_document_length * 1.0
+			/ corpus_statistics->document_count);
+	}
+	return scorer_->GetPostingWeightForm(documents_.empty() ? 0 : total_document_length_ * 1.0 / documents_.size());
 }
 
 size_t SearchServer::GetDocumentCount() const {
 	return documents_.size();
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-	static const std::map<std::string_view, double> empty_result;
-	return document_to_word_freqs_.count(document_id) ?
-		document_to_word_freqs_.at(document_id) :
-		empty_result;
+std::vector<Document> SearchServer::ExplainTopDocuments(const std::string_view& raw_query,
+	QueryProfile& profile) const {
+	return ExplainTopDocuments(std::execution::seq, raw_query, profile);
+}
+
+SearchPage SearchServer::FindPage(const std::string_view& raw_query, size_t page_size,
+	const std::string_view& cursor) const {
+	return FindPage(std::execution::seq, raw_query,
+		[](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::ACTUAL; },
+		page_size, cursor);
+}
+
+SearchResults SearchServer::FindAllPages(const std::string_view& raw_query) const {
+	return FindAllPages(std::execution::seq, raw_query,
+		[](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::ACTUAL; });
+}
+
+FacetedDocuments SearchServer::FindFacetedDocuments(const std::string_view& raw_query, int rating_bucket_width) const {
+	return FindFacetedDocuments(std::execution::seq, raw_query,
+		[](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::ACTUAL; },
+		rating_bucket_width);
+}
+
+CorpusStatistics SearchServer::GetQueryStatistics(const std::string_view& raw_query) const {
+	CorpusStatistics statistics;
+	QueryPar query = ParseQueryPar(raw_query, nullptr, &statistics);
+	query.Normalize();
+	statistics.document_count = GetDocumentCount();
+	statistics.total_document_length = static_cast<uint64_t>(total_document_length_);
+	for (const std::string_view& word : query.plus_words) {
+		const auto it = word_to_document_freqs_.find(word);
+		if (it != word_to_document_freqs_.end() && !it->second.slots.empty()) {
+			statistics.document_freqs.emplace(word, it->second.slots.size());
+		}
+	}
+	return statistics;
+}
+
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+	const auto it = documents_.find(document_id);
+	if (it == documents_.end()) {
+		return {};
+	}
+	const int slot = it->second.slot;
+	if (!forward_index_enabled_) {
+		return { ReconstructForwardEntries(slot), &term_words_, slot_lengths_[slot] };
+	}
+	return { forward_index_.begin(slot), forward_index_.end(slot), &term_words_, slot_lengths_[slot] };
+}
+
+std::pair<const ForwardEntry*, const ForwardEntry*> SearchServer::GetForwardEntries(int slot,
+	std::vector<ForwardEntry>& buffer) const {
+	if (forward_index_enabled_) {
+		return { forward_index_.begin(slot), forward_index_.end(slot) };
+	}
+	buffer = ReconstructForwardEntries(slot);
+	return { buffer.data(), buffer.data() + buffer.size() };
+}
+
+std::vector<ForwardEntry> SearchServer::ReconstructForwardEntries(int slot) const {
+	std::vector<ForwardEntry> entries;
+	for (const auto& [word, postings] : word_to_document_freqs_) {
+		const size_t index = FindPosting(postings, slot);
+		if (index < postings.slots.size()) {
+			entries.push_back({ postings.term_id, static_cast<uint32_t>(postings.word_counts[index]) });
+		}
+	}
+	std::sort(entries.begin(), entries.end(),
+		[](const ForwardEntry& lhs, const ForwardEntry& rhs) { return lhs.term_id < rhs.term_id; });
+	return entries;
+}
+
+bool SearchServer::FindWordInDocument(std::string_view word,
+	const std::pair<const ForwardEntry*, const ForwardEntry*>& entries, uint32_t& term_id) const {
+	const auto it = word_to_document_freqs_.find(word);
+	if (it == word_to_document_freqs_.end()) {
+		return false;
+	}
+	term_id = it->second.term_id;
+	const ForwardEntry* entry = std::lower_bound(entries.first, entries.second, term_id,
+		[](const ForwardEntry& entry, uint32_t id) { return entry.term_id < id; });
+	return entry != entries.second && entry->term_id == term_id;
+}
+
+void SearchServer::SetForwardIndexEnabled(bool enabled) {
+	if (enabled == forward_index_enabled_) {
+		return;
+	}
+	forward_index_enabled_ = enabled;
+	if (!enabled) {
+		forward_index_.Clear();
+		return;
+	}
+	RebuildForwardIndex();
+	InvalidateMemoryUsage();
+}
+
+void SearchServer::RebuildForwardIndex() {
+	forward_index_.Clear();
+	std::vector<std::vector<ForwardEntry>> slot_entries(slot_ids_.size());
+	for (const auto& [word, postings] : word_to_document_freqs_) {
+		for (size_t i = 0; i < postings.slots.size(); ++i) {
+			slot_entries[postings.slots[i]].push_back({ postings.term_id, static_cast<uint32_t>(postings.word_counts[i]) });
+		}
+	}
+	for (size_t slot = 0; slot < slot_entries.size(); ++slot) {
+		std::sort(slot_entries[slot].begin(), slot_entries[slot].end(),
+			[](const ForwardEntry& lhs, const ForwardEntry& rhs) { return lhs.term_id < rhs.term_id; });
+		forward_index_.Add(static_cast<int>(slot), slot_entries[slot]);
+	}
 }
 
 bool SearchServer::IsStopWord(const std::string_view& word) const {
 	return stop_words_.count(word) > 0;
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view& text) const {
-	Query query;
+SearchServer::QueryPar SearchServer::ParseQueryPar(const std::string_view& text,
+	const CorpusStatistics* corpus_statistics, CorpusStatistics* expansions) const {
+	QueryPar query;
+	//без логических запросов скобки, знак "+" и слова AND, OR, NOT - обычные символы и слова
+	QueryTokens tokens{ boolean_queries_enabled_ ? SplitQueryTokens(text) : SplitIntoWordsView(text) };
+	tokens.corpus_statistics = corpus_statistics;
+	tokens.expansions = expansions;
+	query.nodes.emplace_back();
+	ParseQueryGroup(tokens, query, 0, 0);
+	CollectQueryWords(query, 0, false);
+	//запрос без операторов и обязательных слов выполняется как раньше, без дерева
+	if (!tokens.is_boolean) {
+		query.nodes.clear();
+	}
+	return query;
+}
+
+std::vector<std::string_view> SearchServer::SplitQueryTokens(const std::string_view& text) {
+	std::vector<std::string_view> tokens;
 	for (const std::string_view& word : SplitIntoWordsView(text)) {
-		const QueryWord query_word = ParseQueryWord(word);
-		if (!query_word.is_stop) {
-			if (query_word.is_minus) {
-				query.minus_words.insert(query_word.data);
+		size_t begin = 0;
+		while (begin < word.size()) {
+			if (word[begin] == '(') {
+				tokens.push_back(word.substr(begin, 1));
+				++begin;
+			} else if (begin + 1 < word.size() && (word[begin] == '+' || word[begin] == '-') && word[begin + 1] == '(') {
+				tokens.push_back(word.substr(begin, 1));
+				++begin;
 			} else {
-				query.plus_words.insert(query_word.data);
+				break;
 			}
 		}
+		size_t end = word.size();
+		while (end > begin && word[end - 1] == ')') {
+			--end;
+		}
+		if (end > begin) {
+			tokens.push_back(word.substr(begin, end - begin));
+		}
+		for (; end < word.size(); ++end) {
+			tokens.push_back(word.substr(end, 1));
+		}
 	}
-	return query;
+	return tokens;
 }
 
-SearchServer::QueryPar SearchServer::ParseQueryPar(const std::string_view& text) const {
-	QueryPar query;
-	const std::vector<std::string_view> words = SplitIntoWordsView(text);
-	std::for_each(
-		words.begin(), words.end(),
-		[&](auto& word){
-			QueryWord query_word = ParseQueryWord(word);
+void SearchServer::ParseQueryGroup(QueryTokens& tokens, QueryPar& query, int node, int depth) const {
+	bool has_operand = false;
+	bool is_after_or = false;
+	while (tokens.position < tokens.tokens.size()) {
+		const std::string_view token = tokens.tokens[tokens.position];
+		if (boolean_queries_enabled_ && token == ")") {
+			if (depth == 0) {
+				throw std::invalid_argument("no opening \"(\" in query"s);
+			}
+			break;
+		}
+		if (boolean_queries_enabled_ && token == "OR") {
+			if (!has_operand || is_after_or) {
+				throw std::invalid_argument("no operand for OR in query"s);
+			}
+			tokens.is_boolean = true;
+			is_after_or = true;
+			++tokens.position;
+			continue;
+		}
+		//кавычки выделяют фразу только при включенном позиционном индексе, иначе это обычный символ слова
+		if (positions_enabled_ && token[0] == '"') {
+			if (depth > 0) {
+				throw std::invalid_argument("phrase inside parentheses in query"s);
+			}
+			ParseQueryPhrase(tokens, query);
+		} else if (const std::optional<BooleanClause> clause = ParseQueryAndChain(tokens, query, depth)) {
+			query.nodes[node].clauses.push_back(*clause);
+		}
+		has_operand = true;
+		is_after_or = false;
+	}
+	if (is_after_or) {
+		throw std::invalid_argument("no operand for OR in query"s);
+	}
+	if (depth > 0 && tokens.position == tokens.tokens.size()) {
+		throw std::invalid_argument("no closing \")\" in query"s);
+	}
+}
+
+std::optional<BooleanClause> SearchServer::ParseQueryAndChain(QueryTokens& tokens, QueryPar& query, int depth) const {
+	std::optional<BooleanClause> first = ParseQueryClause(tokens, query, depth);
+	if (!boolean_queries_enabled_ || tokens.position == tokens.tokens.size()
+		|| tokens.tokens[tokens.position] != "AND") {
+		return first;
+	}
+	tokens.is_boolean = true;
+	BooleanNode chain;
+	if (first) {
+		chain.clauses.push_back(*first);
+	}
+	while (tokens.position < tokens.tokens.size() && tokens.tokens[tokens.position] == "AND") {
+		++tokens.position;
+		if (const std::optional<BooleanClause> clause = ParseQueryClause(tokens, query, depth)) {
+			chain.clauses.push_back(*clause);
+		}
+	}
+	for (BooleanClause& clause : chain.clauses) {
+		if (clause.occur == Occur::SHOULD) {
+			clause.occur = Occur::MUST;
+		}
+	}
+	query.nodes.push_back(std::move(chain));
+	return BooleanClause{ Occur::SHOULD, {}, static_cast<int>(query.nodes.size() - 1) };
+}
+
+std::optional<BooleanClause> SearchServer::ParseQueryClause(QueryTokens& tokens, QueryPar& query, int depth) const {
+	if (tokens.position == tokens.tokens.size()) {
+		throw std::invalid_argument("no operand at the end of query"s);
+	}
+	std::string_view token = tokens.tokens[tokens.position++];
+	Occur occur = Occur::SHOULD;
+	if (boolean_queries_enabled_) {
+		if (token == "AND" || token == "OR" || token == ")") {
+			throw std::invalid_argument("no operand before \""s + std::string(token) + "\" in query"s);
+		}
+		if (token == "NOT") {
+			tokens.is_boolean = true;
+			std::optional<BooleanClause> clause = ParseQueryClause(tokens, query, depth);
+			if (clause) {
+				clause->occur = clause->occur == Occur::MUST_NOT ? Occur::MUST : Occur::MUST_NOT;
+			}
+			return clause;
+		}
+		if ((token == "+" || token == "-") && tokens.position < tokens.tokens.size()
+			&& tokens.tokens[tokens.position] == "(") {
+			occur = token == "+" ? Occur::MUST : Occur::MUST_NOT;
+			token = tokens.tokens[tokens.position++];
+		}
+		if (token == "(") {
+			tokens.is_boolean = true;
+			const int child = static_cast<int>(query.nodes.size());
+			query.nodes.emplace_back();
+			ParseQueryGroup(tokens, query, child, depth + 1);
+			++tokens.position;
+			return BooleanClause{ occur, {}, child };
+		}
+	}
+	if (positions_enabled_ && token[0] == '"') {
+		throw std::invalid_argument("phrase as operand in query"s);
+	}
+	const QueryWord query_word = ParseQueryWord(token);
+	if (query_word.is_required) {
+		tokens.is_boolean = true;
+	}
+	occur = query_word.is_minus ? Occur::MUST_NOT : query_word.is_required ? Occur::MUST : Occur::SHOULD;
+	//слово с вариантами (префикс или нечеткий поиск) - группа, которой достаточно любого варианта
+	std::vector<std::string_view> alternatives;
+	if (query_word.is_prefix) {
+		ExpandQueryPrefix(tokens, query_word.data, alternatives);
+	} else if (query_word.is_stop) {
+		return std::nullopt;
+	} else if (query_word.is_minus || fuzzy_max_distance_ == 0
+		|| !ExpandQueryFuzzy(tokens, query_word.data, alternatives)) {
+		return BooleanClause{ occur, query_word.data, -1 };
+	}
+	BooleanNode node;
+	node.is_alternatives = true;
+	for (const std::string_view& word : alternatives) {
+		node.clauses.push_back({ Occur::SHOULD, word, -1 });
+	}
+	query.nodes.push_back(std::move(node));
+	return BooleanClause{ occur, {}, static_cast<int>(query.nodes.size() - 1) };
+}
+
+void SearchServer::ParseQueryPhrase(QueryTokens& tokens, QueryPar& query) const {
+	std::vector<std::string_view> phrase;
+	bool in_phrase = false;
+	do {
+		std::string_view word = tokens.tokens[tokens.position++];
+		if (!in_phrase) {
+			word.remove_prefix(1);
+			in_phrase = true;
+		}
+		if (!word.empty() && word.back() == '"') {
+			word.remove_suffix(1);
+			in_phrase = false;
+		}
+		if (!word.empty()) {
+			const QueryWord query_word = ParseQueryWord(word);
+			if (query_word.is_minus) {
+				throw std::invalid_argument("minus-word inside phrase in query"s);
+			}
+			if (query_word.is_prefix) {
+				throw std::invalid_argument("prefix inside phrase in query"s);
+			}
 			if (!query_word.is_stop) {
-				if (query_word.is_minus) {
-					query.minus_words.push_back(move(query_word.data));
-				} else {
-					query.plus_words.push_back(move(query_word.data));
+				phrase.push_back(query_word.data);
+			}
+		}
+	} while (in_phrase && tokens.position < tokens.tokens.size());
+	if (in_phrase) {
+		throw std::invalid_argument("no closing quote in query phrase"s);
+	}
+	//слова фразы из нескольких слов обязательны, фраза из одного слова - обычное слово
+	const Occur occur = phrase.size() > 1 ? Occur::MUST : Occur::SHOULD;
+	for (const std::string_view& word : phrase) {
+		query.nodes[0].clauses.push_back({ occur, word, -1 });
+	}
+	if (phrase.size() > 1) {
+		query.phrases.push_back(std::move(phrase));
+	}
+}
+
+void SearchServer::CollectQueryWords(QueryPar& query, int node, bool is_negated) {
+	for (const BooleanClause& clause : query.nodes[node].clauses) {
+		const bool is_excluded = is_negated != (clause.occur == Occur::MUST_NOT);
+		//исключенные слова корня (и варианты исключенного слова) - минус-слова запроса
+		if (node == 0 && clause.occur == Occur::MUST_NOT) {
+			if (clause.child < 0) {
+				query.minus_words.push_back(clause.word);
+			} else if (query.nodes[clause.child].is_alternatives) {
+				for (const BooleanClause& alternative : query.nodes[clause.child].clauses) {
+					query.minus_words.push_back(alternative.word);
 				}
 			}
 		}
-	);
-	return query;
+		if (clause.child >= 0) {
+			CollectQueryWords(query, clause.child, is_excluded);
+		} else if (!is_excluded) {
+			query.plus_words.push_back(clause.word);
+		}
+	}
+}
+
+std::vector<int> SearchServer::FindBooleanSlots(const QueryPar& query) const {
+	BooleanMatcher matcher(query.nodes, [this](std::string_view word) -> const std::vector<int>* {
+		const auto it = word_to_document_freqs_.find(word);
+		return it == word_to_document_freqs_.end() ? nullptr : &it->second.slots;
+	});
+	return matcher.FindSlots();
+}
+
+std::vector<SearchServer::SlotRange> SearchServer::AccumulateRelevance(const QueryPar& query,
+	IndexVector<double>& accumulator, std::vector<int>& candidates, const CorpusStatistics* corpus_statistics,
+	QueryTimer& timer, bool parallel) const {
+	//сначала находятся списки вхождений и веса слов, затем идет подсчет - этапы замеряются отдельно
+	//части считаются в других потоках, поэтому лямбды захватывают ссылки на буферы этого потока (см. FindAllDocuments)
+	thread_local std::vector<std::pair<const PostingList*, double>> thread_terms;
+	thread_local std::vector<const PostingList*> thread_minus_terms;
+	std::vector<std::pair<const PostingList*, double>>& terms = thread_terms;
+	std::vector<const PostingList*>& minus_terms = thread_minus_terms;
+	terms.clear();
+	minus_terms.clear();
+	size_t total_postings = 0;
+	for (const std::string_view& plus_word : query.plus_words) {
+		const auto it = word_to_document_freqs_.find(plus_word);
+		if (it != word_to_document_freqs_.end()) {
+			terms.emplace_back(&it->second, ComputeWordInverseDocumentFreq(plus_word, corpus_statistics));
+			total_postings += it->second.slots.size();
+		}
+	}
+	for (const std::string_view& minus_word : query.minus_words) {
+		const auto it = word_to_document_freqs_.find(minus_word);
+		if (it != word_to_document_freqs_.end()) {
+			minus_terms.push_back(&it->second);
+		}
+	}
+	//логический запрос: кандидаты отбираются пересечением списков от самого короткого,
+	//а вхождения слов ищутся только для кандидатов
+	const bool is_boolean = !query.nodes.empty();
+	//без позиционных ограничений, которые просматривают весь аккумулятор, заполняются только кандидаты
+	const bool is_sparse = is_boolean && !positions_enabled_;
+	candidates.clear();
+	if (is_boolean) {
+		candidates = FindBooleanSlots(query);
+		total_postings = candidates.size() * terms.size();
+	}
+	timer.Lap(QueryStage::POSTING_FETCH);
+	QueryProfile* const profile = timer.GetProfile();
+	if (profile != nullptr) {
+		profile->scoring_kernel = GetScoringKernelName();
+		AddTermProfiles(query, corpus_statistics, *profile);
+		if (is_boolean) {
+			profile->pruning = true;
+			for (TermProfile& term : profile->terms) {
+				if (!term.is_minus) {
+					term.postings_scanned = std::min(term.posting_list_length, candidates.size());
+					term.postings_skipped = term.posting_list_length - term.postings_scanned;
+				}
+			}
+		}
+	}
+
+	const PostingWeightForm weight_form = GetPostingWeightForm(corpus_statistics);
+	const AccumulateTermRelevanceKernel kernel = GetScoringKernel(slot_ids_.size());
+
+	//число частей растет с объемом работы (вхождения плюс просмотр аккумулятора), а не с числом слов
+	const size_t slot_count = slot_ids_.size();
+	size_t range_count = 1;
+	if (parallel) {
+		range_count = std::clamp<size_t>((total_postings + slot_count) / MIN_RANGE_WORK, 1, MAX_THREADS);
+	}
+	std::vector<SlotRange> ranges(range_count);
+	for (size_t i = 0; i < range_count; ++i) {
+		ranges[i] = { slot_count * i / range_count, slot_count * (i + 1) / range_count };
+	}
+	//позиции вхождений с плотными номерами из [range.begin, range.end) в отсортированном списке
+	const auto find_postings = [slot_count](const PostingList& postings, const SlotRange& range) {
+		const int* const slots = postings.slots.data();
+		const int* first = slots;
+		const int* last = slots + postings.slots.size();
+		if (range.begin > 0) {
+			first = std::lower_bound(first, last, static_cast<int>(range.begin));
+		}
+		if (range.end < slot_count) {
+			last = std::lower_bound(first, last, static_cast<int>(range.end));
+		}
+		return std::pair{ static_cast<size_t>(first - slots), static_cast<size_t>(last - slots) };
+	};
+	const auto for_each_range = [&ranges, range_count](auto function) {
+		if (range_count == 1) {
+			function(ranges.front());
+		} else {
+			std::for_each(std::execution::par, ranges.begin(), ranges.end(), function);
+		}
+	};
+
+	//-0.0 отмечает документ, не затронутый запросом: прибавление неотрицательной релевантности
+	//к -0.0 дает тот же результат, что и к 0.0, но снимает знак, поэтому баллы не меняются.
+	//Части пишут в непересекающиеся участки общего аккумулятора, а слова в каждой части
+	//обрабатываются в том же порядке, что и без разбиения, поэтому баллы совпадают побитово
+	accumulator.resize(slot_count);
+	for_each_range([&](const SlotRange& range) {
+		if (is_boolean) {
+			const int* const all_candidates_end = candidates.data() + candidates.size();
+			const int* const candidates_begin = std::lower_bound(static_cast<const int*>(candidates.data()),
+				all_candidates_end, static_cast<int>(range.begin));
+			const int* const candidates_end = std::lower_bound(candidates_begin, all_candidates_end,
+				static_cast<int>(range.end));
+			if (is_sparse) {
+				for (const int* candidate = candidates_begin; candidate != candidates_end; ++candidate) {
+					accumulator[*candidate] = -0.0;
+				}
+			} else {
+				std::fill(accumulator.begin() + range.begin, accumulator.begin() + range.end, -0.0);
+			}
+			for (const auto& [postings, inverse_document_freq] : terms) {
+				const auto [first, last] = find_postings(*postings, range);
+				const int* const slots = postings->slots.data();
+				const int* posting = slots + first;
+				for (const int* candidate = candidates_begin; candidate != candidates_end; ++candidate) {
+					posting = GallopLowerBound(posting, slots + last, *candidate);
+					if (posting == slots + last) {
+						break;
+					}
+					if (*posting == *candidate) {
+						const double relevance = ComputePostingWeight(weight_form, postings->word_counts[posting - slots],
+							slot_norms_[*candidate]) * inverse_document_freq;
+						accumulator[*candidate] += relevance;
+					}
+				}
+			}
+			return;
+		}
+		std::fill(accumulator.begin() + range.begin, accumulator.begin() + range.end, -0.0);
+		for (const auto& [postings, inverse_document_freq] : terms) {
+			const auto [first, last] = find_postings(*postings, range);
+			kernel(postings->slots.data() + first, postings->word_counts.data() + first, last - first,
+				slot_norms_.data(), weight_form, inverse_document_freq, accumulator.data());
+		}
+	});
+	timer.AddPostingsScanned(total_postings);
+	timer.Lap(QueryStage::SCORING);
+	if (profile != nullptr) {
+		profile->candidates = is_sparse ? candidates.size() : CountCandidates(accumulator);
+	}
+	//в логическом запросе минус-слова уже учтены при отборе кандидатов
+	if (!minus_terms.empty() && !is_boolean) {
+		for_each_range([&](const SlotRange& range) {
+			for (const PostingList* postings : minus_terms) {
+				const auto [first, last] = find_postings(*postings, range);
+				for (size_t i = first; i < last; ++i) {
+					accumulator[postings->slots[i]] = -0.0;
+				}
+			}
+		});
+	}
+	if (positions_enabled_) {
+		ApplyPositionalConstraints(query, accumulator);
+	}
+	timer.Lap(QueryStage::MINUS_FILTER);
+	if (profile != nullptr) {
+		profile->candidates_after_minus = is_sparse ? candidates.size() : CountCandidates(accumulator);
+	}
+	if (!is_sparse) {
+		candidates.clear();
+	} else if (candidates.empty()) {
+		//аккумулятор не заполнен, просматривать нечего
+		ranges.clear();
+	}
+	return ranges;
+}
+
+size_t SearchServer::CountCandidates(const IndexVector<double>& accumulator) {
+	return std::count_if(accumulator.begin(), accumulator.end(), [](double relevance) { return !std::signbit(relevance); });
+}
+
+void SearchServer::AddTermProfiles(const QueryPar& query, const CorpusStatistics* corpus_statistics,
+	QueryProfile& profile) const {
+	const auto add_term = [&](const std::string_view& word, bool is_minus) {
+		TermProfile term;
+		term.word = std::string(word);
+		term.is_minus = is_minus;
+		const auto it = word_to_document_freqs_.find(word);
+		if (it != word_to_document_freqs_.end()) {
+			term.posting_list_length = it->second.slots.size();
+			term.postings_scanned = term.posting_list_length;
+			if (!is_minus) {
+				term.inverse_document_freq = ComputeWordInverseDocumentFreq(word, corpus_statistics);
+			}
+		}
+		profile.terms.push_back(std::move(term));
+	};
+	for (const std::string_view& word : query.plus_words) {
+		add_term(word, false);
+	}
+	for (const std::string_view& word : query.minus_words) {
+		add_term(word, true);
+	}
 }
 
 SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
@@ -123,34 +728,36 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
 			throw std::invalid_argument("double \"-\" in query minus-word"s);
 		}
 	}
+	bool is_required = false;
+	if (!is_minus && boolean_queries_enabled_ && text[0] == '+') {
+		is_required = true;
+		text = text.substr(1);
+		if (text.empty()) {
+			throw std::invalid_argument("no characters after \"+\" in query"s);
+		}
+		if (text[0] == '+' || text[0] == '-') {
+			throw std::invalid_argument("double sign in query required word"s);
+		}
+	}
+	const bool is_prefix = text.back() == '*';
+	if (is_prefix) {
+		text.remove_suffix(1);
+		if (text.empty()) {
+			throw std::invalid_argument("no characters before \"*\" in query"s);
+		}
+	}
 	return {
 		text,
 		is_minus,
-		IsStopWord(text)
+		IsStopWord(text),
+		is_prefix,
+		is_required
 	};
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view& raw_query,
 	int document_id) const {
-	const Query query = ParseQuery(raw_query);
-	std::vector<std::string_view> matched_words;
-	for (const std::string_view& word : query.minus_words) {
-		if (!word_to_document_freqs_.count(word)) {
-			continue;
-		}
-		if (word_to_document_freqs_.at(word).count(document_id)) {
-			return { matched_words, documents_.at(document_id).status };
-		}
-	}
-	for (const std::string_view& word : query.plus_words) {
-		if (!word_to_document_freqs_.count(word)) {
-			continue;
-		}
-		if (word_to_document_freqs_.at(word).count(document_id)) {
-			matched_words.push_back(word_to_document_freqs_.find(word)->first);
-		}
-	}
-	return { matched_words, documents_.at(document_id).status };
+	return MatchDocument(ParseMatchQuery(raw_query), document_id);
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy seq,
@@ -160,29 +767,79 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy par,
 	const std::string_view& raw_query, int document_id) const {
-	const QueryPar query = ParseQueryPar(raw_query);
+	//один документ не стоит делить между потоками: слияние со словами запроса линейно и короче запуска задач
+	return SearchServer::MatchDocument(raw_query, document_id);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(
+	const std::string_view& raw_query, const std::vector<int>& document_ids) const {
+	return MatchDocuments(std::execution::seq, raw_query, document_ids);
+}
+
+SearchServer::MatchQuery SearchServer::ParseMatchQuery(const std::string_view& raw_query) const {
+	QueryPar query_par = ParseQueryPar(raw_query);
+	query_par.Normalize();
+	MatchQuery query;
+	for (const std::string_view& word : query_par.plus_words) {
+		const auto it = word_to_document_freqs_.find(word);
+		if (it != word_to_document_freqs_.end()) {
+			query.plus_terms.emplace_back(it->second.term_id, it->first);
+		}
+	}
+	for (const std::string_view& word : query_par.minus_words) {
+		const auto it = word_to_document_freqs_.find(word);
+		if (it != word_to_document_freqs_.end()) {
+			query.minus_terms.push_back(it->second.term_id);
+		}
+	}
+	std::sort(query.plus_terms.begin(), query.plus_terms.end());
+	std::sort(query.minus_terms.begin(), query.minus_terms.end());
+	query.phrases = std::move(query_par.phrases);
+	query.nodes = std::move(query_par.nodes);
+	return query;
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const MatchQuery& query,
+	int document_id) const {
+	const DocumentData& document = documents_.at(document_id);
+	std::vector<ForwardEntry> buffer;
+	const auto [entries_begin, entries_end] = GetForwardEntries(document.slot, buffer);
 	std::vector<std::string_view> matched_words;
-	for (const std::string_view& word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) && word_to_document_freqs_.at(word).count(document_id)) {
-			return { matched_words, documents_.at(document_id).status };
+	//слияние с отсортированными словами запроса: поиск каждого следующего слова продолжается с найденного места
+	const auto term_id_less = [](const ForwardEntry& entry, uint32_t term_id) { return entry.term_id < term_id; };
+	const ForwardEntry* entry = entries_begin;
+	for (const uint32_t term_id : query.minus_terms) {
+		entry = std::lower_bound(entry, entries_end, term_id, term_id_less);
+		if (entry != entries_end && entry->term_id == term_id) {
+			return { matched_words, document.status };
 		}
 	}
-	matched_words.resize(query.plus_words.size());
-	std::transform(par,
-		query.plus_words.begin(), query.plus_words.end(),
-		matched_words.begin(),
-		[&matched_words, this, document_id](auto& word) {
-			return word_to_document_freqs_.count(word) && word_to_document_freqs_.at(word).count(document_id) ?
-				word : "";
+	for (const auto& phrase : query.phrases) {
+		if (!ContainsPhrase(document.slot, phrase)) {
+			return { matched_words, document.status };
+		}
+	}
+	if (!query.nodes.empty()) {
+		const auto contains = [&](std::string_view word) {
+			uint32_t term_id = 0;
+			return FindWordInDocument(word, { entries_begin, entries_end }, term_id);
+		};
+		if (!BooleanMatcher::Matches(query.nodes, contains)) {
+			return { matched_words, document.status };
 		}
-	);
-	std::sort(matched_words.begin(), matched_words.end());
-	auto it = std::unique(matched_words.begin(), matched_words.end());
-	matched_words.erase(it, matched_words.end());
-	if (*matched_words.begin() == "") {
-		matched_words.erase(matched_words.begin());
 	}
-	return { matched_words, documents_.at(document_id).status };
+	entry = entries_begin;
+	for (const auto& [term_id, word] : query.plus_terms) {
+		entry = std::lower_bound(entry, entries_end, term_id, term_id_less);
+		if (entry == entries_end) {
+			break;
+		}
+		if (entry->term_id == term_id) {
+			matched_words.push_back(word);
+		}
+	}
+	std::sort(matched_words.begin(), matched_words.end());
+	return { matched_words, document.status };
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, const DocumentStatus filter_status) const {
@@ -196,7 +853,254 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw
 
 void SearchServer::SetStopWords(const std::string_view& text) {
 	const std::vector<std::string_view> stop_words = SplitIntoWordsView(text);
+	CheckStopWords(stop_words);
+	//последовательности слов затронутых документов собираются до изменения списков,
+	//а позиции по ним перекодируются после
+	std::map<int, std::vector<std::string_view>> sequences;
+	if (positions_enabled_) {
+		std::vector<int> slots;
+		for (const std::string_view& word : stop_words) {
+			const auto it = word_to_document_freqs_.find(word);
+			if (it != word_to_document_freqs_.end() && !IsStopWord(word)) {
+				slots.insert(slots.end(), it->second.slots.begin(), it->second.slots.end());
+			}
+		}
+		sequences = CollectStoredSequences(std::move(slots));
+	}
 	MakeSetOfStopWords(stop_words);
+	++stop_words_version_;
+	std::vector<int> changed_slots;
+	for (const std::string_view& word : stop_words) {
+		const auto it = word_to_document_freqs_.find(word);
+		if (it == word_to_document_freqs_.end() || it->second.slots.empty()) {
+			continue;
+		}
+		//запись в word_to_document_freqs_ остается: на нее ссылается номер слова
+		PostingList& postings = it->second;
+		auto& [stopped, stopped_positions] = stopped_postings_[it->first];
+		stopped.term_id = postings.term_id;
+		stopped.slots = std::move(postings.slots);
+		stopped.word_counts = std::move(postings.word_counts);
+		postings = PostingList{ stopped.term_id };
+		if (positions_enabled_) {
+			stopped_positions = std::move(word_to_positions_[it->first]);
+			word_to_positions_[it->first] = PositionList{};
+		}
+		for (size_t i = 0; i < stopped.slots.size(); ++i) {
+			const int slot = stopped.slots[i];
+			slot_lengths_[slot] -= stopped.word_counts[i];
+			total_document_length_ -= stopped.word_counts[i];
+			if (forward_index_enabled_) {
+				std::vector<ForwardEntry> entries(forward_index_.begin(slot), forward_index_.end(slot));
+				entries.erase(std::find_if(entries.begin(), entries.end(),
+					[&stopped](const ForwardEntry& entry) { return entry.term_id == stopped.term_id; }));
+				forward_index_.Replace(slot, entries);
+			}
+		}
+		changed_slots.insert(changed_slots.end(), stopped.slots.begin(), stopped.slots.end());
+	}
+	if (!changed_slots.empty()) {
+		std::atomic_store(&term_dictionary_, std::shared_ptr<const TermDictionary>{});
+		UpdateDocumentNorms(changed_slots);
+	}
+	if (positions_enabled_) {
+		ReencodePositions(sequences);
+	}
+	InvalidateMemoryUsage();
+}
+
+void SearchServer::RemoveStopWords(const std::string_view& text) {
+	const std::vector<std::string_view> words = SplitIntoWordsView(text);
+	CheckStopWords(words);
+	std::map<int, std::vector<std::string_view>> sequences;
+	if (positions_enabled_) {
+		std::vector<int> slots;
+		for (const std::string_view& word : words) {
+			const auto it = stopped_postings_.find(word);
+			if (it == stopped_postings_.end()) {
+				continue;
+			}
+			for (const int slot : it->second.first.slots) {
+				if (slot_ids_[slot] >= 0) {
+					slots.push_back(slot);
+				}
+			}
+		}
+		sequences = CollectStoredSequences(std::move(slots));
+	}
+	++stop_words_version_;
+	std::vector<int> changed_slots;
+	for (const std::string_view& word : words) {
+		const auto stop_word = stop_words_.find(word);
+		if (stop_word != stop_words_.end()) {
+			stop_words_.erase(stop_word);
+		}
+		const auto it = stopped_postings_.find(word);
+		if (it == stopped_postings_.end()) {
+			continue;
+		}
+		const auto& [stopped, stopped_positions] = it->second;
+		//пока слово было стоп-словом, новые документы его не получали, поэтому список пуст
+		PostingList& postings = word_to_document_freqs_.at(it->first);
+		PositionList positions;
+		for (size_t i = 0; i < stopped.slots.size(); ++i) {
+			const int slot = stopped.slots[i];
+			//документ удален, пока слово было стоп-словом
+			if (slot_ids_[slot] < 0) {
+				continue;
+			}
+			postings.slots.push_back(slot);
+			postings.word_counts.push_back(stopped.word_counts[i]);
+			slot_lengths_[slot] += stopped.word_counts[i];
+			total_document_length_ += stopped.word_counts[i];
+			if (forward_index_enabled_) {
+				std::vector<ForwardEntry> entries(forward_index_.begin(slot), forward_index_.end(slot));
+				const ForwardEntry entry{ postings.term_id, static_cast<uint32_t>(stopped.word_counts[i]) };
+				entries.insert(std::lower_bound(entries.begin(), entries.end(), entry,
+					[](const ForwardEntry& lhs, const ForwardEntry& rhs) { return lhs.term_id < rhs.term_id; }), entry);
+				forward_index_.Replace(slot, entries);
+			}
+			if (positions_enabled_) {
+				const uint32_t begin = stopped_positions.offsets[i];
+				const uint32_t end = i + 1 < stopped_positions.offsets.size() ?
+					stopped_positions.offsets[i + 1] :
+					static_cast<uint32_t>(stopped_positions.bytes.size());
+				positions.offsets.push_back(static_cast<uint32_t>(positions.bytes.size()));
+				positions.bytes.insert(positions.bytes.end(),
+					stopped_positions.bytes.begin() + begin, stopped_positions.bytes.begin() + end);
+			}
+			changed_slots.push_back(slot);
+		}
+		if (positions_enabled_) {
+			word_to_positions_[it->first] = std::move(positions);
+		}
+		stopped_postings_.erase(it);
+	}
+	if (!changed_slots.empty()) {
+		std::atomic_store(&term_dictionary_, std::shared_ptr<const TermDictionary>{});
+		UpdateDocumentNorms(changed_slots);
+	}
+	if (positions_enabled_) {
+		ReencodePositions(sequences);
+	}
+	InvalidateMemoryUsage();
+}
+
+void SearchServer::CheckStopWords(const std::vector<std::string_view>& words) {
+	for (const std::string_view& word : words) {
+		if (!IsValidWord(word)) {
+			throw std::invalid_argument("control character in stop-words"s);
+		}
+	}
+}
+
+std::map<int, std::vector<std::string_view>> SearchServer::CollectStoredSequences(std::vector<int> slots) const {
+	std::sort(slots.begin(), slots.end());
+	slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+	//позиции и слова каждого документа: отдельно действующие слова и ставшие стоп-словами
+	std::map<int, std::vector<std::pair<uint32_t, std::string_view>>> active_words;
+	std::map<int, std::vector<std::pair<uint32_t, std::string_view>>> stopped_words;
+	std::vector<uint32_t> positions;
+	const auto collect = [&slots, &positions](std::string_view word, const PostingList& postings,
+		const PositionList& position_list, auto& words) {
+		for (size_t i = 0; i < postings.slots.size(); ++i) {
+			if (!std::binary_search(slots.begin(), slots.end(), postings.slots[i])) {
+				continue;
+			}
+			DecodePositions(position_list, i, positions);
+			auto& document_words = words[postings.slots[i]];
+			for (const uint32_t position : positions) {
+				document_words.emplace_back(position, word);
+			}
+		}
+	};
+	for (const auto& [word, position_list] : word_to_positions_) {
+		collect(word, word_to_document_freqs_.at(word), position_list, active_words);
+	}
+	for (const auto& [word, stopped] : stopped_postings_) {
+		collect(word, stopped.first, stopped.second, stopped_words);
+	}
+	//стоп-слова стоят на своих местах, действующие слова по порядку занимают оставшиеся
+	std::map<int, std::vector<std::string_view>> sequences;
+	for (const int slot : slots) {
+		auto& active = active_words[slot];
+		const auto& stopped = stopped_words[slot];
+		std::vector<std::string_view> sequence(active.size() + stopped.size());
+		std::vector<bool> is_taken(sequence.size(), false);
+		for (const auto& [position, word] : stopped) {
+			if (position >= sequence.size() || is_taken[position]) {
+				throw std::logic_error("inconsistent positions of stop-words"s);
+			}
+			sequence[position] = word;
+			is_taken[position] = true;
+		}
+		std::sort(active.begin(), active.end());
+		size_t position = 0;
+		for (const auto& [active_position, word] : active) {
+			while (is_taken[position]) {
+				++position;
+			}
+			sequence[position++] = word;
+		}
+		sequences.emplace(slot, std::move(sequence));
+	}
+	return sequences;
+}
+
+void SearchServer::ReencodePositions(const std::map<int, std::vector<std::string_view>>& sequences) {
+	//новые позиции по словам и документам: у действующего слова - среди действующих слов документа,
+	//у стоп-слова - среди всех сохраненных
+	std::map<std::string_view, std::map<int, std::vector<uint32_t>>> word_positions;
+	for (const auto& [slot, sequence] : sequences) {
+		uint32_t active_position = 0;
+		for (uint32_t position = 0; position < sequence.size(); ++position) {
+			const std::string_view word = sequence[position];
+			if (stopped_postings_.count(word) > 0) {
+				word_positions[word][slot].push_back(position);
+			} else {
+				word_positions[word][slot].push_back(active_position++);
+			}
+		}
+	}
+	const auto reencode = [](const PostingList& postings, PositionList& position_list,
+		const std::map<int, std::vector<uint32_t>>& slot_positions) {
+		PositionList result;
+		result.offsets.reserve(postings.slots.size());
+		result.bytes.reserve(position_list.bytes.size());
+		for (size_t i = 0; i < postings.slots.size(); ++i) {
+			result.offsets.push_back(static_cast<uint32_t>(result.bytes.size()));
+			const auto it = slot_positions.find(postings.slots[i]);
+			if (it != slot_positions.end()) {
+				AppendDeltaVarints(result.bytes, it->second);
+				continue;
+			}
+			const uint32_t begin = position_list.offsets[i];
+			const uint32_t end = i + 1 < position_list.offsets.size() ?
+				position_list.offsets[i + 1] :
+				static_cast<uint32_t>(position_list.bytes.size());
+			result.bytes.insert(result.bytes.end(), position_list.bytes.begin() + begin, position_list.bytes.begin() + end);
+		}
+		position_list = std::move(result);
+	};
+	for (const auto& [word, slot_positions] : word_positions) {
+		const auto stopped = stopped_postings_.find(word);
+		if (stopped != stopped_postings_.end()) {
+			reencode(stopped->second.first, stopped->second.second, slot_positions);
+		} else {
+			reencode(word_to_document_freqs_.at(word), word_to_positions_.at(word), slot_positions);
+		}
+	}
+}
+
+uint64_t SearchServer::GetStopWordsVersion() const {
+	return stop_words_version_;
+}
+
+void SearchServer::UpdateDocumentNorms(const std::vector<int>& slots) {
+	//веса вхождений выводятся из нормы при подсчете, поэтому списки вхождений не меняются
+	for (const int slot : slots) {
+		slot_norms_[slot] = scorer_->DocumentNorm(slot_lengths_[slot]);
+	}
 }
 
 std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view& text) const {
@@ -213,12 +1117,21 @@ std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::stri
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-	if (!document_to_word_freqs_.count(document_id)) {
+	if (!documents_.count(document_id)) {
 		return;
 	}
-	const auto& delete_collection = document_to_word_freqs_.at(document_id);
-	for (const auto& [str, d] : delete_collection) {
-		word_to_document_freqs_.at(str).erase(document_id);
+	std::atomic_store(&term_dictionary_, std::shared_ptr<const TermDictionary>{});
+	const int slot = documents_.at(document_id).slot;
+	std::vector<ForwardEntry> buffer;
+	const auto [entries_begin, entries_end] = GetForwardEntries(slot, buffer);
+	for (const ForwardEntry* entry = entries_begin; entry != entries_end; ++entry) {
+		const std::string_view str = term_words_[entry->term_id];
+		PostingList& postings = word_to_document_freqs_.at(str);
+		const size_t index = FindPosting(postings, slot);
+		ErasePosting(postings, index);
+		if (positions_enabled_) {
+			ErasePositions(word_to_positions_.at(str), index);
+		}
 	}
 	SearchServer::EraseOther(document_id);
 }
@@ -228,26 +1141,795 @@ void SearchServer::RemoveDocument(std::execution::sequenced_policy seq, int docu
 }
 
 void SearchServer::RemoveDocument(std::execution::parallel_policy par, int document_id) {
-	if (!document_to_word_freqs_.count(document_id)) {
+	if (!documents_.count(document_id)) {
 		return;
 	}
-	std::vector<std::string_view> words(document_to_word_freqs_.at(document_id).size());
+	std::atomic_store(&term_dictionary_, std::shared_ptr<const TermDictionary>{});
+	const int slot = documents_.at(document_id).slot;
+	std::vector<ForwardEntry> buffer;
+	const auto [entries_begin, entries_end] = GetForwardEntries(slot, buffer);
+	std::vector<std::string_view> words(entries_end - entries_begin);
 	std::transform(par,
-		document_to_word_freqs_.at(document_id).begin(), document_to_word_freqs_.at(document_id).end(),
+		entries_begin, entries_end,
 		words.begin(),
-		[](auto& word_freqs) {return std::string_view{word_freqs.first}; }
+		[this](const ForwardEntry& entry) { return term_words_[entry.term_id]; }
 	);
 	std::for_each(par,
 		words.begin(), words.end(),
-		[document_id, this](auto& word) {
-			word_to_document_freqs_.at(std::string{ word }).erase(document_id);
+		[slot, this](auto& word) {
+			PostingList& postings = word_to_document_freqs_.at(word);
+			const size_t index = FindPosting(postings, slot);
+			ErasePosting(postings, index);
+			if (positions_enabled_) {
+				ErasePositions(word_to_positions_.at(word), index);
+			}
 		}
 	);
 	SearchServer::EraseOther(document_id);
 }
 
+size_t SearchServer::FindPosting(const PostingList& postings, int slot) {
+	const auto it = std::lower_bound(postings.slots.begin(), postings.slots.end(), slot);
+	return it != postings.slots.end() && *it == slot ?
+		it - postings.slots.begin() :
+		postings.slots.size();
+}
+
+void SearchServer::ErasePosting(PostingList& postings, size_t index) {
+	if (index >= postings.slots.size()) {
+		return;
+	}
+	postings.slots.erase(postings.slots.begin() + index);
+	postings.word_counts.erase(postings.word_counts.begin() + index);
+}
+
+void SearchServer::ErasePositions(PositionList& positions, size_t index) {
+	if (index >= positions.offsets.size()) {
+		return;
+	}
+	const uint32_t begin = positions.offsets[index];
+	const uint32_t end = index + 1 < positions.offsets.size() ?
+		positions.offsets[index + 1] :
+		static_cast<uint32_t>(positions.bytes.size());
+	positions.bytes.erase(positions.bytes.begin() + begin, positions.bytes.begin() + end);
+	positions.offsets.erase(positions.offsets.begin() + index);
+	for (size_t i = index; i < positions.offsets.size(); ++i) {
+		positions.offsets[i] -= end - begin;
+	}
+}
+
 void SearchServer::EraseOther(int document_id) {
-	document_to_word_freqs_.erase(document_id);
+	const int slot = documents_.at(document_id).slot;
+	slot_ids_[slot] = -1;
+	total_document_length_ -= slot_lengths_[slot];
+	if (forward_index_enabled_) {
+		forward_index_.Remove(slot);
+	}
 	documents_.erase(document_id);
 	document_ids_.erase(std::find(document_ids_.begin(), document_ids_.end(), document_id));
 }
+
+
+void SearchServer::SetScorer(std::shared_ptr<const Scorer> scorer) {
+	if (!scorer) {
+		throw std::invalid_argument("scorer is null"s);
+	}
+	scorer_ = std::move(scorer);
+	for (size_t slot = 0; slot < slot_norms_.size(); ++slot) {
+		slot_norms_[slot] = scorer_->DocumentNorm(slot_lengths_[slot]);
+	}
+}
+
+const Scorer& SearchServer::GetScorer() const {
+	return *scorer_;
+}
+
+void SearchServer::EnablePositionalIndex() {
+	if (!documents_.empty()) {
+		throw std::logic_error("positional index must be enabled before adding documents"s);
+	}
+	positions_enabled_ = true;
+}
+
+void SearchServer::SetProximityBoost(double weight) {
+	if (!positions_enabled_) {
+		throw std::logic_error("proximity boost requires positional index"s);
+	}
+	if (weight < 0) {
+		throw std::invalid_argument("proximity boost weight is negative"s);
+	}
+	proximity_weight_ = weight;
+}
+
+size_t SearchServer::GetPositionalIndexMemoryUsage() const {
+	return GetMemoryStats().positions;
+}
+
+MemoryStats SearchServer::GetMemoryStats() const {
+	MemoryStats stats;
+	for (const std::string& word : stop_words_) {
+		stats.stop_words += GetTreeNodeSize<std::string>() + GetHeapSize(word);
+	}
+	for (const std::string& word : words_) {
+		stats.words += GetTreeNodeSize<std::string>() + GetHeapSize(word);
+	}
+	for (const auto& [word, postings] : word_to_document_freqs_) {
+		stats.postings += GetTreeNodeSize<std::pair<const std::string_view, PostingList>>()
+			+ GetHeapSize(postings.slots) + GetHeapSize(postings.word_counts);
+	}
+	stats.term_words = GetHeapSize(term_words_);
+	//сам объект прямого индекса входит в объект сервера
+	stats.forward_index = forward_index_.GetMemoryUsage() - sizeof(forward_index_);
+	stats.documents = documents_.size() * GetTreeNodeSize<std::pair<const int, DocumentData>>();
+	stats.document_ids = GetHeapSize(document_ids_);
+	stats.slot_columns = GetHeapSize(slot_ids_) + GetHeapSize(slot_ratings_) + GetHeapSize(slot_statuses_)
+		+ GetHeapSize(slot_lengths_) + GetHeapSize(slot_norms_);
+	for (const auto& [word, positions] : word_to_positions_) {
+		stats.positions += GetTreeNodeSize<std::pair<const std::string_view, PositionList>>()
+			+ GetHeapSize(positions.offsets) + GetHeapSize(positions.bytes);
+	}
+	for (const auto& [word, stopped] : stopped_postings_) {
+		const auto& [postings, positions] = stopped;
+		stats.stopped_postings += GetTreeNodeSize<std::pair<const std::string_view, std::pair<PostingList, PositionList>>>()
+			+ GetHeapSize(postings.slots) + GetHeapSize(postings.word_counts)
+			+ GetHeapSize(positions.offsets) + GetHeapSize(positions.bytes);
+	}
+	if (const auto dictionary = std::atomic_load(&term_dictionary_)) {
+		//объект и счетчик ссылок make_shared лежат в одном блоке
+		stats.term_dictionary = dictionary->GetMemoryUsage() - sizeof(TermDictionary)
+			+ GetAllocationSize(sizeof(TermDictionary) + 2 * sizeof(long));
+	}
+	stats.object = sizeof(*this);
+	return stats;
+}
+
+void SearchServer::ShrinkToFit() {
+	for (auto& [word, postings] : word_to_document_freqs_) {
+		postings.slots.shrink_to_fit();
+		postings.word_counts.shrink_to_fit();
+	}
+	for (auto& [word, positions] : word_to_positions_) {
+		positions.offsets.shrink_to_fit();
+		positions.bytes.shrink_to_fit();
+	}
+	for (auto& [word, stopped] : stopped_postings_) {
+		stopped.first.slots.shrink_to_fit();
+		stopped.first.word_counts.shrink_to_fit();
+		stopped.second.offsets.shrink_to_fit();
+		stopped.second.bytes.shrink_to_fit();
+	}
+	term_words_.shrink_to_fit();
+	document_ids_.shrink_to_fit();
+	slot_ids_.shrink_to_fit();
+	slot_ratings_.shrink_to_fit();
+	slot_statuses_.shrink_to_fit();
+	slot_lengths_.shrink_to_fit();
+	slot_norms_.shrink_to_fit();
+	forward_index_.ShrinkToFit();
+	std::atomic_store(&term_dictionary_, std::shared_ptr<const TermDictionary>{});
+}
+
+void SearchServer::SetMemoryBudget(size_t bytes) {
+	memory_budget_ = bytes;
+	InvalidateMemoryUsage();
+}
+
+size_t SearchServer::GetMemoryBudget() const {
+	return memory_budget_;
+}
+
+size_t SearchServer::EstimateDocumentMemory(const std::vector<std::string_view>& words) const {
+	std::map<std::string_view, int> word_counts;
+	for (const std::string_view& word : words) {
+		++word_counts[word];
+	}
+	size_t bytes = GetTreeNodeSize<std::pair<const int, DocumentData>>() + GetGrowthSize(document_ids_, 1)
+		+ GetGrowthSize(slot_ids_, 1) + GetGrowthSize(slot_ratings_, 1) + GetGrowthSize(slot_statuses_, 1)
+		+ GetGrowthSize(slot_lengths_, 1) + GetGrowthSize(slot_norms_, 1);
+	if (forward_index_enabled_) {
+		bytes += forward_index_.GetAddGrowthSize(static_cast<int>(slot_ids_.size()), word_counts.size());
+	}
+	size_t new_word_count = 0;
+	for (const auto& [word, word_count] : word_counts) {
+		//позиции - разности varint, не больше 5 байт на вхождение
+		const size_t position_bytes = 5 * static_cast<size_t>(word_count);
+		const auto it = word_to_document_freqs_.find(word);
+		if (it == word_to_document_freqs_.end()) {
+			++new_word_count;
+			bytes += GetTreeNodeSize<std::string>() + GetStringHeapSize(word.size())
+				+ GetTreeNodeSize<std::pair<const std::string_view, PostingList>>() + 2 * GetAllocationSize(sizeof(int));
+			if (positions_enabled_) {
+				bytes += GetTreeNodeSize<std::pair<const std::string_view, PositionList>>()
+					+ GetAllocationSize(sizeof(uint32_t)) + GetAllocationSize(position_bytes);
+			}
+			continue;
+		}
+		bytes += GetGrowthSize(it->second.slots, 1) + GetGrowthSize(it->second.word_counts, 1);
+		if (positions_enabled_) {
+			const auto positions = word_to_positions_.find(word);
+			if (positions == word_to_positions_.end()) {
+				bytes += GetTreeNodeSize<std::pair<const std::string_view, PositionList>>()
+					+ GetAllocationSize(sizeof(uint32_t)) + GetAllocationSize(position_bytes);
+			} else {
+				bytes += GetGrowthSize(positions->second.offsets, 1) + GetGrowthSize(positions->second.bytes, position_bytes);
+			}
+		}
+	}
+	return bytes + GetGrowthSize(term_words_, new_word_count);
+}
+
+void SearchServer::CheckMemoryBudget(const std::vector<std::string_view>& words) {
+	size_t document_bytes = EstimateDocumentMemory(words);
+	if (memory_usage_ + document_bytes > memory_budget_) {
+		memory_usage_ = GetMemoryStats().GetTotal();
+		if (memory_usage_ + document_bytes > memory_budget_) {
+			ShrinkToFit();
+			memory_usage_ = GetMemoryStats().GetTotal();
+			//после уплотнения запаса емкости нет, и прирост документа больше
+			document_bytes = EstimateDocumentMemory(words);
+		}
+		if (memory_usage_ + document_bytes > memory_budget_) {
+			throw std::length_error("memory budget exceeded: "s + std::to_string(memory_usage_) + " bytes used, document needs "s
+				+ std::to_string(document_bytes) + ", budget "s + std::to_string(memory_budget_));
+		}
+	}
+	memory_usage_ += document_bytes;
+}
+
+void SearchServer::InvalidateMemoryUsage() {
+	//оценка не меньше бюджета: следующее добавление документа пересчитает память
+	memory_usage_ = memory_budget_;
+}
+
+void SearchServer::DecodePositions(const PositionList& positions, size_t posting_index, std::vector<uint32_t>& result) {
+	const uint8_t* data = positions.bytes.data();
+	const uint32_t end = posting_index + 1 < positions.offsets.size() ?
+		positions.offsets[posting_index + 1] :
+		static_cast<uint32_t>(positions.bytes.size());
+	ReadDeltaVarints(data + positions.offsets[posting_index], data + end, result);
+}
+
+std::vector<SearchServer::PositionalTerm> SearchServer::GetPositionalTerms(const std::vector<std::string_view>& words) const {
+	std::vector<PositionalTerm> terms;
+	terms.reserve(words.size());
+	for (const std::string_view& word : words) {
+		const auto postings_it = word_to_document_freqs_.find(word);
+		const auto positions_it = word_to_positions_.find(word);
+		if (postings_it == word_to_document_freqs_.end() || positions_it == word_to_positions_.end()) {
+			terms.push_back({ nullptr, nullptr });
+		} else {
+			terms.push_back({ &postings_it->second, &positions_it->second });
+		}
+	}
+	return terms;
+}
+
+bool SearchServer::PhraseMatches(const std::vector<PositionalTerm>& terms, const std::vector<size_t>& posting_indexes) {
+	//starts - позиции, с которых фраза совпадает на уже проверенных словах
+	thread_local std::vector<uint32_t> starts;
+	thread_local std::vector<uint32_t> positions;
+	DecodePositions(*terms[0].positions, posting_indexes[0], starts);
+	for (size_t i = 1; i < terms.size() && !starts.empty(); ++i) {
+		DecodePositions(*terms[i].positions, posting_indexes[i], positions);
+		auto position_it = positions.begin();
+		auto last = starts.begin();
+		for (const uint32_t start : starts) {
+			position_it = std::lower_bound(position_it, positions.end(), start + i);
+			if (position_it == positions.end()) {
+				break;
+			}
+			if (*position_it == start + i) {
+				*last++ = start;
+			}
+		}
+		starts.erase(last, starts.end());
+	}
+	return !starts.empty();
+}
+
+std::vector<int> SearchServer::FindPhraseSlots(const std::vector<std::string_view>& phrase) const {
+	const std::vector<PositionalTerm> terms = GetPositionalTerms(phrase);
+	if (std::any_of(terms.begin(), terms.end(), [](const PositionalTerm& term) { return term.postings == nullptr; })) {
+		return {};
+	}
+	//перебираем документы самого редкого слова, в остальных списках двигаемся только вперед
+	const PostingList& rarest = *std::min_element(terms.begin(), terms.end(),
+		[](const PositionalTerm& lhs, const PositionalTerm& rhs) {
+			return lhs.postings->slots.size() < rhs.postings->slots.size();
+		})->postings;
+	std::vector<size_t> cursors(terms.size(), 0);
+	std::vector<int> result;
+	for (const int slot : rarest.slots) {
+		bool is_in_all = true;
+		for (size_t i = 0; i < terms.size() && is_in_all; ++i) {
+			const std::vector<int>& slots = terms[i].postings->slots;
+			cursors[i] = std::lower_bound(slots.begin() + cursors[i], slots.end(), slot) - slots.begin();
+			is_in_all = cursors[i] < slots.size() && slots[cursors[i]] == slot;
+		}
+		if (is_in_all && PhraseMatches(terms, cursors)) {
+			result.push_back(slot);
+		}
+	}
+	return result;
+}
+
+bool SearchServer::ContainsPhrase(int slot, const std::vector<std::string_view>& phrase) const {
+	const std::vector<PositionalTerm> terms = GetPositionalTerms(phrase);
+	std::vector<size_t> posting_indexes;
+	posting_indexes.reserve(terms.size());
+	for (const PositionalTerm& term : terms) {
+		if (term.postings == nullptr) {
+			return false;
+		}
+		const size_t index = FindPosting(*term.postings, slot);
+		if (index == term.postings->slots.size()) {
+			return false;
+		}
+		posting_indexes.push_back(index);
+	}
+	return PhraseMatches(terms, posting_indexes);
+}
+
+double SearchServer::ComputeProximityBoost(const std::vector<PositionalTerm>& terms, int slot) const {
+	std::vector<std::vector<uint32_t>> term_positions;
+	for (const PositionalTerm& term : terms) {
+		if (term.postings == nullptr) {
+			continue;
+		}
+		const size_t index = FindPosting(*term.postings, slot);
+		if (index < term.postings->slots.size()) {
+			DecodePositions(*term.positions, index, term_positions.emplace_back());
+		}
+	}
+	double boost = 0;
+	for (size_t i = 0; i < term_positions.size(); ++i) {
+		for (size_t j = i + 1; j < term_positions.size(); ++j) {
+			//минимальное расстояние между позициями двух слов проходом по двум отсортированным массивам
+			const std::vector<uint32_t>& lhs = term_positions[i];
+			const std::vector<uint32_t>& rhs = term_positions[j];
+			uint32_t min_distance = std::numeric_limits<uint32_t>::max();
+			for (size_t l = 0, r = 0; l < lhs.size() && r < rhs.size();) {
+				if (lhs[l] < rhs[r]) {
+					min_distance = std::min(min_distance, rhs[r] - lhs[l]);
+					++l;
+				} else {
+					min_distance = std::min(min_distance, lhs[l] - rhs[r]);
+					++r;
+				}
+			}
+			boost += proximity_weight_ / min_distance;
+		}
+	}
+	return boost;
+}
+
+void SearchServer::ApplyPositionalConstraints(const QueryPar& query, IndexVector<double>& accumulator) const {
+	for (const auto& phrase : query.phrases) {
+		const std::vector<int> phrase_slots = FindPhraseSlots(phrase);
+		auto phrase_it = phrase_slots.begin();
+		for (size_t slot = 0; slot < accumulator.size(); ++slot) {
+			if (phrase_it != phrase_slots.end() && *phrase_it == static_cast<int>(slot)) {
+				++phrase_it;
+			} else {
+				accumulator[slot] = -0.0;
+			}
+		}
+	}
+	if (proximity_weight_ > 0 && query.plus_words.size() > 1) {
+		const std::vector<PositionalTerm> terms = GetPositionalTerms(query.plus_words);
+		for (size_t slot = 0; slot < accumulator.size(); ++slot) {
+			if (!std::signbit(accumulator[slot])) {
+				accumulator[slot] += ComputeProximityBoost(terms, static_cast<int>(slot));
+			}
+		}
+	}
+}
+
+void SearchServer::SetPrefixExpansionLimit(size_t limit) {
+	prefix_expansion_limit_ = limit;
+}
+
+std::shared_ptr<const TermDictionary> SearchServer::GetTermDictionary() const {
+	std::shared_ptr<const TermDictionary> dictionary = std::atomic_load(&term_dictionary_);
+	if (!dictionary) {
+		//слова удаленных документов остаются в words_, в словарь попадают только слова с вхождениями;
+		//два запроса могут построить словарь одновременно, тогда один из результатов просто отбрасывается
+		std::vector<std::string_view> words;
+		words.reserve(word_to_document_freqs_.size());
+		for (const auto& [word, postings] : word_to_document_freqs_) {
+			if (!postings.slots.empty()) {
+				words.push_back(word);
+			}
+		}
+		dictionary = std::make_shared<const TermDictionary>(words.begin(), words.end());
+		std::atomic_store(&term_dictionary_, dictionary);
+	}
+	return dictionary;
+}
+
+void SearchServer::ExpandPrefix(std::string_view prefix, std::vector<std::string_view>& words) const {
+	GetTermDictionary()->ForEachWithPrefix(prefix, prefix_expansion_limit_,
+		[this, &words](size_t id, std::string_view term) {
+			words.push_back(word_to_document_freqs_.find(term)->first);
+		});
+}
+
+bool SearchServer::IsIndexedWord(std::string_view word) const {
+	const auto it = word_to_document_freqs_.find(word);
+	return it != word_to_document_freqs_.end() && !it->second.slots.empty();
+}
+
+void SearchServer::SetBooleanQueriesEnabled(bool enabled) {
+	boolean_queries_enabled_ = enabled;
+}
+
+void SearchServer::SetFuzzyMatching(int max_distance) {
+	if (max_distance < 0 || max_distance > 2) {
+		throw std::invalid_argument("fuzzy matching distance must be from 0 to 2"s);
+	}
+	fuzzy_max_distance_ = max_distance;
+}
+
+void SearchServer::SetExecutionPlanner(const ExecutionPlanner& planner) {
+	planner_ = planner;
+}
+
+ExecutionPlan SearchServer::PlanQuery(const std::string_view& raw_query) const {
+	QueryPar query = ParseQueryPar(raw_query);
+	query.Normalize();
+	return ChoosePlan(query);
+}
+
+ExecutionPlan SearchServer::ChoosePlan(const QueryPar& query) const {
+	size_t plus_word_count = 0;
+	size_t total_postings = 0;
+	for (const std::string_view& plus_word : query.plus_words) {
+		const auto it = word_to_document_freqs_.find(plus_word);
+		if (it != word_to_document_freqs_.end()) {
+			++plus_word_count;
+			total_postings += it->second.slots.size();
+		}
+	}
+	return planner_.Choose(plus_word_count, total_postings);
+}
+
+namespace {
+
+constexpr std::string_view SNAPSHOT_MAGIC = "SSSNAP02";
+
+} // namespace
+
+void SearchServer::SaveSnapshot(std::ostream& output) const {
+	std::string data;
+	AppendBinary(data, static_cast<uint64_t>(stop_words_.size()));
+	for (const std::string& word : stop_words_) {
+		AppendBinaryString(data, word);
+	}
+	AppendBinary(data, stop_words_version_);
+	AppendBinaryVector(data, slot_ids_);
+	AppendBinaryVector(data, slot_ratings_);
+	AppendBinaryVector(data, slot_statuses_);
+	AppendBinaryVector(data, slot_lengths_);
+	AppendBinary(data, positions_enabled_);
+	//слова по номерам: номер слова в снимке тот же, что в индексе
+	const auto append_positions = [this, &data](std::string_view word) {
+		const auto it = word_to_positions_.find(word);
+		AppendBinaryVector(data, it == word_to_positions_.end() ? std::vector<uint32_t>{} : it->second.offsets);
+		AppendBinaryVector(data, it == word_to_positions_.end() ? std::vector<uint8_t>{} : it->second.bytes);
+	};
+	AppendBinary(data, static_cast<uint64_t>(term_words_.size()));
+	for (const std::string_view& word : term_words_) {
+		const PostingList& postings = word_to_document_freqs_.find(word)->second;
+		AppendBinaryString(data, word);
+		AppendBinaryVector(data, postings.slots);
+		AppendBinaryVector(data, postings.word_counts);
+		if (positions_enabled_) {
+			append_positions(word);
+		}
+	}
+	AppendBinary(data, static_cast<uint64_t>(stopped_postings_.size()));
+	for (const auto& [word, stopped] : stopped_postings_) {
+		const auto& [postings, positions] = stopped;
+		AppendBinary(data, postings.term_id);
+		AppendBinaryVector(data, postings.slots);
+		AppendBinaryVector(data, postings.word_counts);
+		AppendBinaryVector(data, positions.offsets);
+		AppendBinaryVector(data, positions.bytes);
+	}
+	AppendBinary(data, ComputeCrc32(data));
+	output.write(SNAPSHOT_MAGIC.data(), SNAPSHOT_MAGIC.size());
+	output.write(data.data(), data.size());
+	if (!output) {
+		throw std::runtime_error("snapshot write failed"s);
+	}
+}
+
+void SearchServer::LoadSnapshot(std::istream& input) {
+	const std::string file{ std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
+	if (file.size() < SNAPSHOT_MAGIC.size() + sizeof(uint32_t) || file.compare(0, SNAPSHOT_MAGIC.size(), SNAPSHOT_MAGIC) != 0) {
+		throw std::runtime_error("not a search server snapshot"s);
+	}
+	const std::string_view data = std::string_view{ file }.substr(SNAPSHOT_MAGIC.size(),
+		file.size() - SNAPSHOT_MAGIC.size() - sizeof(uint32_t));
+	if (BinaryReader(std::string_view{ file }.substr(file.size() - sizeof(uint32_t))).Read<uint32_t>()
+		!= ComputeCrc32(data)) {
+		throw std::runtime_error("snapshot checksum mismatch"s);
+	}
+	const auto corrupted = []() { return std::runtime_error("corrupted snapshot"s); };
+
+	//все читается в новые контейнеры и подменяет старые только после полной проверки
+	BinaryReader reader(data);
+	std::set<std::string, std::less<>> stop_words;
+	for (uint64_t count = reader.Read<uint64_t>(); count > 0; --count) {
+		stop_words.emplace(reader.ReadString());
+	}
+	const uint64_t stop_words_version = reader.Read<uint64_t>();
+	IndexVector<int> slot_ids = reader.ReadVector<int, HugePageAllocator<int>>();
+	IndexVector<int> slot_ratings = reader.ReadVector<int, HugePageAllocator<int>>();
+	IndexVector<DocumentStatus> slot_statuses = reader.ReadVector<DocumentStatus, HugePageAllocator<DocumentStatus>>();
+	IndexVector<int> slot_lengths = reader.ReadVector<int, HugePageAllocator<int>>();
+	const size_t slot_count = slot_ids.size();
+	if (slot_ratings.size() != slot_count || slot_statuses.size() != slot_count || slot_lengths.size() != slot_count) {
+		throw corrupted();
+	}
+	//значения, которые дальше используются как перечисления, длины и номера, проверяются здесь:
+	//файл с верной контрольной суммой может быть записан не этим сервером
+	for (size_t slot = 0; slot < slot_count; ++slot) {
+		const int status = static_cast<int>(slot_statuses[slot]);
+		if (status < static_cast<int>(DocumentStatus::ACTUAL) || status > static_cast<int>(DocumentStatus::REMOVED)
+			|| slot_lengths[slot] < 0) {
+			throw corrupted();
+		}
+	}
+	const bool positions_enabled = reader.Read<bool>();
+	const auto read_postings = [&reader, &corrupted, slot_count](PostingList& postings) {
+		postings.slots = reader.ReadVector<int>();
+		postings.word_counts = reader.ReadVector<int>();
+		if (postings.word_counts.size() != postings.slots.size()
+			|| std::adjacent_find(postings.slots.begin(), postings.slots.end(), std::greater_equal<int>()) != postings.slots.end()
+			|| (!postings.slots.empty() && (postings.slots.front() < 0 || static_cast<size_t>(postings.slots.back()) >= slot_count))
+			|| std::any_of(postings.word_counts.begin(), postings.word_counts.end(), [](int count) { return count <= 0; })) {
+			throw corrupted();
+		}
+	};
+	const auto read_positions = [&reader, &corrupted](PositionList& positions, size_t posting_count) {
+		positions.offsets = reader.ReadVector<uint32_t>();
+		positions.bytes = reader.ReadVector<uint8_t>();
+		if (positions.offsets.size() != posting_count || (posting_count == 0 && !positions.bytes.empty())
+			|| (posting_count > 0 && positions.offsets.front() != 0)) {
+			throw corrupted();
+		}
+	};
+	//позиции вхождения index: word_count возрастающих номеров меньше limit, записанных varint
+	//строго в пределах своего участка; прочитанные номера добавляются в decoded
+	const auto check_positions = [&corrupted](const PositionList& positions, size_t index, int word_count, uint64_t limit,
+		std::vector<uint32_t>& decoded) {
+		const size_t begin = positions.offsets[index];
+		const size_t end = index + 1 < positions.offsets.size() ? positions.offsets[index + 1] : positions.bytes.size();
+		if (begin > end || end > positions.bytes.size()) {
+			throw corrupted();
+		}
+		uint64_t position = 0;
+		int count = 0;
+		for (size_t i = begin; i < end; ++count) {
+			uint64_t delta = 0;
+			for (int shift = 0;; shift += 7) {
+				if (i == end || shift > 28) {
+					throw corrupted();
+				}
+				const uint8_t byte = positions.bytes[i++];
+				delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0) {
+					break;
+				}
+			}
+			if (count > 0 && delta == 0) {
+				throw corrupted();
+			}
+			position += delta;
+			if (position >= limit) {
+				throw corrupted();
+			}
+			decoded.push_back(static_cast<uint32_t>(position));
+		}
+		if (count != word_count) {
+			throw corrupted();
+		}
+	};
+	std::set<std::string> words;
+	std::vector<std::string_view> term_words;
+	std::map<std::string_view, PostingList> word_to_document_freqs;
+	std::map<std::string_view, PositionList> word_to_positions;
+	const uint64_t term_count = reader.Read<uint64_t>();
+	for (uint64_t term_id = 0; term_id < term_count; ++term_id) {
+		const auto [it, is_inserted] = words.emplace(reader.ReadString());
+		if (!is_inserted) {
+			throw corrupted();
+		}
+		term_words.push_back(*it);
+		PostingList& postings = word_to_document_freqs[*it];
+		postings.term_id = static_cast<uint32_t>(term_id);
+		read_postings(postings);
+		if (positions_enabled) {
+			read_positions(word_to_positions[*it], postings.slots.size());
+		}
+	}
+	std::map<std::string_view, std::pair<PostingList, PositionList>> stopped_postings;
+	for (uint64_t count = reader.Read<uint64_t>(); count > 0; --count) {
+		const uint32_t term_id = reader.Read<uint32_t>();
+		if (term_id >= term_words.size()) {
+			throw corrupted();
+		}
+		if (stopped_postings.count(term_words[term_id]) > 0) {
+			throw corrupted();
+		}
+		auto& [postings, positions] = stopped_postings[term_words[term_id]];
+		postings.term_id = term_id;
+		read_postings(postings);
+		read_positions(positions, positions_enabled ? postings.slots.size() : 0);
+	}
+	if (!reader.AtEnd()) {
+		throw corrupted();
+	}
+	//длина документа - сумма чисел вхождений его действующих слов; удаленные документы
+	//остаются только в списках стоп-слов
+	std::vector<long long> active_lengths(slot_count, 0);
+	std::vector<long long> stopped_lengths(slot_count, 0);
+	for (const auto& [word, postings] : word_to_document_freqs) {
+		for (size_t i = 0; i < postings.slots.size(); ++i) {
+			if (slot_ids[postings.slots[i]] < 0) {
+				throw corrupted();
+			}
+			active_lengths[postings.slots[i]] += postings.word_counts[i];
+		}
+	}
+	for (const auto& [word, stopped] : stopped_postings) {
+		const PostingList& postings = stopped.first;
+		for (size_t i = 0; i < postings.slots.size(); ++i) {
+			stopped_lengths[postings.slots[i]] += postings.word_counts[i];
+		}
+	}
+	for (size_t slot = 0; slot < slot_count; ++slot) {
+		if (slot_ids[slot] >= 0 && active_lengths[slot] != slot_lengths[slot]) {
+			throw corrupted();
+		}
+	}
+	if (positions_enabled) {
+		//позиции действующих слов - среди действующих слов документа, стоп-слов - среди всех сохраненных
+		std::vector<uint32_t> decoded;
+		for (const auto& [word, postings] : word_to_document_freqs) {
+			const PositionList& positions = word_to_positions.at(word);
+			for (size_t i = 0; i < postings.slots.size(); ++i) {
+				decoded.clear();
+				check_positions(positions, i, postings.word_counts[i], slot_lengths[postings.slots[i]], decoded);
+			}
+		}
+		//разные стоп-слова документа не могут занимать одно место
+		std::map<int, std::vector<uint32_t>> stopped_positions;
+		for (const auto& [word, stopped] : stopped_postings) {
+			const auto& [postings, positions] = stopped;
+			for (size_t i = 0; i < postings.slots.size(); ++i) {
+				const int slot = postings.slots[i];
+				check_positions(positions, i, postings.word_counts[i], slot_lengths[slot] + stopped_lengths[slot],
+					stopped_positions[slot]);
+			}
+		}
+		for (auto& [slot, positions] : stopped_positions) {
+			std::sort(positions.begin(), positions.end());
+			if (std::adjacent_find(positions.begin(), positions.end()) != positions.end()) {
+				throw corrupted();
+			}
+		}
+	}
+
+	std::map<int, DocumentData> documents;
+	std::vector<int> document_ids;
+	long long total_document_length = 0;
+	for (size_t slot = 0; slot < slot_count; ++slot) {
+		if (slot_ids[slot] < 0) {
+			continue;
+		}
+		if (!documents.emplace(slot_ids[slot], DocumentData{ slot_ratings[slot], slot_statuses[slot], static_cast<int>(slot) }).second) {
+			throw corrupted();
+		}
+		document_ids.push_back(slot_ids[slot]);
+		total_document_length += slot_lengths[slot];
+	}
+
+	stop_words_ = std::move(stop_words);
+	stop_words_version_ = stop_words_version;
+	words_ = std::move(words);
+	term_words_ = std::move(term_words);
+	word_to_document_freqs_ = std::move(word_to_document_freqs);
+	documents_ = std::move(documents);
+	document_ids_ = std::move(document_ids);
+	slot_ids_ = std::move(slot_ids);
+	slot_ratings_ = std::move(slot_ratings);
+	slot_statuses_ = std::move(slot_statuses);
+	slot_lengths_ = std::move(slot_lengths);
+	total_document_length_ = total_document_length;
+	positions_enabled_ = positions_enabled;
+	word_to_positions_ = std::move(word_to_positions);
+	stopped_postings_ = std::move(stopped_postings);
+	slot_norms_.resize(slot_count);
+	for (size_t slot = 0; slot < slot_count; ++slot) {
+		slot_norms_[slot] = scorer_->DocumentNorm(slot_lengths_[slot]);
+	}
+	if (forward_index_enabled_) {
+		RebuildForwardIndex();
+	} else {
+		forward_index_.Clear();
+	}
+	std::atomic_store(&term_dictionary_, std::shared_ptr<const TermDictionary>{});
+	InvalidateMemoryUsage();
+}
+
+MetricsSnapshot SearchServer::GetMetrics() const {
+	return metrics_.GetSnapshot();
+}
+
+void SearchServer::ResetMetrics() {
+	metrics_.Reset();
+}
+
+void SearchServer::SetMetricsEnabled(bool enabled) {
+	metrics_.SetEnabled(enabled);
+}
+
+int SearchServer::ExpandFuzzy(std::string_view word, std::vector<std::string_view>& words) const {
+	const std::shared_ptr<const TermDictionary> dictionary = GetTermDictionary();
+	//сначала ищем на расстоянии 1, чтобы более далекие слова не заняли место в ограниченной выдаче
+	for (int distance = 1; distance <= fuzzy_max_distance_; ++distance) {
+		const auto found = dictionary->FindWithinDistance(word, distance, prefix_expansion_limit_);
+		if (!found.empty()) {
+			for (const auto& [term, term_distance] : found) {
+				words.push_back(word_to_document_freqs_.find(term)->first);
+			}
+			return distance;
+		}
+	}
+	return std::numeric_limits<int>::max();
+}
+
+void SearchServer::ExpandQueryPrefix(QueryTokens& tokens, std::string_view prefix,
+	std::vector<std::string_view>& words) const {
+	if (tokens.corpus_statistics != nullptr) {
+		const auto it = tokens.corpus_statistics->prefix_expansions.find(prefix);
+		if (it != tokens.corpus_statistics->prefix_expansions.end()) {
+			words.insert(words.end(), it->second.words.begin(), it->second.words.end());
+			return;
+		}
+	}
+	const size_t first = words.size();
+	ExpandPrefix(prefix, words);
+	if (tokens.expansions != nullptr) {
+		tokens.expansions->prefix_expansions[std::string(prefix)] =
+			{ { words.begin() + first, words.end() }, prefix_expansion_limit_, 0 };
+	}
+}
+
+bool SearchServer::ExpandQueryFuzzy(QueryTokens& tokens, std::string_view word,
+	std::vector<std::string_view>& words) const {
+	if (tokens.corpus_statistics != nullptr) {
+		const auto it = tokens.corpus_statistics->fuzzy_expansions.find(word);
+		if (it != tokens.corpus_statistics->fuzzy_expansions.end()) {
+			if (it->second.distance == 0) {
+				return false;
+			}
+			words.insert(words.end(), it->second.words.begin(), it->second.words.end());
+			return true;
+		}
+	}
+	//слово, которое есть в индексе, тоже записывается: тогда его не раскрывают и части, где его нет
+	TermExpansion expansion{ {}, prefix_expansion_limit_, 0 };
+	const bool is_expanded = !IsIndexedWord(word);
+	if (is_expanded) {
+		const size_t first = words.size();
+		expansion.distance = ExpandFuzzy(word, words);
+		expansion.words.assign(words.begin() + first, words.end());
+	}
+	if (tokens.expansions != nullptr) {
+		tokens.expansions->fuzzy_expansions[std::string(word)] = std::move(expansion);
+	}
+	return is_expanded;
+}
\ No newline at end of file
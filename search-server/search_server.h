@@ -1,22 +1,40 @@
 #pragma once
 
-#include "concurrent_map.h"
+#include "binary_io.h"
+#include "boolean_query.h"
 #include "document.h"
+#include "execution_planner.h"
+#include "forward_index.h"
+#include "huge_pages.h"
 #include "log_duration.h"
+#include "memory_stats.h"
+#include "query_metrics.h"
+#include "scorer.h"
+#include "scoring_kernels.h"
+#include "search_results.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
+#include "varint.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <execution>
 #include <functional>
 #include <future>
 #include <cmath>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <list>
 #include <map>
+#include <memory>
 #include <numeric>
+#include <optional>
 #include <string>
 #include <stdexcept>
 #include <set>
+#include <type_traits>
 #include <vector>
 #include <unordered_set>
 #include <utility>
@@ -25,7 +43,40 @@ using namespace std::string_literals;
 
 constexpr int MAX_THREADS = 8;
 constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
+constexpr size_t MAX_PREFIX_EXPANSION = 64;
 constexpr double RELEVANCE_TRESHOLD = 1e-6;
+//наименьший объем работы (вхождения и документы) на одну часть при параллельном подсчете
+constexpr size_t MIN_RANGE_WORK = 32768;
+
+//Раскрытие слова запроса по словарю: первые по алфавиту слова, не больше limit. Для нечеткого поиска
+//distance - расстояние найденных слов, 0 - слово есть в индексе и не раскрывается
+struct TermExpansion {
+	std::vector<std::string> words;
+	size_t limit = 0;
+	int distance = 0;
+
+	//раскрытие по объединенному словарю двух частей корпуса
+	TermExpansion& operator+=(const TermExpansion& other);
+};
+
+//Статистика корпуса по словам запроса: число документов, их суммарная длина и число документов
+//с каждым словом. Нужна, чтобы серверы, между которыми распределены документы, считали вес слова (IDF)
+//и среднюю длину документа (BM25) одинаково
+struct CorpusStatistics {
+	size_t document_count = 0;
+	uint64_t total_document_length = 0;
+	std::map<std::string, size_t, std::less<>> document_freqs;
+	//раскрытия префиксов (ключ - префикс без "*") и слов нечеткого поиска по всему корпусу: сервер,
+	//получивший статистику, берет их вместо раскрытия по своему словарю
+	std::map<std::string, TermExpansion, std::less<>> prefix_expansions;
+	std::map<std::string, TermExpansion, std::less<>> fuzzy_expansions;
+
+	//сложение статистики двух частей корпуса
+	CorpusStatistics& operator+=(const CorpusStatistics& other);
+};
+
+//Порядок выдачи: по убыванию релевантности, при равной (с точностью RELEVANCE_TRESHOLD) - по убыванию рейтинга
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
 
 class SearchServer {
 public:
@@ -43,7 +94,13 @@ public:
 
 	std::vector<int>::const_iterator end() const;
 
-	//Метод обрабатывает запрос, состоящий из строки
+	//Метод обрабатывает запрос, состоящий из строки.
+	//Слова запроса необязательны (документ должен содержать хотя бы одно), "-word" исключает документы
+	//со словом. По умолчанию "+", скобки и слова AND, OR, NOT - обычный текст запроса.
+	//После SetBooleanQueriesEnabled(true) "+word" - обязательное слово, а операторы AND, OR, NOT
+	//и скобки задают логический запрос: "+cat (dog OR rat) NOT fur", "cat AND (dog rat)"; слова без
+	//оператора между ними объединяются через OR, AND связывает сильнее OR. Релевантность считается
+	//по всем не исключенным словам запроса
 	std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
 
 	//Метод обрабатывает запрос, состоящий из строки + политика
@@ -69,9 +126,58 @@ public:
 	std::vector<Document> FindTopDocuments(ExecutionPolicy policy,
 		const std::string_view& raw_query, Predic predic) const;
 
+	//Поиск с весами слов по общей статистике corpus_statistics вместо статистики этого сервера
+	template<typename Predic, typename ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy policy,
+		const std::string_view& raw_query, Predic predic, const CorpusStatistics& corpus_statistics) const;
+
+	//Поиск с профилем выполнения (EXPLAIN): слова запроса с размерами списков вхождений и весами,
+	//число кандидатов после каждого отбора, время этапов и путь выполнения. Профиль заполняется заново
+	std::vector<Document> ExplainTopDocuments(const std::string_view& raw_query, QueryProfile& profile) const;
+
+	template<typename ExecutionPolicy>
+	std::vector<Document> ExplainTopDocuments(ExecutionPolicy policy,
+		const std::string_view& raw_query, QueryProfile& profile) const;
+
+	template<typename Predic, typename ExecutionPolicy>
+	std::vector<Document> ExplainTopDocuments(ExecutionPolicy policy,
+		const std::string_view& raw_query, Predic predic, QueryProfile& profile) const;
+
+	//Постраничный поиск с курсором: страница из page_size документов, идущих после курсора cursor
+	//(пустой - с начала) в порядке IsRankedBefore. Каждая страница считается заново, но в выдачу
+	//отбирается только page_size документов после курсора, поэтому дальняя страница стоит как первая.
+	//Курсор, выданный до смены стоп-слов (SetStopWords, RemoveStopWords), отвергается с std::invalid_argument;
+	//курсор из другого запроса или после добавления и удаления документов дает страницу не из той выдачи
+	SearchPage FindPage(const std::string_view& raw_query, size_t page_size,
+		const std::string_view& cursor = {}) const;
+
+	template<typename Predic, typename ExecutionPolicy>
+	SearchPage FindPage(ExecutionPolicy policy, const std::string_view& raw_query, Predic predic,
+		size_t page_size, const std::string_view& cursor = {}) const;
+
+	//Все найденные документы запроса для постраничного чтения без повторного поиска
+	//(можно обходить через LazyPaginator)
+	SearchResults FindAllPages(const std::string_view& raw_query) const;
+
+	template<typename Predic, typename ExecutionPolicy>
+	SearchResults FindAllPages(ExecutionPolicy policy, const std::string_view& raw_query, Predic predic) const;
+
+	//Лучшие документы вместе со счетчиками всех найденных документов по статусу и корзинам рейтинга
+	//(SearchFacets); счетчики собираются в том же проходе по результатам подсчета релевантности
+	FacetedDocuments FindFacetedDocuments(const std::string_view& raw_query, int rating_bucket_width = 1) const;
+
+	template<typename Predic, typename ExecutionPolicy>
+	FacetedDocuments FindFacetedDocuments(ExecutionPolicy policy, const std::string_view& raw_query, Predic predic,
+		int rating_bucket_width = 1) const;
+
 	size_t GetDocumentCount() const;
 
-	const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+	//Статистика этого сервера по плюс-словам запроса (после раскрытия префиксов и нечеткого поиска)
+	//вместе с раскрытиями слов запроса
+	CorpusStatistics GetQueryStatistics(const std::string_view& raw_query) const;
+
+	//Частоты слов документа: легкое представление поверх прямого индекса, действительно до изменения сервера
+	WordFrequencies GetWordFrequencies(int document_id) const;
 
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view& raw_query,
 		int document_id) const;
@@ -82,42 +188,260 @@ public:
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::parallel_policy par,
 		const std::string_view& raw_query, int document_id) const;
 
+	//Матчинг запроса с несколькими документами: запрос разбирается один раз, слова каждого документа
+	//сливаются с отсортированными номерами слов запроса; с политикой par документы обрабатываются параллельно
+	std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(
+		const std::string_view& raw_query, const std::vector<int>& document_ids) const;
+
+	template<typename ExecutionPolicy>
+	std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(ExecutionPolicy policy,
+		const std::string_view& raw_query, const std::vector<int>& document_ids) const;
+
 	void RemoveDocument(int document_id);
 
 	void RemoveDocument(std::execution::sequenced_policy seq, int document_id);
 
 	void RemoveDocument(std::execution::parallel_policy par, int document_id);
 
+	//Добавление стоп-слов. Уже проиндексированные документы пересчитываются сразу: вхождения новых
+	//стоп-слов убираются из индекса (и сохраняются для RemoveStopWords), длины документов с ними
+	//уменьшаются, веса остальных слов этих документов пересчитываются. Стоимость пропорциональна
+	//числу слов в затронутых документах, а не размеру индекса. С позиционным индексом позиции слов
+	//затронутых документов перенумеровываются, как при индексации с новыми стоп-словами; для этого
+	//просматриваются списки вхождений всех слов
 	void SetStopWords(const std::string_view& text);
 
+	//Удаление стоп-слов: вхождения, убранные SetStopWords, возвращаются в индекс с пересчетом весов.
+	//Текст документов не хранится, поэтому документы, добавленные, пока слово было стоп-словом, его не содержат
+	void RemoveStopWords(const std::string_view& text);
+
+	//Номер версии стоп-слов, растет при каждом изменении. Курсоры FindPage хранят версию и после
+	//смены стоп-слов отвергаются
+	uint64_t GetStopWordsVersion() const;
+
+	//Смена модели ранжирования (по умолчанию TF-IDF). Нормы документов пересчитываются сразу;
+	//средняя длина документа для моделей, которые ее используют, берется при каждом запросе
+	//из текущего корпуса, поэтому после добавления и удаления документов вызывать метод повторно не нужно
+	void SetScorer(std::shared_ptr<const Scorer> scorer);
+
+	const Scorer& GetScorer() const;
+
+	//Включение позиционного индекса (только до добавления документов). С ним в запросе доступны
+	//фразы в кавычках: "curly cat" - документ должен содержать слова фразы подряд
+	void EnablePositionalIndex();
+
+	//Добавка к релевантности за близость плюс-слов в документе: weight / расстояние для каждой
+	//пары найденных слов запроса, 0 - выключено. Требует позиционного индекса
+	void SetProximityBoost(double weight);
+
+	//Хранение прямого индекса (по умолчанию включено). Без него индекс занимает меньше памяти,
+	//а слова документа для GetWordFrequencies, MatchDocument и RemoveDocument восстанавливаются
+	//по спискам вхождений при каждом обращении
+	void SetForwardIndexEnabled(bool enabled);
+
+	//Объем памяти позиционного индекса в байтах (0, если он выключен)
+	size_t GetPositionalIndexMemoryUsage() const;
+
+	//Память индекса по структурам: емкости векторов, узлы деревьев и строки в куче
+	//по модели распределителя glibc (заголовок блока, выравнивание до 16 байт)
+	MemoryStats GetMemoryStats() const;
+
+	//Освобождение запаса емкости списков вхождений, позиций и колонок документов, уплотнение
+	//прямого индекса и сброс словаря префиксов (он построится заново при первом запросе с префиксом)
+	void ShrinkToFit();
+
+	//Бюджет памяти индекса в байтах, 0 - без ограничения. Перед добавлением документа его прирост
+	//оценивается заранее; если индекс выйдет за бюджет, память пересчитывается точно и при нехватке
+	//индекс уплотняется (ShrinkToFit). Не помогло - AddDocument бросает std::length_error,
+	//ничего не меняя. Еще больше памяти освобождает SetForwardIndexEnabled(false)
+	void SetMemoryBudget(size_t bytes);
+
+	size_t GetMemoryBudget() const;
+
+	//Наибольшее число слов, в которые раскрывается слово запроса с префиксом "connect*"
+	//(первые по алфавиту из тех, что есть в документах)
+	void SetPrefixExpansionLimit(size_t limit);
+
+	//Нечеткий поиск: плюс-слово, которого нет в документах, заменяется словами индекса на наименьшем
+	//расстоянии Левенштейна, но не больше max_distance (1 или 2); 0 - выключено
+	void SetFuzzyMatching(int max_distance);
+
+	//Логические запросы (по умолчанию выключены): "+word" - обязательное слово, операторы AND, OR, NOT
+	//и скобки, в том числе "+(...)" и "-(...)". Без них эти символы и слова ищутся как обычный текст,
+	//поэтому запросы вроде "c++", "f(x)" или слово OR в документе работают как раньше
+	void SetBooleanQueriesEnabled(bool enabled);
+
+	//Метрики поиска: длительности этапов FindTopDocuments, число просмотренных вхождений
+	//и найденных документов. Включены по умолчанию, на запрос добавляют несколько чтений часов
+	MetricsSnapshot GetMetrics() const;
+
+	void ResetMetrics();
+
+	void SetMetricsEnabled(bool enabled);
+
+	//Правила выбора плана для политики adaptive_policy; по умолчанию - ExecutionPlanner::GetDefault()
+	//с фиксированным порогом. Порог, подобранный замером, задается явно: ExecutionPlanner::Calibrate()
+	void SetExecutionPlanner(const ExecutionPlanner& planner);
+
+	//план, который adaptive_policy выберет для запроса
+	ExecutionPlan PlanQuery(const std::string_view& raw_query) const;
+
+	//Снимок индекса в двоичном виде с контрольной суммой: стоп-слова, документы, списки вхождений и позиции.
+	//Настройки поиска и модель ранжирования в снимок не входят
+	void SaveSnapshot(std::ostream& output) const;
+
+	//Замена индекса снимком; настройки поиска и модель ранжирования остаются прежними.
+	//Поврежденный снимок - std::runtime_error, сервер при этом не меняется
+	void LoadSnapshot(std::istream& input);
+
 private:
+	//строится из внутренних структур сервера
+	friend class FrozenSearchServer;
 
-	//структура данных документа (средний рейтинг, статус)
+	//структура данных документа (средний рейтинг, статус, плотный номер)
 	struct DocumentData {
 		int rating;
 		DocumentStatus status;
+		int slot;
+	};
+	//список вхождений слова: плотные номера документов по возрастанию и число вхождений слова в документ,
+	//лежащие подряд в памяти, чтобы подсчет релевантности шел блоками. Вес вхождения не хранится:
+	//ядро подсчета выводит его из числа вхождений и нормы документа (8 байт на вхождение вместо 16)
+	struct PostingList {
+		uint32_t term_id = 0;
+		std::vector<int> slots;
+		std::vector<int> word_counts;
+	};
+	//позиции слова в документах в том же порядке, что и в PostingList: для каждого вхождения
+	//смещение в потоке байтов, где позиции по возрастанию записаны разностями в формате varint
+	struct PositionList {
+		std::vector<uint32_t> offsets;
+		std::vector<uint8_t> bytes;
+	};
+	//слово запроса со ссылками на его списки (nullptr, если слова нет в индексе)
+	struct PositionalTerm {
+		const PostingList* postings;
+		const PositionList* positions;
 	};
 	//контейнер стоп-слов
 	std::set<std::string, std::less<>> stop_words_;
+	uint64_t stop_words_version_ = 0;
 	//контейнер слов
 	std::set<std::string> words_;
-	//контейнер std::map<слово, std::map<id документа, inverse document frequency(IDF)>>
-	std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-	//контейнер std::map<id документа, std::map<слово, inverse document frequency(IDF)>>	
-	std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
+	//контейнер std::map<слово, список вхождений>
+	std::map<std::string_view, PostingList> word_to_document_freqs_;
+	//слова по номерам, номер выдается слову при первом появлении и не меняется
+	std::vector<std::string_view> term_words_;
+	//прямой индекс: слова каждого документа по плотному номеру
+	ForwardIndex forward_index_;
+	bool forward_index_enabled_ = true;
 	//контейнер std::map<id документа, рейтинг-статус>
 	std::map<int, DocumentData> documents_;
 	//контейнер id документов в порядек их обавления
 	std::vector<int> document_ids_;
+	//колонки данных документов по плотному номеру; номер выдается при добавлении и не переиспользуется,
+	//у удаленного документа id равен -1. Читаются по номеру вразброс, поэтому могут лежать
+	//на больших страницах (SetHugePageMode)
+	IndexVector<int> slot_ids_;
+	IndexVector<int> slot_ratings_;
+	IndexVector<DocumentStatus> slot_statuses_;
+	//число слов документа без стоп-слов
+	IndexVector<int> slot_lengths_;
+	//норма документа по текущей модели ранжирования (Scorer::DocumentNorm)
+	IndexVector<double> slot_norms_;
+	//суммарная длина документов в индексе
+	long long total_document_length_ = 0;
+	//модель ранжирования, по которой посчитаны нормы документов
+	std::shared_ptr<const Scorer> scorer_ = std::make_shared<TfIdfScorer>();
+	//позиционный индекс, заполняется только если включен
+	bool positions_enabled_ = false;
+	std::map<std::string_view, PositionList> word_to_positions_;
+	//вхождения слов, ставших стоп-словами после индексации (позиции - см. CollectStoredSequences)
+	std::map<std::string_view, std::pair<PostingList, PositionList>> stopped_postings_;
+	double proximity_weight_ = 0;
+	//отсортированный словарь для раскрытия префиксов; строится при первом запросе с префиксом
+	//после изменения индекса, поэтому читается и заменяется атомарно
+	mutable std::shared_ptr<const TermDictionary> term_dictionary_;
+	size_t prefix_expansion_limit_ = MAX_PREFIX_EXPANSION;
+	int fuzzy_max_distance_ = 0;
+	bool boolean_queries_enabled_ = false;
+	mutable QueryMetrics metrics_;
+	ExecutionPlanner planner_ = ExecutionPlanner::GetDefault();
+	//бюджет памяти и оценка занятой памяти: точный подсчет плюс приросты добавленных с тех пор документов
+	size_t memory_budget_ = 0;
+	size_t memory_usage_ = 0;
 
 	//вычисление среднего рейтинга документов
 	static int ComputeAverageRating(const std::vector<int>& ratings);
 
-	//вычисление Inverse Document Frequency
-	double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
+	//вычисление веса слова запроса по текущей модели (для TF-IDF - Inverse Document Frequency)
+	//по общей статистике corpus_statistics, если она передана и в ней есть слово
+	double ComputeWordInverseDocumentFreq(const std::string_view& word,
+		const CorpusStatistics* corpus_statistics = nullptr) const;
+
+	//вид веса вхождения по средней длине документа из corpus_statistics, если она передана, иначе из индекса
+	PostingWeightForm GetPostingWeightForm(const CorpusStatistics* corpus_statistics = nullptr) const;
 	
 	void EraseOther(int document_id);
 
+	//построение прямого индекса одним проходом по спискам вхождений
+	void RebuildForwardIndex();
+
+	//пересчет норм документов slots после изменения их длины
+	void UpdateDocumentNorms(const std::vector<int>& slots);
+
+	static void CheckStopWords(const std::vector<std::string_view>& words);
+
+	//Позиции действующих слов хранятся среди действующих слов документа, позиции слов, ставших
+	//стоп-словами, - среди всех сохраненных слов документа (действующих и остановленных). По ним
+	//восстанавливается последовательность сохраненных слов каждого из документов slots
+	std::map<int, std::vector<std::string_view>> CollectStoredSequences(std::vector<int> slots) const;
+
+	//позиции слов документов из sequences заново по их последовательностям и текущим стоп-словам
+	void ReencodePositions(const std::map<int, std::vector<std::string_view>>& sequences);
+
+	//оценка прироста памяти при добавлении документа из слов words (с запасом)
+	size_t EstimateDocumentMemory(const std::vector<std::string_view>& words) const;
+
+	//проверка бюджета перед добавлением документа; нет места и после уплотнения - std::length_error
+	void CheckMemoryBudget(const std::vector<std::string_view>& words);
+
+	//после изменений, прирост которых не оценивался, следующая проверка бюджета считает память точно
+	void InvalidateMemoryUsage();
+
+	//слова документа по возрастанию номера; если прямой индекс не хранится, они восстанавливаются в buffer
+	std::pair<const ForwardEntry*, const ForwardEntry*> GetForwardEntries(int slot,
+		std::vector<ForwardEntry>& buffer) const;
+
+	std::vector<ForwardEntry> ReconstructForwardEntries(int slot) const;
+
+	//номер слова в индексе, если слово есть в документе с номером slot
+	bool FindWordInDocument(std::string_view word, const std::pair<const ForwardEntry*, const ForwardEntry*>& entries,
+		uint32_t& term_id) const;
+
+	//индекс документа в списке вхождений слова, postings.slots.size() если его там нет
+	static size_t FindPosting(const PostingList& postings, int slot);
+
+	//удаление вхождения с индексом index из списка вхождений и из позиций слова
+	static void ErasePosting(PostingList& postings, size_t index);
+	static void ErasePositions(PositionList& positions, size_t index);
+
+	//позиции слова в документе с индексом posting_index в списке вхождений
+	static void DecodePositions(const PositionList& positions, size_t posting_index, std::vector<uint32_t>& result);
+
+	std::vector<PositionalTerm> GetPositionalTerms(const std::vector<std::string_view>& words) const;
+
+	//проверка фразы по позициям: terms[i] - i-е слово фразы, posting_indexes[i] - индекс документа в его списке
+	static bool PhraseMatches(const std::vector<PositionalTerm>& terms, const std::vector<size_t>& posting_indexes);
+
+	//номера документов, содержащих фразу подряд, по возрастанию
+	std::vector<int> FindPhraseSlots(const std::vector<std::string_view>& phrase) const;
+
+	bool ContainsPhrase(int slot, const std::vector<std::string_view>& phrase) const;
+
+	//добавка за близость найденных в документе слов запроса
+	double ComputeProximityBoost(const std::vector<PositionalTerm>& terms, int slot) const;
+
 	//Проверка слова на вхожение в перечень стоп-слов
 	bool IsStopWord(const std::string_view& word) const;
 
@@ -128,16 +452,14 @@ private:
 	//получение из строки контейнера отдельных слов, исключая стоп-слова
 	std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view& text) const;
 
-	//Структура поскового запроса (плюс- и минус-слова)
-	struct Query {
-		std::set<std::string_view> plus_words;
-		std::set<std::string_view> minus_words;
-	};
-
-	//Структура поскового запроса (плюс- и минус-слова) с итераторами произвольного доступа
+	//Структура поскового запроса (плюс- и минус-слова, фразы) с итераторами произвольного доступа;
+	//слова фраз входят и в плюс-слова. Для запроса с операторами или обязательными словами
+	//nodes - дерево логического запроса (nodes[0] - корень), для обычного запроса оно пусто
 	struct QueryPar {
 		std::vector<std::string_view> plus_words;
 		std::vector<std::string_view> minus_words;
+		std::vector<std::vector<std::string_view>> phrases;
+		std::vector<BooleanNode> nodes;
 		void Normalize() {
 			Normilize_(plus_words);
 			Normilize_(minus_words);
@@ -151,24 +473,131 @@ private:
 
 	};
 
-	//парсинг запроса на минус- и плюс-слова
-	Query ParseQuery(const std::string_view& text) const;
-
-	//парсинг запроса на минус- и плюс-слова с параллелизацией
-	QueryPar ParseQueryPar(const std::string_view& text) const;
+	//парсинг запроса на минус- и плюс-слова с параллелизацией; слова раскрываются по corpus_statistics,
+	//если в ней есть их раскрытия, а раскрытия по своему словарю записываются в expansions
+	QueryPar ParseQueryPar(const std::string_view& text, const CorpusStatistics* corpus_statistics = nullptr,
+		CorpusStatistics* expansions = nullptr) const;
 
-	//Структура для идентификации слова поскового запроса (минус/плюс- или стоп-слово)
+	//Структура для идентификации слова поскового запроса (минус/плюс- или стоп-слово, префикс, обязательное)
 	struct QueryWord {
 		std::string_view data;
 		bool is_minus;
 		bool is_stop;
+		bool is_prefix;
+		bool is_required;
 	};
 
+	//Лексемы запроса и текущее положение разбора
+	struct QueryTokens {
+		std::vector<std::string_view> tokens;
+		size_t position = 0;
+		//в запросе есть операторы, скобки или обязательные слова
+		bool is_boolean = false;
+		const CorpusStatistics* corpus_statistics = nullptr;
+		CorpusStatistics* expansions = nullptr;
+	};
+
+	//слова запроса с отделенными скобками; знак перед скобкой ("-(", "+(") - отдельная лексема
+	static std::vector<std::string_view> SplitQueryTokens(const std::string_view& text);
+
+	//разбор частей группы node до закрывающей скобки (не съедается) или конца запроса;
+	//части без оператора между ними объединяются через OR
+	void ParseQueryGroup(QueryTokens& tokens, QueryPar& query, int node, int depth) const;
+
+	//части, связанные AND; цепочка из нескольких частей - вложенная группа обязательных частей
+	std::optional<BooleanClause> ParseQueryAndChain(QueryTokens& tokens, QueryPar& query, int depth) const;
+
+	//слово, группа в скобках или NOT с частью; пусто для стоп-слова
+	std::optional<BooleanClause> ParseQueryClause(QueryTokens& tokens, QueryPar& query, int depth) const;
+
+	//фраза в кавычках (только вне скобок): слова фразы обязательны
+	void ParseQueryPhrase(QueryTokens& tokens, QueryPar& query) const;
+
+	//плюс-слова - все слова дерева вне отрицания, минус-слова - исключенные слова корня
+	static void CollectQueryWords(QueryPar& query, int node, bool is_negated);
+
+	//номера документов, подходящих под логический запрос, по возрастанию
+	std::vector<int> FindBooleanSlots(const QueryPar& query) const;
+
+	//добавление в words слов индекса, начинающихся с prefix
+	void ExpandPrefix(std::string_view prefix, std::vector<std::string_view>& words) const;
+
+	//есть ли слово хотя бы в одном документе
+	bool IsIndexedWord(std::string_view word) const;
+
+	//добавление в words ближайших к word слов индекса для нечеткого поиска;
+	//возвращает их расстояние (максимальное int, если ничего не найдено)
+	int ExpandFuzzy(std::string_view word, std::vector<std::string_view>& words) const;
+
+	//раскрытие префикса для разбираемого запроса: по статистике корпуса или по своему словарю
+	void ExpandQueryPrefix(QueryTokens& tokens, std::string_view prefix, std::vector<std::string_view>& words) const;
+
+	//то же для нечеткого поиска; false - слово есть в индексе (корпуса) и не раскрывается
+	bool ExpandQueryFuzzy(QueryTokens& tokens, std::string_view word, std::vector<std::string_view>& words) const;
+
+	std::shared_ptr<const TermDictionary> GetTermDictionary() const;
+
 	QueryWord ParseQueryWord(std::string_view text) const;
 
+	//Запрос для матчинга: слова, которые есть в индексе, по возрастанию номера
+	struct MatchQuery {
+		std::vector<std::pair<uint32_t, std::string_view>> plus_terms;
+		std::vector<uint32_t> minus_terms;
+		std::vector<std::vector<std::string_view>> phrases;
+		std::vector<BooleanNode> nodes;
+	};
+
+	MatchQuery ParseMatchQuery(const std::string_view& raw_query) const;
+
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const MatchQuery& query,
+		int document_id) const;
+
+	//участок плотных номеров документов [begin, end)
+	struct SlotRange {
+		size_t begin;
+		size_t end;
+	};
+
+	//отбор страницы выдачи: не больше size документов (0 - все без сортировки),
+	//идущих после after (если задан) в порядке IsRankedBefore
+	struct PageRequest {
+		size_t size;
+		const Document* after;
+	};
+
+	//подсчет релевантности в плотный аккумулятор по номерам документов; не затронутые запросом документы
+	//и документы с минус-словами остаются равными -0.0. С parallel пространство номеров делится
+	//на части по объему работы, и части считаются параллельно; возвращает использованные части.
+	//Для логического запроса без фраз candidates - номера кандидатов по возрастанию, и заполнены
+	//только они; иначе candidates пуст
+	std::vector<SlotRange> AccumulateRelevance(const QueryPar& query, IndexVector<double>& accumulator,
+		std::vector<int>& candidates, const CorpusStatistics* corpus_statistics, QueryTimer& timer,
+		bool parallel) const;
+
+	//слова запроса в профиль: плюс-слова с весами, затем минус-слова; все вхождения просматриваются
+	void AddTermProfiles(const QueryPar& query, const CorpusStatistics* corpus_statistics, QueryProfile& profile) const;
+
+	//отбор кандидатов по фразам запроса и добавка за близость слов
+	void ApplyPositionalConstraints(const QueryPar& query, IndexVector<double>& accumulator) const;
+
+	//кандидаты в выдачу: лучшие MAX_RESULT_DOCUMENT_COUNT документов каждой части пространства номеров
+	//или, если задан page, документы страницы из каждой части; если задан facets, к его счетчикам
+	//добавляются все найденные документы
+	template<typename Predic, typename ExecutionPolicy>
+	std::vector<Document> FindAllDocuments(ExecutionPolicy policy, const QueryPar& query, Predic predic,
+		const CorpusStatistics* corpus_statistics, QueryTimer& timer, const PageRequest* page,
+		SearchFacets* facets) const;
+
 	template<typename Predic, typename ExecutionPolicy>
-	std::vector<Document> FindAllDocuments(ExecutionPolicy policy,
-		const QueryPar& query, Predic predic) const;
+	std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view& raw_query, Predic predic,
+		const CorpusStatistics* corpus_statistics, QueryProfile* profile = nullptr,
+		const PageRequest* page = nullptr, SearchFacets* facets = nullptr) const;
+
+	//выбор плана по суммарной длине списков вхождений плюс-слов
+	ExecutionPlan ChoosePlan(const QueryPar& query) const;
+
+	//число документов, затронутых запросом (для профиля)
+	static size_t CountCandidates(const IndexVector<double>& accumulator);
 
 };
 
@@ -179,39 +608,119 @@ SearchServer::SearchServer(const StringContainer& stop_words) {
 
 template<typename Predic, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy,
-	const QueryPar& query, Predic predic) const {
-	ConcurrentMap<int, double> document_to_relevance(MAX_THREADS);
-	for_each(policy,
-		query.plus_words.begin(), query.plus_words.end(),
-		[&document_to_relevance, &query, predic, this, policy](auto& plus_word) {
-			if (plus_word != "" && word_to_document_freqs_.count(plus_word)) {
-				const double inverse_document_freq = ComputeWordInverseDocumentFreq(plus_word);
-				for (const auto [document_id, term_freq] : word_to_document_freqs_.at(plus_word)) {
-					bool is_contains_stopword = std::any_of(
-						query.minus_words.begin(), query.minus_words.end(),
-						[this, document_id](auto& minus_word) { return document_to_word_freqs_.at(document_id).count(minus_word); }
-					);
-					const DocumentData& doc = documents_.at(document_id);
-					if (!is_contains_stopword && predic(document_id, doc.status, doc.rating)) {
-						document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-					}
+	const QueryPar& query, Predic predic, const CorpusStatistics* corpus_statistics, QueryTimer& timer,
+	const PageRequest* page, SearchFacets* facets) const {
+	constexpr bool is_sequenced = std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>;
+	//буферы переиспользуются запросами потока; лямбды ниже выполняются и в других потоках и
+	//не захватывают thread_local переменные, поэтому захватываются обычные ссылки на буферы этого потока
+	thread_local IndexVector<double> thread_accumulator;
+	thread_local std::vector<int> thread_candidates;
+	IndexVector<double>& accumulator = thread_accumulator;
+	std::vector<int>& candidates = thread_candidates;
+	const std::vector<SlotRange> ranges = AccumulateRelevance(query, accumulator, candidates, corpus_statistics, timer,
+		!is_sequenced);
+	QueryProfile* const profile = timer.GetProfile();
+	if (profile != nullptr) {
+		profile->execution_path = is_sequenced ? "seq"s : "par"s;
+	}
+	//в каждой части отбор по предикату и локальный top-K: в результат попадают только лучшие документы частей,
+	//и сортировать в FindTopDocuments приходится их, а не все найденные
+	const size_t top_count = page == nullptr ? MAX_RESULT_DOCUMENT_COUNT : page->size;
+	const auto is_before = page == nullptr ? IsMoreRelevant : IsRankedBefore;
+	const Document* const after = page == nullptr ? nullptr : page->after;
+	struct RangeDocuments {
+		size_t matched = 0;
+		std::vector<Document> documents;
+		SearchFacets facets;
+	};
+	const auto collect_range = [&](const SlotRange& range) {
+		RangeDocuments result;
+		std::vector<Document>& documents = result.documents;
+		if (facets != nullptr) {
+			result.facets.rating_bucket_width = facets->rating_bucket_width;
+		}
+		//рейтинги соседних документов часто попадают в одну корзину, поэтому последняя запоминается
+		auto rating_count = result.facets.rating_counts.end();
+		const auto collect_slot = [&](size_t slot) {
+			const double relevance = accumulator[slot];
+			if (std::signbit(relevance)) {
+				return;
+			}
+			if (facets != nullptr) {
+				++result.facets.status_counts[static_cast<size_t>(slot_statuses_[slot])];
+				const int bucket = result.facets.GetRatingBucket(slot_ratings_[slot]);
+				if (rating_count == result.facets.rating_counts.end() || rating_count->first != bucket) {
+					rating_count = result.facets.rating_counts.try_emplace(bucket, 0).first;
 				}
+				++rating_count->second;
+			}
+			const Document document{ slot_ids_[slot], relevance, slot_ratings_[slot] };
+			if (after != nullptr && !IsRankedBefore(*after, document)) {
+				return;
+			}
+			if (predic(document.id, slot_statuses_[slot], document.rating)) {
+				documents.push_back(document);
+			}
+		};
+		if (candidates.empty()) {
+			for (size_t slot = range.begin; slot < range.end; ++slot) {
+				collect_slot(slot);
+			}
+		} else {
+			//логический запрос: просматриваются только кандидаты части
+			auto candidate = std::lower_bound(candidates.begin(), candidates.end(), static_cast<int>(range.begin));
+			for (; candidate != candidates.end() && *candidate < static_cast<int>(range.end); ++candidate) {
+				collect_slot(*candidate);
 			}
 		}
-	);
-
+		result.matched = documents.size();
+		if (top_count != 0 && documents.size() > top_count) {
+			std::partial_sort(documents.begin(), documents.begin() + top_count, documents.end(), is_before);
+			documents.resize(top_count);
+		}
+		return result;
+	};
+	std::vector<RangeDocuments> range_documents(ranges.size());
+	if (ranges.size() == 1) {
+		range_documents.front() = collect_range(ranges.front());
+	} else {
+		std::transform(policy, ranges.begin(), ranges.end(), range_documents.begin(), collect_range);
+	}
 	std::vector<Document> matched_documents;
-	matched_documents.reserve(document_to_relevance.Size());
-	for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-		matched_documents.push_back({
-			document_id,
-			relevance,
-			documents_.at(document_id).rating
-			});
+	size_t matched = 0;
+	for (const RangeDocuments& range : range_documents) {
+		matched += range.matched;
+		matched_documents.insert(matched_documents.end(), range.documents.begin(), range.documents.end());
+		if (facets != nullptr) {
+			*facets += range.facets;
+		}
+	}
+	timer.AddDocumentsMatched(matched);
+	timer.Lap(QueryStage::RESULT_BUILD);
+	if (profile != nullptr) {
+		profile->candidates_after_predicate = matched;
 	}
 	return matched_documents;
 }
 
+template<typename ExecutionPolicy>
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(ExecutionPolicy policy,
+	const std::string_view& raw_query, const std::vector<int>& document_ids) const {
+	//исключение внутри алгоритма с политикой выполнения завершает программу, поэтому id проверяются заранее
+	for (const int document_id : document_ids) {
+		if (!documents_.count(document_id)) {
+			throw std::out_of_range("doc's id ("s + std::to_string(document_id) + ") is not found"s);
+		}
+	}
+	const MatchQuery query = ParseMatchQuery(raw_query);
+	std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> result(document_ids.size());
+	std::transform(policy,
+		document_ids.begin(), document_ids.end(),
+		result.begin(),
+		[&query, this](int document_id) { return MatchDocument(query, document_id); }
+	);
+	return result;
+}
 
 template<typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy,
@@ -234,23 +743,114 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw
 template<typename Predic, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy,
 	const std::string_view& raw_query, Predic predic) const {
-	QueryPar query = ParseQueryPar(raw_query);
+	return FindTopDocuments(policy, raw_query, predic, nullptr);
+}
+
+template<typename Predic, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy,
+	const std::string_view& raw_query, Predic predic, const CorpusStatistics& corpus_statistics) const {
+	return FindTopDocuments(policy, raw_query, predic, &corpus_statistics);
+}
+
+template<typename Predic, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, const std::string_view& raw_query,
+	Predic predic, const CorpusStatistics* corpus_statistics, QueryProfile* profile, const PageRequest* page,
+	SearchFacets* facets) const {
+	QueryTimer timer(metrics_, profile);
+	QueryPar query = ParseQueryPar(raw_query, corpus_statistics);
 	query.Normalize();
-	std::vector<Document> result = FindAllDocuments(policy, query, predic);
-	std::sort(result.begin(), result.end(),
-		[](const Document& lhs, const Document& rhs) {
-			if (std::abs(lhs.relevance - rhs.relevance) < RELEVANCE_TRESHOLD) {
-				return lhs.rating > rhs.rating;
-			} else {
-				return lhs.relevance > rhs.relevance;
-			}
-		});
-	if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		result.resize(MAX_RESULT_DOCUMENT_COUNT);
+	std::vector<Document> result;
+	if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, AdaptivePolicy>) {
+		const ExecutionPlan plan = ChoosePlan(query);
+		timer.Lap(QueryStage::PARSE);
+		if (profile != nullptr) {
+			profile->adaptive = true;
+		}
+		if (plan == ExecutionPlan::RANGE_PARALLEL) {
+			result = FindAllDocuments(std::execution::par, query, predic, corpus_statistics, timer, page, facets);
+		} else {
+			result = FindAllDocuments(std::execution::seq, query, predic, corpus_statistics, timer, page, facets);
+		}
+	} else {
+		timer.Lap(QueryStage::PARSE);
+		result = FindAllDocuments(policy, query, predic, corpus_statistics, timer, page, facets);
+	}
+	if (page == nullptr) {
+		std::sort(result.begin(), result.end(), IsMoreRelevant);
+		if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
+			result.resize(MAX_RESULT_DOCUMENT_COUNT);
+		}
+	} else if (page->size != 0) {
+		std::sort(result.begin(), result.end(), IsRankedBefore);
+		if (result.size() > page->size) {
+			result.resize(page->size);
+		}
+	}
+	timer.Lap(QueryStage::TOP_K);
+	timer.Finish();
+	if (profile != nullptr) {
+		profile->results = result.size();
+	}
+	return result;
+}
+
+template<typename Predic, typename ExecutionPolicy>
+SearchPage SearchServer::FindPage(ExecutionPolicy policy, const std::string_view& raw_query, Predic predic,
+	size_t page_size, const std::string_view& cursor) const {
+	if (page_size == 0) {
+		throw std::invalid_argument("page size must be positive"s);
+	}
+	std::optional<Document> after;
+	if (!cursor.empty()) {
+		const SearchCursor decoded = DecodeSearchCursor(cursor);
+		//после смены стоп-слов релевантность документов другая, и курсор указал бы не на то место выдачи
+		if (decoded.stop_words_version != stop_words_version_) {
+			throw std::invalid_argument("search cursor is stale: stop-words have changed"s);
+		}
+		after = decoded.after;
+	}
+	const PageRequest page{ page_size, after ? &*after : nullptr };
+	SearchPage result;
+	result.documents = FindTopDocuments(policy, raw_query, predic, nullptr, nullptr, &page);
+	if (result.documents.size() == page_size) {
+		result.next_cursor = EncodeSearchCursor({ result.documents.back(), stop_words_version_ });
+	}
+	return result;
+}
+
+template<typename Predic, typename ExecutionPolicy>
+SearchResults SearchServer::FindAllPages(ExecutionPolicy policy, const std::string_view& raw_query,
+	Predic predic) const {
+	const PageRequest page{ 0, nullptr };
+	return SearchResults(FindTopDocuments(policy, raw_query, predic, nullptr, nullptr, &page));
+}
+
+template<typename Predic, typename ExecutionPolicy>
+FacetedDocuments SearchServer::FindFacetedDocuments(ExecutionPolicy policy, const std::string_view& raw_query,
+	Predic predic, int rating_bucket_width) const {
+	if (rating_bucket_width <= 0) {
+		throw std::invalid_argument("rating bucket width must be positive"s);
 	}
+	FacetedDocuments result;
+	result.facets.rating_bucket_width = rating_bucket_width;
+	result.documents = FindTopDocuments(policy, raw_query, predic, nullptr, nullptr, nullptr, &result.facets);
 	return result;
 }
 
+template<typename ExecutionPolicy>
+std::vector<Document> SearchServer::ExplainTopDocuments(ExecutionPolicy policy,
+	const std::string_view& raw_query, QueryProfile& profile) const {
+	return ExplainTopDocuments(policy, raw_query,
+		[](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::ACTUAL; }, profile);
+}
+
+template<typename Predic, typename ExecutionPolicy>
+std::vector<Document> SearchServer::ExplainTopDocuments(ExecutionPolicy policy,
+	const std::string_view& raw_query, Predic predic, QueryProfile& profile) const {
+	profile = QueryProfile{};
+	return FindTopDocuments(policy, raw_query, predic, nullptr, &profile);
+}
+
 template <typename StringContainer>
 void SearchServer::MakeSetOfStopWords(const StringContainer& container) {
 	for (const std::string_view& str : container) {
@@ -0,0 +1,343 @@
+#include "shard_socket.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+namespace {
+
+sockaddr_un MakeAddress(const std::string& socket_path) {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+		throw std::invalid_argument("bad socket path: "s + socket_path);
+	}
+	std::memcpy(address.sun_path, socket_path.data(), socket_path.size());
+	return address;
+}
+
+std::runtime_error SystemError(const std::string& what) {
+	return std::runtime_error(what + ": "s + std::strerror(errno));
+}
+
+void WriteAll(int socket, const std::string& data) {
+	size_t written = 0;
+	while (written < data.size()) {
+		const ssize_t count = send(socket, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw SystemError("send"s);
+		}
+		written += count;
+	}
+}
+
+//чтение строки без '\n'; false, если соединение закрыто
+bool ReadLine(int socket, std::string& buffer, std::string& line) {
+	size_t end;
+	while ((end = buffer.find('\n')) == std::string::npos) {
+		char chunk[4096];
+		const ssize_t count = recv(socket, chunk, sizeof(chunk), 0);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return false;
+		}
+		buffer.append(chunk, count);
+	}
+	line.assign(buffer, 0, end);
+	buffer.erase(0, end + 1);
+	return true;
+}
+
+std::vector<std::string> SplitFields(const std::string& line) {
+	std::vector<std::string> fields;
+	size_t begin = 0;
+	while (true) {
+		const size_t end = line.find('\t', begin);
+		fields.push_back(line.substr(begin, end - begin));
+		if (end == std::string::npos) {
+			return fields;
+		}
+		begin = end + 1;
+	}
+}
+
+//табуляция и перевод строки сломали бы разбор; сервер все равно отверг бы такие символы
+const std::string_view& CheckField(const std::string_view& text) {
+	if (text.find_first_of("\t\n") != std::string_view::npos) {
+		throw std::invalid_argument("control character in shard request"s);
+	}
+	return text;
+}
+
+std::string FormatDouble(double value) {
+	char text[64];
+	std::snprintf(text, sizeof(text), "%a", value);
+	return text;
+}
+
+double ParseDouble(const std::string& text) {
+	return std::strtod(text.c_str(), nullptr);
+}
+
+//раскрытия: их число, затем у каждого слово, limit, distance, число слов и слова
+void AppendExpansions(std::string& response, const std::map<std::string, TermExpansion, std::less<>>& expansions) {
+	response += "\t"s + std::to_string(expansions.size());
+	for (const auto& [word, expansion] : expansions) {
+		response += "\t"s + word + "\t"s + std::to_string(expansion.limit) + "\t"s + std::to_string(expansion.distance)
+			+ "\t"s + std::to_string(expansion.words.size());
+		for (const std::string& expanded_word : expansion.words) {
+			response += "\t"s + expanded_word;
+		}
+	}
+}
+
+std::map<std::string, TermExpansion, std::less<>> ParseExpansions(const std::vector<std::string>& fields,
+	size_t& position) {
+	std::map<std::string, TermExpansion, std::less<>> expansions;
+	const size_t count = std::stoull(fields.at(position++));
+	for (size_t i = 0; i < count; ++i) {
+		TermExpansion& expansion = expansions[fields.at(position)];
+		expansion.limit = std::stoull(fields.at(position + 1));
+		expansion.distance = std::stoi(fields.at(position + 2));
+		const size_t word_count = std::stoull(fields.at(position + 3));
+		position += 4;
+		for (size_t j = 0; j < word_count; ++j) {
+			expansion.words.push_back(fields.at(position++));
+		}
+	}
+	return expansions;
+}
+
+//число документов, суммарная длина, число слов и пары слово - число документов, затем раскрытия
+//префиксов и нечеткого поиска
+void AppendStatistics(std::string& response, const CorpusStatistics& corpus_statistics) {
+	response += "\t"s + std::to_string(corpus_statistics.document_count);
+	response += "\t"s + std::to_string(corpus_statistics.total_document_length);
+	response += "\t"s + std::to_string(corpus_statistics.document_freqs.size());
+	for (const auto& [word, document_freq] : corpus_statistics.document_freqs) {
+		response += "\t"s + word + "\t"s + std::to_string(document_freq);
+	}
+	AppendExpansions(response, corpus_statistics.prefix_expansions);
+	AppendExpansions(response, corpus_statistics.fuzzy_expansions);
+}
+
+CorpusStatistics ParseStatistics(const std::vector<std::string>& fields, size_t begin) {
+	CorpusStatistics corpus_statistics;
+	corpus_statistics.document_count = std::stoull(fields.at(begin));
+	corpus_statistics.total_document_length = std::stoull(fields.at(begin + 1));
+	const size_t word_count = std::stoull(fields.at(begin + 2));
+	size_t position = begin + 3;
+	for (size_t i = 0; i < word_count; ++i, position += 2) {
+		corpus_statistics.document_freqs.emplace(fields.at(position), std::stoull(fields.at(position + 1)));
+	}
+	corpus_statistics.prefix_expansions = ParseExpansions(fields, position);
+	corpus_statistics.fuzzy_expansions = ParseExpansions(fields, position);
+	return corpus_statistics;
+}
+
+std::string HandleRequest(SearchServer& search_server, const std::vector<std::string>& fields, bool& running) {
+	const std::string& command = fields.at(0);
+	std::string response = "OK"s;
+	if (command == "ADD"s) {
+		std::vector<int> ratings;
+		const std::string& ratings_field = fields.at(3);
+		for (size_t begin = 0; begin < ratings_field.size();) {
+			size_t end = ratings_field.find(',', begin);
+			if (end == std::string::npos) {
+				end = ratings_field.size();
+			}
+			ratings.push_back(std::stoi(ratings_field.substr(begin, end - begin)));
+			begin = end + 1;
+		}
+		search_server.AddDocument(std::stoi(fields.at(1)), fields.at(4),
+			static_cast<DocumentStatus>(std::stoi(fields.at(2))), ratings);
+	} else if (command == "REMOVE"s) {
+		search_server.RemoveDocument(std::stoi(fields.at(1)));
+	} else if (command == "COUNT"s) {
+		response += "\t"s + std::to_string(search_server.GetDocumentCount());
+	} else if (command == "STATS"s) {
+		AppendStatistics(response, search_server.GetQueryStatistics(fields.at(1)));
+	} else if (command == "FIND"s) {
+		const DocumentStatus status = static_cast<DocumentStatus>(std::stoi(fields.at(1)));
+		const CorpusStatistics corpus_statistics = ParseStatistics(fields, 3);
+		for (const Document& document : search_server.FindTopDocuments(std::execution::seq, fields.at(2),
+			[status](int document_id, DocumentStatus document_status, int rating) { return document_status == status; },
+			corpus_statistics)) {
+			response += "\t"s + std::to_string(document.id) + "\t"s + FormatDouble(document.relevance)
+				+ "\t"s + std::to_string(document.rating);
+		}
+	} else if (command == "SHUTDOWN"s) {
+		running = false;
+	} else {
+		throw std::invalid_argument("unknown shard command: "s + command);
+	}
+	return response;
+}
+
+std::string MakeErrorResponse(const std::string& type, const char* message) {
+	std::string text = message;
+	for (char& c : text) {
+		if (c == '\t' || c == '\n') {
+			c = ' ';
+		}
+	}
+	return "ERROR\t"s + type + "\t"s + text;
+}
+
+}
+
+void ServeShard(SearchServer& search_server, const std::string& socket_path) {
+	const sockaddr_un address = MakeAddress(socket_path);
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) {
+		throw SystemError("socket"s);
+	}
+	unlink(socket_path.c_str());
+	if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+		|| listen(listener, 1) < 0) {
+		const std::runtime_error error = SystemError("bind "s + socket_path);
+		close(listener);
+		throw error;
+	}
+	bool running = true;
+	while (running) {
+		const int client = accept(listener, nullptr, nullptr);
+		if (client < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		std::string buffer;
+		std::string line;
+		while (running && ReadLine(client, buffer, line)) {
+			std::string response;
+			try {
+				response = HandleRequest(search_server, SplitFields(line), running);
+			} catch (const std::invalid_argument& error) {
+				response = MakeErrorResponse("invalid_argument"s, error.what());
+			} catch (const std::out_of_range& error) {
+				response = MakeErrorResponse("out_of_range"s, error.what());
+			} catch (const std::exception& error) {
+				response = MakeErrorResponse("runtime_error"s, error.what());
+			}
+			response.push_back('\n');
+			try {
+				WriteAll(client, response);
+			} catch (const std::runtime_error&) {
+				break;
+			}
+		}
+		close(client);
+	}
+	close(listener);
+	unlink(socket_path.c_str());
+}
+
+RemoteShard::RemoteShard(const std::string& socket_path, int timeout_ms) {
+	const sockaddr_un address = MakeAddress(socket_path);
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+	while (true) {
+		socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (socket_ < 0) {
+			throw SystemError("socket"s);
+		}
+		if (connect(socket_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+			return;
+		}
+		close(socket_);
+		socket_ = -1;
+		if (std::chrono::steady_clock::now() >= deadline) {
+			throw SystemError("connect "s + socket_path);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+RemoteShard::~RemoteShard() {
+	if (socket_ >= 0) {
+		close(socket_);
+	}
+}
+
+void RemoteShard::AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	std::string ratings_field;
+	for (const int rating : ratings) {
+		if (!ratings_field.empty()) {
+			ratings_field.push_back(',');
+		}
+		ratings_field += std::to_string(rating);
+	}
+	Call("ADD\t"s + std::to_string(document_id) + "\t"s + std::to_string(static_cast<int>(status))
+		+ "\t"s + ratings_field + "\t"s + std::string(CheckField(document)));
+}
+
+void RemoteShard::RemoveDocument(int document_id) {
+	Call("REMOVE\t"s + std::to_string(document_id));
+}
+
+size_t RemoteShard::GetDocumentCount() const {
+	return std::stoull(Call("COUNT"s).at(1));
+}
+
+CorpusStatistics RemoteShard::GetQueryStatistics(const std::string_view& raw_query) const {
+	return ParseStatistics(Call("STATS\t"s + std::string(CheckField(raw_query))), 1);
+}
+
+std::vector<Document> RemoteShard::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+	const CorpusStatistics& corpus_statistics) const {
+	std::string request = "FIND\t"s + std::to_string(static_cast<int>(status)) + "\t"s + std::string(CheckField(raw_query));
+	AppendStatistics(request, corpus_statistics);
+	const std::vector<std::string> fields = Call(request);
+	std::vector<Document> result;
+	for (size_t i = 1; i + 2 < fields.size(); i += 3) {
+		result.emplace_back(std::stoi(fields[i]), ParseDouble(fields[i + 1]), std::stoi(fields[i + 2]));
+	}
+	return result;
+}
+
+std::vector<Document> RemoteShard::FindTopDocuments(const std::string_view& raw_query, const ShardPredicate& predic,
+	const CorpusStatistics& corpus_statistics) const {
+	throw std::logic_error("predicate queries are not supported by remote shards"s);
+}
+
+void RemoteShard::Shutdown() {
+	Call("SHUTDOWN"s);
+}
+
+std::vector<std::string> RemoteShard::Call(const std::string& request) const {
+	std::lock_guard guard(mutex_);
+	WriteAll(socket_, request + "\n"s);
+	std::string line;
+	if (!ReadLine(socket_, buffer_, line)) {
+		throw std::runtime_error("shard connection closed"s);
+	}
+	std::vector<std::string> fields = SplitFields(line);
+	if (fields.at(0) == "ERROR"s) {
+		const std::string& type = fields.at(1);
+		const std::string& message = fields.at(2);
+		if (type == "invalid_argument"s) {
+			throw std::invalid_argument(message);
+		} else if (type == "out_of_range"s) {
+			throw std::out_of_range(message);
+		}
+		throw std::runtime_error(message);
+	}
+	return fields;
+}
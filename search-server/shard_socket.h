@@ -0,0 +1,56 @@
+#pragma once
+
+#include "search_server.h"
+#include "sharded_search_server.h"
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Часть распределенного индекса в другом процессе той же машины через Unix-сокет.
+//Протокол строковый: команда и аргументы через табуляцию, одна строка на запрос и одна на ответ;
+//ответ "ERROR\t<тип>\t<сообщение>" превращается на стороне клиента в исключение того же типа.
+//Релевантность передается в шестнадцатеричном виде (%a), чтобы не терять точность
+
+//Обслуживает search_server на сокете socket_path, пока клиент не пришлет SHUTDOWN.
+//Клиенты обслуживаются по одному; запросы выполняются последовательно (std::execution::seq)
+void ServeShard(SearchServer& search_server, const std::string& socket_path);
+
+class RemoteShard : public SearchShard {
+public:
+	//ждет, пока сервер начнет слушать сокет, не дольше timeout_ms
+	explicit RemoteShard(const std::string& socket_path, int timeout_ms = 5000);
+
+	RemoteShard(const RemoteShard&) = delete;
+	RemoteShard& operator=(const RemoteShard&) = delete;
+
+	~RemoteShard() override;
+
+	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+		const std::vector<int>& ratings) override;
+
+	void RemoveDocument(int document_id) override;
+
+	size_t GetDocumentCount() const override;
+
+	CorpusStatistics GetQueryStatistics(const std::string_view& raw_query) const override;
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+		const CorpusStatistics& corpus_statistics) const override;
+
+	//предикат нельзя передать в другой процесс: бросает std::logic_error
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, const ShardPredicate& predic,
+		const CorpusStatistics& corpus_statistics) const override;
+
+	//останавливает ServeShard на той стороне
+	void Shutdown();
+
+private:
+	int socket_ = -1;
+	mutable std::mutex mutex_;
+	mutable std::string buffer_;
+
+	//отправка запроса и разбор ответа на поля; ошибки сервера пробрасываются исключениями
+	std::vector<std::string> Call(const std::string& request) const;
+};
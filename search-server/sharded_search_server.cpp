@@ -0,0 +1,134 @@
+#include "sharded_search_server.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std::string_literals;
+
+LocalShard::LocalShard(const std::string_view& stop_words)
+	: server_(stop_words) {
+}
+
+void LocalShard::AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	server_.AddDocument(document_id, document, status, ratings);
+}
+
+void LocalShard::RemoveDocument(int document_id) {
+	server_.RemoveDocument(document_id);
+}
+
+size_t LocalShard::GetDocumentCount() const {
+	return server_.GetDocumentCount();
+}
+
+CorpusStatistics LocalShard::GetQueryStatistics(const std::string_view& raw_query) const {
+	return server_.GetQueryStatistics(raw_query);
+}
+
+std::vector<Document> LocalShard::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+	const CorpusStatistics& corpus_statistics) const {
+	return server_.FindTopDocuments(std::execution::seq, raw_query,
+		[status](int document_id, DocumentStatus document_status, int rating) { return document_status == status; },
+		corpus_statistics);
+}
+
+std::vector<Document> LocalShard::FindTopDocuments(const std::string_view& raw_query, const ShardPredicate& predic,
+	const CorpusStatistics& corpus_statistics) const {
+	return server_.FindTopDocuments(std::execution::seq, raw_query, predic, corpus_statistics);
+}
+
+SearchServer& LocalShard::GetServer() {
+	return server_;
+}
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const std::string_view& stop_words) {
+	if (shard_count == 0) {
+		throw std::invalid_argument("shard count must be positive"s);
+	}
+	shards_.reserve(shard_count);
+	for (size_t i = 0; i < shard_count; ++i) {
+		shards_.push_back(std::make_unique<LocalShard>(stop_words));
+	}
+}
+
+ShardedSearchServer::ShardedSearchServer(std::vector<std::unique_ptr<SearchShard>> shards)
+	: shards_(std::move(shards)) {
+	if (shards_.empty()) {
+		throw std::invalid_argument("shard count must be positive"s);
+	}
+	for (const auto& shard : shards_) {
+		if (!shard) {
+			throw std::invalid_argument("null shard"s);
+		}
+	}
+}
+
+void ShardedSearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	//повторный id попадает в ту же часть, и она сама сообщит об ошибке
+	shards_[GetShardIndex(document_id)]->AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+	shards_[GetShardIndex(document_id)]->RemoveDocument(document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query) const {
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query,
+	DocumentStatus status) const {
+	const CorpusStatistics corpus_statistics = GetQueryStatistics(raw_query);
+	return MergeTopDocuments(Broadcast<std::vector<Document>>(
+		[&](const SearchShard& shard) { return shard.FindTopDocuments(raw_query, status, corpus_statistics); }));
+}
+
+size_t ShardedSearchServer::GetDocumentCount() const {
+	size_t count = 0;
+	for (const auto& shard : shards_) {
+		count += shard->GetDocumentCount();
+	}
+	return count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+	return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+	//перемешивание битов (finalizer MurmurHash3), чтобы подряд идущие id расходились по частям равномерно
+	uint32_t hash = static_cast<uint32_t>(document_id);
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+	return hash % shards_.size();
+}
+
+SearchShard& ShardedSearchServer::GetShard(size_t index) {
+	return *shards_.at(index);
+}
+
+CorpusStatistics ShardedSearchServer::GetQueryStatistics(const std::string_view& raw_query) const {
+	CorpusStatistics corpus_statistics;
+	for (const CorpusStatistics& shard_statistics : Broadcast<CorpusStatistics>(
+		[&](const SearchShard& shard) { return shard.GetQueryStatistics(raw_query); })) {
+		corpus_statistics += shard_statistics;
+	}
+	return corpus_statistics;
+}
+
+std::vector<Document> ShardedSearchServer::MergeTopDocuments(std::vector<std::vector<Document>> shard_results) const {
+	std::vector<Document> result;
+	for (const std::vector<Document>& documents : shard_results) {
+		result.insert(result.end(), documents.begin(), documents.end());
+	}
+	std::sort(result.begin(), result.end(), IsMoreRelevant);
+	if (result.size() > MAX_RESULT_DOCUMENT_COUNT) {
+		result.resize(MAX_RESULT_DOCUMENT_COUNT);
+	}
+	return result;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "document.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <execution>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using ShardPredicate = std::function<bool(int document_id, DocumentStatus status, int rating)>;
+
+//Часть распределенного индекса. Поиск в части идет с весами слов по общей статистике всех частей,
+//а префиксы и слова нечеткого поиска раскрываются по словарю всех частей (раскрытия собираются вместе
+//со статистикой), поэтому выдача совпадает с той, что дал бы один сервер со всеми документами.
+//Для этого у всех частей должны быть одинаковые настройки раскрытия (SetPrefixExpansionLimit, SetFuzzyMatching)
+class SearchShard {
+public:
+	virtual ~SearchShard() = default;
+
+	virtual void AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+		const std::vector<int>& ratings) = 0;
+
+	virtual void RemoveDocument(int document_id) = 0;
+
+	virtual size_t GetDocumentCount() const = 0;
+
+	virtual CorpusStatistics GetQueryStatistics(const std::string_view& raw_query) const = 0;
+
+	virtual std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+		const CorpusStatistics& corpus_statistics) const = 0;
+
+	virtual std::vector<Document> FindTopDocuments(const std::string_view& raw_query, const ShardPredicate& predic,
+		const CorpusStatistics& corpus_statistics) const = 0;
+};
+
+//Часть в этом же процессе: отдельный SearchServer
+class LocalShard : public SearchShard {
+public:
+	explicit LocalShard(const std::string_view& stop_words);
+
+	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+		const std::vector<int>& ratings) override;
+
+	void RemoveDocument(int document_id) override;
+
+	size_t GetDocumentCount() const override;
+
+	CorpusStatistics GetQueryStatistics(const std::string_view& raw_query) const override;
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status,
+		const CorpusStatistics& corpus_statistics) const override;
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, const ShardPredicate& predic,
+		const CorpusStatistics& corpus_statistics) const override;
+
+	//для настройки части (стоп-слова, формула ранжирования и т.п.)
+	SearchServer& GetServer();
+
+private:
+	SearchServer server_;
+};
+
+//Сервер, документы которого распределены между частями по хешу id.
+//Запрос рассылается всем частям дважды: сначала собирается общая статистика слов запроса,
+//затем каждая часть ищет свои лучшие документы с общими весами слов, и списки сливаются
+class ShardedSearchServer {
+public:
+	ShardedSearchServer(size_t shard_count, const std::string_view& stop_words);
+
+	explicit ShardedSearchServer(std::vector<std::unique_ptr<SearchShard>> shards);
+
+	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status,
+		const std::vector<int>& ratings);
+
+	void RemoveDocument(int document_id);
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
+
+	template<typename Predic>
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, Predic predic) const;
+
+	size_t GetDocumentCount() const;
+
+	size_t GetShardCount() const;
+
+	//номер части, в которой хранится документ document_id
+	size_t GetShardIndex(int document_id) const;
+
+	SearchShard& GetShard(size_t index);
+
+	//общая статистика всех частей по словам запроса
+	CorpusStatistics GetQueryStatistics(const std::string_view& raw_query) const;
+
+private:
+	std::vector<std::unique_ptr<SearchShard>> shards_;
+
+	//запрос к каждой части параллельно; исключение части пробрасывается после завершения всех
+	template<typename Result, typename Request>
+	std::vector<Result> Broadcast(Request request) const;
+
+	std::vector<Document> MergeTopDocuments(std::vector<std::vector<Document>> shard_results) const;
+};
+
+template<typename Result, typename Request>
+std::vector<Result> ShardedSearchServer::Broadcast(Request request) const {
+	std::vector<Result> results(shards_.size());
+	std::vector<std::exception_ptr> errors(shards_.size());
+	std::vector<size_t> indexes(shards_.size());
+	for (size_t i = 0; i < indexes.size(); ++i) {
+		indexes[i] = i;
+	}
+	//исключение внутри параллельного алгоритма вызывает std::terminate, поэтому ловим его сами
+	std::for_each(std::execution::par, indexes.begin(), indexes.end(),
+		[&](size_t index) {
+			try {
+				results[index] = request(*shards_[index]);
+			} catch (...) {
+				errors[index] = std::current_exception();
+			}
+		});
+	for (const std::exception_ptr& error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+	return results;
+}
+
+template<typename Predic>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query, Predic predic) const {
+	const CorpusStatistics corpus_statistics = GetQueryStatistics(raw_query);
+	const ShardPredicate shard_predic = predic;
+	return MergeTopDocuments(Broadcast<std::vector<Document>>(
+		[&](const SearchShard& shard) { return shard.FindTopDocuments(raw_query, shard_predic, corpus_statistics); }));
+}
@@ -0,0 +1,152 @@
+#include "term_dictionary.h"
+#include "memory_stats.h"
+
+#include <algorithm>
+
+size_t TermDictionary::Size() const {
+	return size_;
+}
+
+std::string TermDictionary::GetTerm(size_t id) const {
+	std::string term;
+	const size_t block = id / BLOCK_SIZE;
+	const uint8_t* data = bytes_.data() + block_offsets_[block];
+	for (size_t i = block * BLOCK_SIZE; i <= id; ++i) {
+		data = ReadNext(data, i % BLOCK_SIZE == 0, term);
+	}
+	return term;
+}
+
+size_t TermDictionary::LowerBound(std::string_view word) const {
+	//первый блок, первый термин которого не меньше word; искомый термин в предыдущем блоке или в начале этого
+	size_t low = 0;
+	size_t high = block_offsets_.size();
+	while (low < high) {
+		const size_t middle = low + (high - low) / 2;
+		if (GetBlockHead(middle) < word) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if (low == 0) {
+		return 0;
+	}
+	const size_t block = low - 1;
+	std::string term;
+	const uint8_t* data = bytes_.data() + block_offsets_[block];
+	size_t id = block * BLOCK_SIZE;
+	const size_t block_end = std::min(size_, id + BLOCK_SIZE);
+	for (; id < block_end; ++id) {
+		data = ReadNext(data, id % BLOCK_SIZE == 0, term);
+		if (term >= word) {
+			return id;
+		}
+	}
+	return id;
+}
+
+std::vector<std::pair<std::string, int>> TermDictionary::FindWithinDistance(std::string_view word, int max_distance,
+	size_t limit) const {
+	std::vector<std::pair<std::string, int>> result;
+	//rows[d][j] - расстояние между первыми d символами row_term и первыми j символами word
+	std::vector<std::vector<int>> rows(1, std::vector<int>(word.size() + 1));
+	for (size_t j = 0; j <= word.size(); ++j) {
+		rows[0][j] = static_cast<int>(j);
+	}
+	std::string row_term;
+	std::string term;
+	size_t id = 0;
+	const uint8_t* data = bytes_.data();
+	while (id < size_ && result.size() < limit) {
+		data = ReadNext(data, id % BLOCK_SIZE == 0, term);
+		const size_t shared = std::mismatch(term.begin(), term.end(), row_term.begin(), row_term.end()).first - term.begin();
+		rows.resize(shared + 1);
+		row_term.assign(term, 0, shared);
+		size_t pruned_depth = 0;
+		for (size_t depth = shared + 1; depth <= term.size(); ++depth) {
+			const std::vector<int>& previous = rows.back();
+			std::vector<int> row(word.size() + 1);
+			row[0] = static_cast<int>(depth);
+			int row_min = row[0];
+			for (size_t j = 1; j <= word.size(); ++j) {
+				row[j] = std::min({ previous[j] + 1, row[j - 1] + 1,
+					previous[j - 1] + (term[depth - 1] == word[j - 1] ? 0 : 1) });
+				row_min = std::min(row_min, row[j]);
+			}
+			rows.push_back(std::move(row));
+			row_term.push_back(term[depth - 1]);
+			if (row_min > max_distance) {
+				pruned_depth = depth;
+				break;
+			}
+		}
+		if (pruned_depth == 0) {
+			if (rows.back()[word.size()] <= max_distance) {
+				result.emplace_back(term, rows.back()[word.size()]);
+			}
+			++id;
+			continue;
+		}
+		//ни одно продолжение префикса не подойдет: переходим к первому термину после всех терминов с ним
+		std::string next_prefix = term.substr(0, pruned_depth);
+		while (!next_prefix.empty() && static_cast<unsigned char>(next_prefix.back()) == 0xFF) {
+			next_prefix.pop_back();
+		}
+		if (next_prefix.empty()) {
+			break;
+		}
+		next_prefix.back() = static_cast<char>(static_cast<unsigned char>(next_prefix.back()) + 1);
+		id = LowerBound(next_prefix);
+		if (id < size_) {
+			data = Seek(id, term);
+		}
+	}
+	return result;
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+	return sizeof(*this) + GetHeapSize(bytes_) + GetHeapSize(block_offsets_);
+}
+
+void TermDictionary::Append(std::string_view term, std::string_view previous) {
+	if (size_ % BLOCK_SIZE == 0) {
+		block_offsets_.push_back(static_cast<uint32_t>(bytes_.size()));
+		AppendVarint(bytes_, static_cast<uint32_t>(term.size()));
+	} else {
+		const auto [term_it, previous_it] = std::mismatch(term.begin(), term.end(), previous.begin(), previous.end());
+		const size_t shared = term_it - term.begin();
+		AppendVarint(bytes_, static_cast<uint32_t>(shared));
+		AppendVarint(bytes_, static_cast<uint32_t>(term.size() - shared));
+		term.remove_prefix(shared);
+	}
+	bytes_.insert(bytes_.end(), term.begin(), term.end());
+	++size_;
+}
+
+std::string_view TermDictionary::GetBlockHead(size_t block) const {
+	uint32_t length;
+	const uint8_t* data = ReadVarint(bytes_.data() + block_offsets_[block], length);
+	return { reinterpret_cast<const char*>(data), length };
+}
+
+const uint8_t* TermDictionary::ReadNext(const uint8_t* data, bool is_head, std::string& term) const {
+	uint32_t shared = 0;
+	uint32_t length;
+	if (!is_head) {
+		data = ReadVarint(data, shared);
+	}
+	data = ReadVarint(data, length);
+	term.resize(shared);
+	term.append(reinterpret_cast<const char*>(data), length);
+	return data + length;
+}
+
+const uint8_t* TermDictionary::Seek(size_t id, std::string& term) const {
+	const size_t block = id / BLOCK_SIZE;
+	const uint8_t* data = bytes_.data() + block_offsets_[block];
+	for (size_t i = block * BLOCK_SIZE; i < id; ++i) {
+		data = ReadNext(data, i % BLOCK_SIZE == 0, term);
+	}
+	return data;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "varint.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//Компактный отсортированный словарь с front coding: термины хранятся блоками по BLOCK_SIZE,
+//первый термин блока целиком, остальные - длиной общего с предыдущим префикса и остатком.
+//Номер термина - его позиция в отсортированном порядке
+class TermDictionary {
+public:
+	static constexpr size_t BLOCK_SIZE = 16;
+
+	TermDictionary() = default;
+
+	//термины должны идти по возрастанию и не повторяться
+	template <typename Iterator>
+	TermDictionary(Iterator begin, Iterator end);
+
+	size_t Size() const;
+
+	std::string GetTerm(size_t id) const;
+
+	//номер первого термина, не меньшего word (Size(), если такого нет)
+	size_t LowerBound(std::string_view word) const;
+
+	//перебор терминов с префиксом prefix по возрастанию, не более limit штук;
+	//callback получает номер и термин, string_view действителен только во время вызова
+	template <typename Callback>
+	void ForEachWithPrefix(std::string_view prefix, size_t limit, Callback callback) const;
+
+	//термины на расстоянии Левенштейна не больше max_distance от word с этими расстояниями, не более limit штук.
+	//Словарь обходится как бор: строки таблицы расстояний для общего префикса соседних терминов
+	//переиспользуются, а все термины с префиксом, для которого расстояние уже больше max_distance, пропускаются
+	std::vector<std::pair<std::string, int>> FindWithinDistance(std::string_view word, int max_distance, size_t limit) const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	std::vector<uint8_t> bytes_;
+	std::vector<uint32_t> block_offsets_;
+	size_t size_ = 0;
+
+	void Append(std::string_view term, std::string_view previous);
+
+	std::string_view GetBlockHead(size_t block) const;
+
+	//чтение следующего термина блока в term по указателю data, возвращает указатель на следующий термин
+	const uint8_t* ReadNext(const uint8_t* data, bool is_head, std::string& term) const;
+
+	//указатель на термин с номером id; в term остается предыдущий термин, нужный для его чтения
+	const uint8_t* Seek(size_t id, std::string& term) const;
+};
+
+template <typename Iterator>
+TermDictionary::TermDictionary(Iterator begin, Iterator end) {
+	std::string_view previous;
+	for (; begin != end; ++begin) {
+		const std::string_view term = *begin;
+		Append(term, previous);
+		previous = term;
+	}
+}
+
+template <typename Callback>
+void TermDictionary::ForEachWithPrefix(std::string_view prefix, size_t limit, Callback callback) const {
+	size_t id = LowerBound(prefix);
+	if (id == size_) {
+		return;
+	}
+	//сначала пропускаем термины блока до найденного, затем читаем подряд через границы блоков
+	std::string term;
+	size_t block = id / BLOCK_SIZE;
+	const uint8_t* data = bytes_.data() + block_offsets_[block];
+	for (size_t i = block * BLOCK_SIZE; i < id; ++i) {
+		data = ReadNext(data, i % BLOCK_SIZE == 0, term);
+	}
+	for (size_t found = 0; id < size_ && found < limit; ++id, ++found) {
+		data = ReadNext(data, id % BLOCK_SIZE == 0, term);
+		if (term.compare(0, prefix.size(), prefix) != 0) {
+			return;
+		}
+		callback(id, std::string_view{ term });
+	}
+}
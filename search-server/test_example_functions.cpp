@@ -443,4 +443,1701 @@ void TestFindTopDocsPar() {
 		assert(ss.str() == ss1.str());
 	}
 	cout << "TestFindTopDocsPar OK"s << endl;
-}
\ No newline at end of file
+}
+void TestScoringKernels() {
+	using namespace std;
+	mt19937 generator;
+	vector<int> slots;
+	vector<int> word_counts;
+	for (int slot = 0; slot < 1000; slot += uniform_int_distribution<int>(1, 5)(generator)) {
+		slots.push_back(slot);
+		word_counts.push_back(uniform_int_distribution<int>(1, 6)(generator));
+	}
+	vector<double> norms(1000);
+	for (double& norm : norms) {
+		norm = uniform_int_distribution<int>(1, 50)(generator);
+	}
+	// все длины, чтобы пройти и по векторным блокам, и по хвосту
+	for (const PostingWeightForm& form : { TfIdfScorer().GetPostingWeightForm(0), Bm25Scorer().GetPostingWeightForm(4.5) }) {
+		for (size_t count = 0; count <= 40; ++count) {
+			vector<double> expected(1000, -0.0);
+			vector<double> actual(1000, -0.0);
+			vector<double> prefetched(1000, -0.0);
+			// вариант с упреждающей загрузкой, выбираемый для большого индекса
+			const AccumulateTermRelevanceKernel prefetching_kernel = GetScoringKernel(PREFETCH_MIN_DOCUMENTS);
+			// два слова подряд: второе прибавляется к ненулевому аккумулятору
+			for (const double idf : { 0.75, 1.3 }) {
+				AccumulateTermRelevancePortable(slots.data(), word_counts.data(), count, norms.data(), form, idf, expected.data());
+				AccumulateTermRelevance(slots.data(), word_counts.data(), count, norms.data(), form, idf, actual.data());
+				prefetching_kernel(slots.data(), word_counts.data(), count, norms.data(), form, idf, prefetched.data());
+			}
+			assert(memcmp(expected.data(), actual.data(), expected.size() * sizeof(double)) == 0);
+			assert(memcmp(expected.data(), prefetched.data(), expected.size() * sizeof(double)) == 0);
+		}
+	}
+	// TF - число вхождений, деленное на длину, и стоит одно деление при любом числе вхождений
+	assert(TfIdfScorer().PostingWeight(3, 7, 0) == 3.0 / 7);
+	assert(TfIdfScorer().PostingWeight(1'000'000'000, 2'000'000'000, 0) == 0.5);
+	{
+		// релевантность и частота слова - точное частное, как в формуле TF-IDF, а не сумма 1/длина
+		SearchServer tf_server(""s);
+		tf_server.AddDocument(0, "cat cat cat dog rat pet fur"s, DocumentStatus::ACTUAL, { 1 });
+		tf_server.AddDocument(1, "dog"s, DocumentStatus::ACTUAL, { 1 });
+		assert(tf_server.FindTopDocuments("cat"s).front().relevance == 3.0 / 7 * log(2.0));
+		const map<string_view, double> freqs = tf_server.GetWordFrequencies(0);
+		assert(freqs.at("cat"sv) == 3.0 / 7);
+	}
+	{
+		// одно слово с большим числом повторов в векторном блоке
+		vector<int> block_slots{ 0, 1, 2, 3, 4, 5, 6, 7 };
+		vector<int> block_counts{ 1, 1, 1, 1'000'000'000, 1, 1, 1, 1 };
+		vector<double> block_norms(8, 2.0);
+		vector<double> block_accumulator(8, -0.0);
+		AccumulateTermRelevance(block_slots.data(), block_counts.data(), 8, block_norms.data(),
+			TfIdfScorer().GetPostingWeightForm(0), 1.0, block_accumulator.data());
+		assert(block_accumulator[3] == 500'000'000.0 && block_accumulator[0] == 0.5);
+	}
+
+	SearchServer search_server("and with"s);
+	int id = 0;
+	for (
+		const string& text : {
+			"white cat and yellow hat"s,
+			"curly cat curly tail"s,
+			"nasty dog with big eyes"s,
+			"nasty pigeon john"s,
+			"cat dog pigeon"s,
+		}
+		) {
+		search_server.AddDocument(++id, text, DocumentStatus::ACTUAL, { id });
+	}
+	const auto seq_docs = search_server.FindTopDocuments(execution::seq, "curly nasty cat -john"s);
+	const auto par_docs = search_server.FindTopDocuments(execution::par, "curly nasty cat -john"s);
+	assert(seq_docs.size() == 4 && par_docs.size() == seq_docs.size());
+	for (size_t i = 0; i < seq_docs.size(); ++i) {
+		assert(seq_docs[i].id == par_docs[i].id && seq_docs[i].relevance == par_docs[i].relevance);
+	}
+	cout << "TestScoringKernels OK ("s << GetScoringKernelName() << ")"s << endl;
+}
+
+void TestBm25Scorer() {
+	using namespace std;
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 2 });
+	search_server.AddDocument(3, "nasty dog with big eyes"s, DocumentStatus::ACTUAL, { 3 });
+	const auto tf_idf_docs = search_server.FindTopDocuments("curly cat"s);
+
+	search_server.SetScorer(make_shared<Bm25Scorer>(1.2, 0.75));
+	const double average_length = (4 + 4 + 4) / 3.0;
+	const auto weight = [average_length](int count, int length) {
+		return count * 2.2 / (count + 1.2 * (0.25 + 0.75 * length / average_length));
+	};
+	const double idf_curly = log(1.0 + (3 - 1 + 0.5) / (1 + 0.5));
+	const double idf_cat = log(1.0 + (3 - 2 + 0.5) / (2 + 0.5));
+	const auto docs = search_server.FindTopDocuments("curly cat"s);
+	assert(docs.size() == 2);
+	assert(docs[0].id == 2 && abs(docs[0].relevance - (idf_curly * weight(2, 4) + idf_cat * weight(1, 4))) < RELEVANCE_TRESHOLD);
+	assert(docs[1].id == 1 && abs(docs[1].relevance - idf_cat * weight(1, 4)) < RELEVANCE_TRESHOLD);
+
+	// возврат к TF-IDF дает прежние баллы
+	search_server.SetScorer(make_shared<TfIdfScorer>());
+	const auto restored_docs = search_server.FindTopDocuments("curly cat"s);
+	assert(restored_docs.size() == tf_idf_docs.size());
+	for (size_t i = 0; i < restored_docs.size(); ++i) {
+		assert(restored_docs[i].id == tf_idf_docs[i].id && restored_docs[i].relevance == tf_idf_docs[i].relevance);
+	}
+
+	// средняя длина берется из текущего корпуса: модель, заданная на пустом сервере или до добавления
+	// части документов, дает те же баллы, что и заданная после
+	{
+		const vector<string> texts = { "curly cat"s, "curly dog with long curly tail and big eyes"s, "cat and dog"s };
+		SearchServer early("and with"s);
+		early.SetScorer(make_shared<Bm25Scorer>(1.2, 0.75));
+		SearchServer late("and with"s);
+		for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+			early.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+			late.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+		}
+		late.SetScorer(make_shared<Bm25Scorer>(1.2, 0.75));
+		const auto early_docs = early.FindTopDocuments("curly"s);
+		const auto late_docs = late.FindTopDocuments("curly"s);
+		assert(early_docs.size() == 2 && late_docs.size() == 2);
+		// длины 2 и 7 при средней 11 / 3: длинный документ с двумя вхождениями штрафуется за длину
+		const double average = 11 / 3.0;
+		const double idf = log(1.0 + (3 - 2 + 0.5) / (2 + 0.5));
+		const auto bm25 = [average, idf](int count, int length) {
+			return idf * count * 2.2 / (count + 1.2 * (0.25 + 0.75 * length / average));
+		};
+		for (size_t i = 0; i < early_docs.size(); ++i) {
+			assert(early_docs[i].id == late_docs[i].id && early_docs[i].relevance == late_docs[i].relevance);
+			const double expected = early_docs[i].id == 0 ? bm25(1, 2) : bm25(2, 7);
+			assert(abs(early_docs[i].relevance - expected) < RELEVANCE_TRESHOLD);
+		}
+		// удаление документа меняет среднюю длину и для оставшихся
+		early.RemoveDocument(2);
+		late.RemoveDocument(2);
+		SearchServer rebuilt("and with"s);
+		rebuilt.AddDocument(0, texts[0], DocumentStatus::ACTUAL, { 0 });
+		rebuilt.AddDocument(1, texts[1], DocumentStatus::ACTUAL, { 1 });
+		rebuilt.SetScorer(make_shared<Bm25Scorer>(1.2, 0.75));
+		const auto rebuilt_docs = rebuilt.FindTopDocuments("curly"s);
+		const auto removed_docs = early.FindTopDocuments("curly"s);
+		assert(rebuilt_docs.size() == removed_docs.size());
+		for (size_t i = 0; i < rebuilt_docs.size(); ++i) {
+			assert(rebuilt_docs[i].id == removed_docs[i].id && rebuilt_docs[i].relevance == removed_docs[i].relevance);
+		}
+		// статистика частей корпуса несет суммарную длину для общей средней
+		const CorpusStatistics statistics = early.GetQueryStatistics("curly"s);
+		assert(statistics.document_count == 2 && statistics.total_document_length == 2 + 7);
+	}
+	// несогласованная статистика (документов со словом больше, чем документов) не переполняет разность
+	const double inconsistent_weight = Bm25Scorer().TermWeight(3, 5);
+	assert(inconsistent_weight > 0 && inconsistent_weight < 1);
+	cout << "TestBm25Scorer OK"s << endl;
+}
+
+void TestPhraseQueries() {
+	using namespace std;
+	SearchServer search_server("and with"s);
+	search_server.EnablePositionalIndex();
+	search_server.AddDocument(1, "curly cat and curly tail"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "cat with curly tail"s, DocumentStatus::ACTUAL, { 2 });
+	search_server.AddDocument(3, "tail of curly cat"s, DocumentStatus::ACTUAL, { 3 });
+	search_server.AddDocument(4, "big dog"s, DocumentStatus::ACTUAL, { 4 });
+
+	{	// стоп-слова не разрывают фразу: в документе 1 "curly cat and curly tail" -> curly cat curly tail
+		const auto docs = search_server.FindTopDocuments("\"curly cat\""s);
+		assert(docs.size() == 2 && docs[0].id != docs[1].id);
+		assert((docs[0].id == 1 || docs[0].id == 3) && (docs[1].id == 1 || docs[1].id == 3));
+	}
+	{
+		const auto docs = search_server.FindTopDocuments(execution::par, "\"cat curly tail\" -dog"s);
+		assert(docs.size() == 2);
+	}
+	{
+		const auto docs = search_server.FindTopDocuments("dog \"tail of curly\""s);
+		assert(docs.size() == 1 && docs[0].id == 3);
+	}
+	{
+		const auto [words, status] = search_server.MatchDocument("\"curly cat\" tail"s, 2);
+		assert(words.empty());
+		const auto [words3, status3] = search_server.MatchDocument(execution::par, "\"curly cat\" tail"s, 3);
+		assert(words3.size() == 3);
+	}
+	{
+		bool is_thrown = false;
+		try {
+			search_server.FindTopDocuments("\"curly cat"s);
+		} catch (const invalid_argument&) {
+			is_thrown = true;
+		}
+		assert(is_thrown);
+	}
+
+	// удаление документа сдвигает позиции остальных в потоке байтов
+	search_server.RemoveDocument(1);
+	assert(search_server.FindTopDocuments("\"curly cat\""s).size() == 1);
+	assert(search_server.FindTopDocuments("\"curly tail\""s).size() == 1);
+
+	// близкие слова получают добавку
+	const auto plain = search_server.FindTopDocuments("cat tail"s);
+	search_server.SetProximityBoost(1.0);
+	const auto boosted = search_server.FindTopDocuments("cat tail"s);
+	assert(plain.size() == 2 && boosted.size() == 2);
+	for (const Document& document : boosted) {
+		const auto it = find_if(plain.begin(), plain.end(), [&document](const Document& d) { return d.id == document.id; });
+		const double distance = document.id == 2 ? 2.0 : 3.0;
+		assert(abs(document.relevance - it->relevance - 1.0 / distance) < RELEVANCE_TRESHOLD);
+	}
+	assert(search_server.GetPositionalIndexMemoryUsage() > 0);
+	assert(SearchServer(""s).GetPositionalIndexMemoryUsage() == 0);
+	cout << "TestPhraseQueries OK"s << endl;
+}
+
+void TestPrefixQueries() {
+	using namespace std;
+	{
+		vector<string> terms;
+		for (int i = 0; i < 100; ++i) {
+			terms.push_back("term"s + to_string(1000 + i * 7));
+		}
+		terms.push_back("zebra"s);
+		const TermDictionary dictionary(terms.begin(), terms.end());
+		assert(dictionary.Size() == terms.size());
+		for (size_t i = 0; i < terms.size(); ++i) {
+			assert(dictionary.GetTerm(i) == terms[i]);
+			assert(dictionary.LowerBound(terms[i]) == i);
+		}
+		assert(dictionary.LowerBound("a"s) == 0);
+		assert(dictionary.LowerBound("zz"s) == terms.size());
+		vector<string> found;
+		dictionary.ForEachWithPrefix("term10"s, 100, [&found](size_t id, string_view term) { found.push_back(string{ term }); });
+		assert(found.size() == 15 && found.front() == "term1000"s && found.back() == "term1098"s);
+		found.clear();
+		dictionary.ForEachWithPrefix("term1"s, 3, [&found](size_t id, string_view term) { found.push_back(string{ term }); });
+		assert(found.size() == 3);
+	}
+
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "connect the cables"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "connection lost"s, DocumentStatus::ACTUAL, { 2 });
+	search_server.AddDocument(3, "connected devices and cables"s, DocumentStatus::ACTUAL, { 3 });
+	search_server.AddDocument(4, "cone of silence"s, DocumentStatus::ACTUAL, { 4 });
+
+	assert(search_server.FindTopDocuments("connect*"s).size() == 3);
+	assert(search_server.FindTopDocuments(execution::par, "connect* -cable*"s).size() == 1);
+	assert(search_server.FindTopDocuments("con*"s).size() == 4);
+	{
+		const auto [words, status] = search_server.MatchDocument("connect* lost"s, 2);
+		assert(words.size() == 2);
+	}
+	// слова удаленного документа больше не раскрываются
+	search_server.RemoveDocument(2);
+	{
+		const auto [words, status] = search_server.MatchDocument("connect*"s, 3);
+		assert(words.size() == 1 && words[0] == "connected"sv);
+	}
+	search_server.SetPrefixExpansionLimit(1);
+	{
+		const auto docs = search_server.FindTopDocuments("connect*"s);
+		assert(docs.size() == 1 && docs[0].id == 1);
+	}
+	cout << "TestPrefixQueries OK"s << endl;
+}
+
+void TestFuzzyMatching() {
+	using namespace std;
+	const auto levenshtein = [](const string& lhs, const string& rhs) {
+		vector<vector<int>> d(lhs.size() + 1, vector<int>(rhs.size() + 1));
+		for (size_t i = 0; i <= lhs.size(); ++i) {
+			for (size_t j = 0; j <= rhs.size(); ++j) {
+				d[i][j] = i == 0 ? static_cast<int>(j) : j == 0 ? static_cast<int>(i) :
+					min({ d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + (lhs[i - 1] == rhs[j - 1] ? 0 : 1) });
+			}
+		}
+		return d[lhs.size()][rhs.size()];
+	};
+	{	// сравнение с полным перебором на случайном словаре
+		mt19937 generator;
+		set<string> unique_terms;
+		for (int i = 0; i < 2000; ++i) {
+			string term;
+			for (int length = uniform_int_distribution<int>(1, 6)(generator); length > 0; --length) {
+				term.push_back(uniform_int_distribution<int>('a', 'e')(generator));
+			}
+			unique_terms.insert(term);
+		}
+		const TermDictionary dictionary(unique_terms.begin(), unique_terms.end());
+		for (const string& word : { "abc"s, "eeee"s, "a"s, "bacde"s, "zzz"s }) {
+			for (int distance = 1; distance <= 2; ++distance) {
+				vector<pair<string, int>> expected;
+				for (const string& term : unique_terms) {
+					const int term_distance = levenshtein(term, word);
+					if (term_distance <= distance) {
+						expected.emplace_back(term, term_distance);
+					}
+				}
+				assert(dictionary.FindWithinDistance(word, distance, unique_terms.size()) == expected);
+			}
+		}
+	}
+
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 2 });
+	search_server.AddDocument(3, "nasty dog with big eyes"s, DocumentStatus::ACTUAL, { 3 });
+
+	assert(search_server.FindTopDocuments("curyl dgo"s).empty());
+	search_server.SetFuzzyMatching(1);
+	// "dgo" дальше 1 от "dog" (перестановка - это две замены)
+	assert(search_server.FindTopDocuments("curyl dgo"s).empty());
+	assert(search_server.FindTopDocuments("yelow"s).size() == 1);
+	search_server.SetFuzzyMatching(2);
+	{
+		const auto docs = search_server.FindTopDocuments("curyl dgo"s);
+		assert(docs.size() == 2 && docs[0].id == 2 && docs[1].id == 3);
+	}
+	{	// найдены cat и hat на расстоянии 1, более далекие слова не подмешиваются
+		const auto [words, status] = search_server.MatchDocument("bat"s, 1);
+		assert(words.size() == 2);
+	}
+	cout << "TestFuzzyMatching OK"s << endl;
+}
+
+void TestForwardIndex() {
+	using namespace std;
+	for (const bool is_enabled : { true, false }) {
+		SearchServer search_server("and with"s);
+		search_server.SetForwardIndexEnabled(is_enabled);
+		search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 1 });
+		search_server.AddDocument(2, "nasty dog with big eyes"s, DocumentStatus::ACTUAL, { 2 });
+		search_server.AddDocument(3, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 3 });
+		{
+			const map<string_view, double> word_freqs = search_server.GetWordFrequencies(1);
+			assert(word_freqs.size() == 3 && word_freqs.at("curly"sv) == 2. / 4 && word_freqs.at("tail"sv) == 1. / 4);
+		}
+		{
+			const auto [words, status] = search_server.MatchDocument("nasty cat rat"s, 3);
+			assert(words.size() == 2 && words[0] == "nasty"sv && words[1] == "rat"sv);
+		}
+		search_server.RemoveDocument(2);
+		search_server.RemoveDocument(execution::par, 3);
+		assert(search_server.FindTopDocuments("nasty"s).empty());
+		assert(search_server.GetWordFrequencies(3).empty());
+		// переключение режима восстанавливает прямой индекс по спискам вхождений
+		search_server.SetForwardIndexEnabled(!is_enabled);
+		assert(search_server.GetWordFrequencies(1).size() == 3);
+		search_server.AddDocument(4, "curly dog"s, DocumentStatus::ACTUAL, { 4 });
+		assert(search_server.GetWordFrequencies(4).size() == 2);
+	}
+	cout << "TestForwardIndex OK"s << endl;
+}
+
+void TestRemoveDuplicates() {
+	using namespace std;
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+	search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+	// дубликат документа 2, будет удален
+	search_server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+	// отличие только в стоп-словах, считаем дубликатом
+	search_server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+	// множество слов такое же, считаем дубликатом документа 1
+	search_server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+	// добавились новые слова, дубликатом не является
+	search_server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+	// множество слов такое же, как в id 6, несмотря на другой порядок, считаем дубликатом
+	search_server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, { 1, 2 });
+	// есть не все слова, не является дубликатом
+	search_server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+	// слова из разных документов, не является дубликатом
+	search_server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+
+	assert(FindNearDuplicates(search_server, 1.0) == vector<int>({ 3, 4, 5, 7 }));
+	// у документов 6 и 1 четыре общих слова из шести: сходство 2/3
+	assert(FindNearDuplicates(search_server, 0.6) == vector<int>({ 3, 4, 5, 6, 7 }));
+	assert(RemoveDuplicates(search_server) == vector<int>({ 3, 4, 5, 7 }));
+	assert(search_server.GetDocumentCount() == 5);
+	assert(RemoveDuplicates(search_server).empty());
+	cout << "TestRemoveDuplicates OK"s << endl;
+}
+
+void TestMatchDocuments() {
+	using namespace std;
+	SearchServer search_server("and with"s);
+	int id = 1;
+	for (
+		const string& text : {
+			"funny pet and nasty rat"s,
+			"funny pet with curly hair"s,
+			"funny curly pet and not very nasty rat"s,
+			"curly and funny pet curly with rat and rat and rat"s,
+			"nasty rat with curly hair"s,
+		}
+		) {
+		search_server.AddDocument(id, text, DocumentStatus::ACTUAL, { 1, 2 });
+		++id;
+	}
+	const string query = "curly and funny -not rat"s;
+	const vector<int> ids = { 5, 4, 3, 2, 1 };
+	const auto seq_results = search_server.MatchDocuments(query, ids);
+	const auto par_results = search_server.MatchDocuments(execution::par, query, ids);
+	assert(seq_results.size() == ids.size() && par_results == seq_results);
+	for (size_t i = 0; i < ids.size(); ++i) {
+		assert(seq_results[i] == search_server.MatchDocument(query, ids[i]));
+	}
+	assert(get<0>(seq_results[0]) == vector<string_view>({ "curly"sv, "rat"sv }));
+	assert(get<0>(seq_results[2]).empty());
+	// запрос без найденных плюс-слов
+	{
+		const auto [words, status] = search_server.MatchDocument(execution::par, "dog -cat"s, 1);
+		assert(words.empty());
+	}
+	bool is_thrown = false;
+	try {
+		search_server.MatchDocuments(query, { 1, 42 });
+	} catch (const out_of_range&) {
+		is_thrown = true;
+	}
+	assert(is_thrown);
+	cout << "TestMatchDocuments OK"s << endl;
+}
+
+void TestShardedSearchServer() {
+	using namespace std;
+	const vector<string> texts = {
+		"funny pet and nasty rat"s,
+		"funny pet with curly hair"s,
+		"funny curly pet and not very nasty rat"s,
+		"curly and funny pet curly with rat and rat and rat"s,
+		"nasty rat with curly hair"s,
+		"big cat fancy collar"s,
+		"big dog sparrow eugene"s,
+		"curly dog and fancy collar"s,
+	};
+	// префиксы и нечеткий поиск раскрываются по словарю всех частей: "c*" - первые два слова из трех,
+	// "cat" есть только в одной части, а в остальных ближе всего "rat"
+	const vector<string> queries = { "curly nasty -not rat"s, "funny pet"s, "fancy dog"s, "big -cat"s, "hamster"s,
+		"c* -f*"s, "pet c*"s, "cat"s, "rot dug"s };
+	const auto configure = [](SearchServer& server) {
+		server.SetPrefixExpansionLimit(2);
+		server.SetFuzzyMatching(1);
+	};
+	SearchServer search_server("and with"s);
+	configure(search_server);
+	ShardedSearchServer sharded_server(3, "and with"sv);
+	for (size_t i = 0; i < sharded_server.GetShardCount(); ++i) {
+		configure(dynamic_cast<LocalShard&>(sharded_server.GetShard(i)).GetServer());
+	}
+	for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+		const DocumentStatus status = id % 4 == 3 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+		search_server.AddDocument(id, texts[id], status, { id });
+		sharded_server.AddDocument(id, texts[id], status, { id });
+	}
+	assert(sharded_server.GetDocumentCount() == texts.size());
+	// релевантность по общей статистике совпадает с одним сервером побитово
+	const auto check_same = [&](const ShardedSearchServer& server) {
+		for (const string& query : queries) {
+			const auto expected = search_server.FindTopDocuments(query);
+			const auto found = server.FindTopDocuments(query);
+			assert(found.size() == expected.size());
+			for (size_t i = 0; i < found.size(); ++i) {
+				assert(found[i].id == expected[i].id && found[i].relevance == expected[i].relevance
+					&& found[i].rating == expected[i].rating);
+			}
+			assert(server.FindTopDocuments(query, DocumentStatus::BANNED).size()
+				== search_server.FindTopDocuments(query, DocumentStatus::BANNED).size());
+		}
+	};
+	check_same(sharded_server);
+	{
+		const auto found = sharded_server.FindTopDocuments("curly"s,
+			[](int document_id, DocumentStatus status, int rating) { return document_id % 2 == 0; });
+		assert(found.size() == 2 && found[0].id % 2 == 0 && found[1].id % 2 == 0);
+	}
+	search_server.RemoveDocument(4);
+	sharded_server.RemoveDocument(4);
+	check_same(sharded_server);
+	bool is_thrown = false;
+	try {
+		sharded_server.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, {});
+	} catch (const invalid_argument&) {
+		is_thrown = true;
+	}
+	assert(is_thrown);
+	is_thrown = false;
+	try {
+		sharded_server.FindTopDocuments("rat --cat"s);
+	} catch (const invalid_argument&) {
+		is_thrown = true;
+	}
+	assert(is_thrown);
+	// части в отдельных процессах через Unix-сокеты
+	const size_t shard_count = 2;
+	vector<string> socket_paths;
+	vector<pid_t> children;
+	for (size_t i = 0; i < shard_count; ++i) {
+		socket_paths.push_back("/tmp/search_shard_"s + to_string(getpid()) + "_"s + to_string(i) + ".sock"s);
+		const pid_t pid = fork();
+		assert(pid >= 0);
+		if (pid == 0) {
+			SearchServer shard("and with"s);
+			configure(shard);
+			ServeShard(shard, socket_paths.back());
+			_exit(0);
+		}
+		children.push_back(pid);
+	}
+	vector<RemoteShard*> remote_shards;
+	vector<unique_ptr<SearchShard>> shards;
+	for (const string& socket_path : socket_paths) {
+		auto shard = make_unique<RemoteShard>(socket_path);
+		remote_shards.push_back(shard.get());
+		shards.push_back(move(shard));
+	}
+	ShardedSearchServer remote_server(move(shards));
+	for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+		if (id != 4) {
+			remote_server.AddDocument(id, texts[id], id % 4 == 3 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, { id });
+		}
+	}
+	assert(remote_server.GetDocumentCount() == search_server.GetDocumentCount());
+	check_same(remote_server);
+	is_thrown = false;
+	try {
+		remote_server.FindTopDocuments("rat -"s);
+	} catch (const invalid_argument&) {
+		is_thrown = true;
+	}
+	assert(is_thrown);
+	for (RemoteShard* shard : remote_shards) {
+		shard->Shutdown();
+	}
+	for (const pid_t pid : children) {
+		int status = 0;
+		waitpid(pid, &status, 0);
+		assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+	cout << "TestShardedSearchServer OK"s << endl;
+}
+
+void TestNumaSearchServer() {
+	using namespace std;
+	assert(ParseCpuList("0-3,8,10-11\n"s) == vector<int>({ 0, 1, 2, 3, 8, 10, 11 }));
+	const NumaTopology detected = NumaTopology::Detect();
+	assert(detected.GetNodeCount() >= 1 && !detected.IsSimulated());
+	for (const NumaNode& node : detected.GetNodes()) {
+		assert(!node.cpus.empty());
+	}
+	assert(detected.GetCurrentNode() < detected.GetNodeCount());
+	const NumaTopology topology = NumaTopology::Simulate(2);
+	assert(topology.GetNodeCount() == 2 && topology.IsSimulated());
+	assert(!topology.PinCurrentThread(0));
+
+	const vector<string> texts = {
+		"funny pet and nasty rat"s,
+		"funny pet with curly hair"s,
+		"funny curly pet and not very nasty rat"s,
+		"curly and funny pet curly with rat and rat and rat"s,
+		"nasty rat with curly hair"s,
+		"big cat fancy collar"s,
+	};
+	const vector<string> queries = { "curly nasty -not rat"s, "funny pet"s, "fancy cat"s, "hamster"s };
+	SearchServer search_server("and with"s);
+	NumaSearchServer sharded(topology, "and with"sv, NumaPlacement::SHARDED);
+	NumaSearchServer replicated(detected, "and with"sv, NumaPlacement::REPLICATED);
+	NumaSearchServer simulated_replicated(topology, "and with"sv, NumaPlacement::REPLICATED);
+	for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+		search_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+		sharded.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+		replicated.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+		simulated_replicated.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+	}
+	const auto same = [](const vector<Document>& lhs, const vector<Document>& rhs) {
+		if (lhs.size() != rhs.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < lhs.size(); ++i) {
+			if (lhs[i].id != rhs[i].id || lhs[i].relevance != rhs[i].relevance) {
+				return false;
+			}
+		}
+		return true;
+	};
+	for (const NumaSearchServer* server : { &sharded, &replicated, &simulated_replicated }) {
+		assert(server->GetDocumentCount() == texts.size());
+		for (const string& query : queries) {
+			assert(same(server->FindTopDocuments(query), search_server.FindTopDocuments(query)));
+		}
+		const auto lists = ProcessQueries(*server, queries);
+		for (size_t i = 0; i < queries.size(); ++i) {
+			assert(same(lists[i], search_server.FindTopDocuments(queries[i])));
+		}
+	}
+	// части: каждый запрос выполняется на всех узлах
+	for (const NumaNodeStats& stats : sharded.GetNodeStats()) {
+		assert(stats.queries == 2 * queries.size() && stats.queries_per_second > 0);
+	}
+	// смоделированные копии получают запросы по очереди
+	for (const NumaNodeStats& stats : simulated_replicated.GetNodeStats()) {
+		assert(stats.queries == queries.size());
+	}
+	simulated_replicated.ResetNodeStats();
+	assert(simulated_replicated.GetNodeStats()[0].queries == 0);
+	bool is_thrown = false;
+	try {
+		simulated_replicated.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, {});
+	} catch (const invalid_argument&) {
+		is_thrown = true;
+	}
+	assert(is_thrown);
+	simulated_replicated.RemoveDocument(1);
+	search_server.RemoveDocument(1);
+	assert(same(simulated_replicated.FindTopDocuments("funny pet"s), search_server.FindTopDocuments("funny pet"s)));
+	assert(same(simulated_replicated.FindTopDocuments("funny pet"s), search_server.FindTopDocuments("funny pet"s)));
+	cout << "TestNumaSearchServer OK"s << endl;
+}
+
+void TestQueryMetrics() {
+	using namespace std;
+	// корзины гистограммы: упорядочены, и значение не дальше 1/32 от верхней границы своей корзины
+	for (const uint64_t value : { 0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, 1ull << 39 }) {
+		const size_t index = LatencyHistogram::GetBucketIndex(value);
+		const uint64_t upper = LatencyHistogram::GetBucketUpperBound(index);
+		assert(index < LatencyHistogram::BUCKET_COUNT && upper >= value && upper - value <= value / 32);
+		assert(LatencyHistogram::GetBucketIndex(value + 1) >= index);
+	}
+	assert(LatencyHistogram::GetBucketIndex(~0ull) == LatencyHistogram::BUCKET_COUNT - 1);
+	{
+		LatencyHistogram histogram;
+		for (uint64_t value = 1; value <= 1000; ++value) {
+			histogram.Record(value);
+		}
+		assert(histogram.GetCount() == 1000 && histogram.GetSum() == 500500 && histogram.GetMax() == 1000);
+		const uint64_t median = histogram.GetPercentile(50);
+		assert(median >= 500 && median <= 500 + 500 / 32);
+		assert(histogram.GetPercentile(100) == 1000);
+	}
+
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7 });
+	search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(3, "nasty rat with curly hair"s, DocumentStatus::BANNED, { 1 });
+	search_server.FindTopDocuments("curly rat"s);
+	search_server.FindTopDocuments(execution::par, "funny -hair"s);
+	MetricsSnapshot snapshot = search_server.GetMetrics();
+	assert(snapshot.queries == 2);
+	// curly и rat встречаются по 2 раза, funny - 2 раза
+	assert(snapshot.postings_scanned == 6);
+	// документ 3 забанен: найдены 1 и 2 в первом запросе и 1 во втором
+	assert(snapshot.documents_matched == 3);
+	assert(snapshot.GetStage(QueryStage::PARSE).GetCount() == 2);
+	assert(snapshot.GetStage(QueryStage::POSTING_FETCH).GetCount() == 2);
+	assert(snapshot.GetStage(QueryStage::TOP_K).GetCount() == 2);
+	const string text = RenderPrometheus(snapshot);
+	assert(text.find("search_server_queries_total 2\n"s) != string::npos);
+	assert(text.find("search_server_stage_duration_seconds_count{stage=\"scoring\"} 2\n"s) != string::npos);
+	assert(text.find("# TYPE search_server_stage_duration_seconds summary\n"s) != string::npos);
+	// метрики, собранные в других потоках, тоже попадают в снимок
+	thread([&search_server]() { search_server.FindTopDocuments("pet"s); }).join();
+	assert(search_server.GetMetrics().queries == 3);
+	search_server.SetMetricsEnabled(false);
+	search_server.FindTopDocuments("pet"s);
+	assert(search_server.GetMetrics().queries == 3);
+	search_server.SetMetricsEnabled(true);
+	search_server.ResetMetrics();
+	snapshot = search_server.GetMetrics();
+	assert(snapshot.queries == 0 && snapshot.GetStage(QueryStage::SCORING).GetCount() == 0);
+
+	// поток по очереди пишет в метрики больше, чем помещается в его кеш: счетчики, вытесненные
+	// из кеша, находятся снова, и каждый запрос учтен ровно один раз
+	vector<QueryMetrics> shards(20);
+	for (int round = 0; round < 10; ++round) {
+		for (QueryMetrics& metrics : shards) {
+			metrics.Record(QueryStage::PARSE, 100);
+			metrics.AddQuery(1, 1);
+		}
+	}
+	for (const QueryMetrics& metrics : shards) {
+		const MetricsSnapshot shard_snapshot = metrics.GetSnapshot();
+		assert(shard_snapshot.queries == 10 && shard_snapshot.GetStage(QueryStage::PARSE).GetCount() == 10);
+		assert(shard_snapshot.GetStage(QueryStage::PARSE).GetSum() == 1000);
+	}
+	cout << "TestQueryMetrics OK"s << endl;
+}
+
+void TestExplainTopDocuments() {
+	using namespace std;
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7 });
+	search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(3, "nasty rat with curly hair"s, DocumentStatus::BANNED, { 1 });
+	search_server.AddDocument(4, "curly dog"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.SetMetricsEnabled(false);
+	const string query = "curly rat hamster -dog"s;
+	for (const bool is_par : { false, true }) {
+		QueryProfile profile;
+		const auto documents = is_par
+			? search_server.ExplainTopDocuments(execution::par, query, profile)
+			: search_server.ExplainTopDocuments(query, profile);
+		assert(documents.size() == 2 && documents[0].id == 1 && documents[1].id == 2);
+		assert(profile.execution_path == (is_par ? "par"s : "seq"s));
+		assert(!profile.pruning && !profile.cache_hit);
+		assert(profile.terms.size() == 4);
+		// плюс-слова по алфавиту, затем минус-слова
+		assert(profile.terms[0].word == "curly"s && profile.terms[0].posting_list_length == 3);
+		assert(profile.terms[0].inverse_document_freq == log(4.0 / 3));
+		assert(profile.terms[1].word == "hamster"s && profile.terms[1].posting_list_length == 0);
+		assert(profile.terms[2].word == "rat"s && profile.terms[2].postings_scanned == 2);
+		assert(profile.terms[3].is_minus && profile.terms[3].word == "dog"s);
+		// кандидаты: 1, 2, 3, 4; без dog - 1, 2, 3; без забаненного - 1, 2
+		assert(profile.candidates == 4 && profile.candidates_after_minus == 3);
+		assert(profile.candidates_after_predicate == 2 && profile.results == 2);
+		uint64_t total_nanoseconds = 0;
+		for (const uint64_t nanoseconds : profile.stage_nanoseconds) {
+			total_nanoseconds += nanoseconds;
+		}
+		assert(total_nanoseconds > 0);
+		const string text = profile.ToString();
+		assert(text.find("term +curly: postings 3"s) != string::npos);
+		assert(text.find("candidates: 4, after minus filter: 3, after predicate: 2, results: 2"s) != string::npos);
+	}
+	assert(search_server.GetMetrics().queries == 0);
+	cout << "TestExplainTopDocuments OK"s << endl;
+}
+
+void TestAdaptivePolicy() {
+	using namespace std;
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7 });
+	search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(3, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 2 });
+	search_server.AddDocument(4, "curly dog"s, DocumentStatus::ACTUAL, { 3 });
+	// curly + rat: 5 вхождений в двух словах
+	ExecutionPlanner planner;
+	planner.parallel_min_postings = 5;
+	search_server.SetExecutionPlanner(planner);
+	assert(search_server.PlanQuery("curly rat -dog"s) == ExecutionPlan::RANGE_PARALLEL);
+	assert(search_server.PlanQuery("curly pet"s) == ExecutionPlan::RANGE_PARALLEL);
+	assert(search_server.PlanQuery("curly hamster"s) == ExecutionPlan::SEQUENTIAL);
+	assert(search_server.PlanQuery("pet rat"s) == ExecutionPlan::SEQUENTIAL);
+	for (const string& query : { "curly rat -dog"s, "pet rat"s, "funny"s }) {
+		const auto expected = search_server.FindTopDocuments(execution::seq, query);
+		const auto found = search_server.FindTopDocuments(adaptive_policy, query);
+		assert(found.size() == expected.size());
+		for (size_t i = 0; i < found.size(); ++i) {
+			assert(found[i].id == expected[i].id && abs(found[i].relevance - expected[i].relevance) < 1e-12);
+		}
+	}
+	{
+		QueryProfile profile;
+		search_server.ExplainTopDocuments(adaptive_policy, "curly rat"s, profile);
+		assert(profile.adaptive && profile.execution_path == "par"s);
+		search_server.ExplainTopDocuments(adaptive_policy, "curly"s, profile);
+		assert(profile.adaptive && profile.execution_path == "seq"s);
+	}
+	// по умолчанию порог фиксирован, первый запрос не запускает замер
+	const ExecutionPlanner default_planner = ExecutionPlanner::GetDefault();
+	assert(default_planner.parallel_min_postings == (thread::hardware_concurrency() < 2
+		? numeric_limits<size_t>::max() : DEFAULT_PARALLEL_MIN_POSTINGS));
+	{
+		SearchServer fresh_server(""s);
+		for (int id = 0; id < 100; ++id) {
+			fresh_server.AddDocument(id, "curly cat"s, DocumentStatus::ACTUAL, { id });
+		}
+		assert(fresh_server.PlanQuery("curly cat"s) == default_planner.Choose(2, 200));
+		assert(fresh_server.PlanQuery("curly cat"s) == ExecutionPlan::SEQUENTIAL);
+		assert(fresh_server.FindTopDocuments(adaptive_policy, "curly"s).size() == MAX_RESULT_DOCUMENT_COUNT);
+	}
+	assert(default_planner.Choose(3, DEFAULT_PARALLEL_MIN_POSTINGS) == (thread::hardware_concurrency() < 2
+		? ExecutionPlan::SEQUENTIAL : ExecutionPlan::RANGE_PARALLEL));
+	// замер на машине с одним потоком никогда не выбирает параллельный план
+	const ExecutionPlanner calibrated = ExecutionPlanner::Calibrate();
+	if (thread::hardware_concurrency() < 2) {
+		assert(calibrated.parallel_min_postings == numeric_limits<size_t>::max());
+	}
+	assert(calibrated.Choose(1, 0) == ExecutionPlan::SEQUENTIAL);
+	cout << "TestAdaptivePolicy OK"s << endl;
+}
+
+void TestRangePartitionedSearch() {
+	using namespace std;
+	// объема вхождений хватает на несколько частей, par должен совпасть с seq побитово
+	mt19937 generator(7);
+	const vector<string> words = { "cat"s, "dog"s, "rat"s, "pet"s, "fur"s, "tail"s, "paw"s, "ear"s };
+	SearchServer search_server(""s);
+	search_server.SetBooleanQueriesEnabled(true);
+	for (int id = 0; id < 30000; ++id) {
+		string text;
+		for (int i = 0; i < 6; ++i) {
+			text += words[uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] + " "s;
+		}
+		search_server.AddDocument(id, text, id % 3 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL,
+			{ uniform_int_distribution<int>(-5, 5)(generator) });
+	}
+	// пропуски в плотных номерах
+	for (int id = 0; id < 30000; id += 7) {
+		search_server.RemoveDocument(id);
+	}
+	for (const string& query : { "cat dog rat pet -fur"s, "cat dog rat pet fur tail paw"s, "ear -paw -tail"s }) {
+		QueryProfile seq_profile;
+		QueryProfile par_profile;
+		const auto expected = search_server.ExplainTopDocuments(execution::seq, query, seq_profile);
+		const auto found = search_server.ExplainTopDocuments(execution::par, query, par_profile);
+		// документы с равными релевантностью и рейтингом могут идти в любом порядке
+		assert(found.size() == expected.size());
+		for (size_t i = 0; i < found.size(); ++i) {
+			assert(found[i].relevance == expected[i].relevance && found[i].rating == expected[i].rating);
+		}
+		assert(par_profile.candidates == seq_profile.candidates);
+		assert(par_profile.candidates_after_minus == seq_profile.candidates_after_minus);
+		assert(par_profile.candidates_after_predicate == seq_profile.candidates_after_predicate);
+		const auto banned = search_server.FindTopDocuments(execution::par, query, DocumentStatus::BANNED);
+		for (const Document& document : banned) {
+			assert(document.id % 3 == 0);
+		}
+	}
+	// части считаются несколькими потоками и на машине с одним процессором: буферы запроса
+	// должны быть общими для всех частей, а не своими у каждого потока
+	{
+		tbb::global_control parallelism(tbb::global_control::max_allowed_parallelism, MAX_THREADS);
+		tbb::task_arena arena(MAX_THREADS);
+		arena.execute([&search_server]() {
+			for (int round = 0; round < 20; ++round) {
+				for (const string& query : { "cat dog rat pet -fur"s, "ear -paw -tail"s, "+cat +dog -rat"s }) {
+					const auto expected = search_server.FindTopDocuments(execution::seq, query);
+					const auto found = search_server.FindTopDocuments(execution::par, query);
+					assert(found.size() == expected.size());
+					for (size_t i = 0; i < found.size(); ++i) {
+						assert(found[i].relevance == expected[i].relevance && found[i].rating == expected[i].rating);
+					}
+				}
+			}
+		});
+	}
+	cout << "TestRangePartitionedSearch OK"s << endl;
+}
+
+void TestPaginatedSearch() {
+	using namespace std;
+	mt19937 generator(11);
+	const vector<string> words = { "cat"s, "dog"s, "rat"s, "pet"s, "fur"s, "tail"s };
+	SearchServer search_server(""s);
+	for (int id = 0; id < 40000; ++id) {
+		string text;
+		for (int i = 0; i < 5; ++i) {
+			text += words[uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] + " "s;
+		}
+		search_server.AddDocument(id, text, id % 4 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL,
+			{ uniform_int_distribution<int>(-3, 3)(generator) });
+	}
+	const string query = "cat dog -fur"s;
+	// полная выдача в строгом порядке
+	SearchResults all_pages = search_server.FindAllPages(query);
+	const size_t matched = all_pages.GetMatchedCount();
+	assert(matched > 1000);
+	const vector<Document> expected = all_pages.NextPage(matched);
+	assert(is_sorted(expected.begin(), expected.end(), IsRankedBefore));
+	assert(all_pages.GetRemainingCount() == 0 && all_pages.NextPage(10).empty());
+	// первая страница совпадает с FindTopDocuments по релевантности
+	const auto top = search_server.FindTopDocuments(query);
+	for (size_t i = 0; i < top.size(); ++i) {
+		assert(abs(top[i].relevance - expected[i].relevance) < RELEVANCE_TRESHOLD);
+	}
+	// обход курсорами дает ту же выдачу, с par - тоже
+	const auto actual = [](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::ACTUAL; };
+	for (const bool parallel : { false, true }) {
+		vector<Document> found;
+		string cursor;
+		do {
+			const SearchPage page = parallel
+				? search_server.FindPage(execution::par, query, actual, 97, cursor)
+				: search_server.FindPage(query, 97, cursor);
+			assert(page.documents.size() <= 97);
+			found.insert(found.end(), page.documents.begin(), page.documents.end());
+			cursor = page.next_cursor;
+		} while (!cursor.empty());
+		assert(found.size() == expected.size());
+		for (size_t i = 0; i < found.size(); ++i) {
+			assert(found[i].id == expected[i].id && found[i].relevance == expected[i].relevance);
+		}
+	}
+	// курсор переживает перевод в строку побитово
+	const SearchCursor last = DecodeSearchCursor(EncodeSearchCursor({ expected[500], 7 }));
+	assert(last.after.id == expected[500].id && last.after.relevance == expected[500].relevance
+		&& last.after.rating == expected[500].rating && last.stop_words_version == 7);
+	const SearchPage page = search_server.FindPage(query, 3,
+		EncodeSearchCursor({ expected[500], search_server.GetStopWordsVersion() }));
+	assert(page.documents.front().id == expected[501].id);
+	for (const string& cursor : { "junk"s, "0x1p-2:3"s, "0x1p-2:3:5"s, "0x1p-2:3:5:"s, "0x1p-2:3:5:0:"s }) {
+		try {
+			search_server.FindPage(query, 3, cursor);
+			assert(false);
+		} catch (const invalid_argument&) {
+		}
+	}
+	// ленивый обход: страницы считаются по мере перехода
+	SearchResults results = search_server.FindAllPages(execution::par, query, actual);
+	size_t page_count = 0;
+	for (const vector<Document>& documents : LazyPaginator(results, 10)) {
+		assert(documents.front().id == expected[page_count * 10].id);
+		if (++page_count == 3) {
+			break;
+		}
+	}
+	assert(results.GetRemainingCount() == matched - 30);
+	size_t rest = 0;
+	for (const vector<Document>& documents : LazyPaginator(results, 1000)) {
+		rest += documents.size();
+	}
+	assert(rest == matched - 30);
+	// после смены стоп-слов курсор отвергается, а не листает изменившуюся выдачу
+	for (const bool add_stop_word : { true, false }) {
+		const string stale_cursor = search_server.FindPage(query, 97).next_cursor;
+		assert(!stale_cursor.empty());
+		if (add_stop_word) {
+			search_server.SetStopWords("dog"s);
+		} else {
+			search_server.RemoveStopWords("dog"s);
+		}
+		bool is_thrown = false;
+		try {
+			search_server.FindPage(query, 97, stale_cursor);
+		} catch (const invalid_argument&) {
+			is_thrown = true;
+		}
+		assert(is_thrown);
+		const string cursor = search_server.FindPage(query, 97).next_cursor;
+		assert(search_server.FindPage(query, 97, cursor).documents.size() == 97);
+	}
+	cout << "TestPaginatedSearch OK"s << endl;
+}
+
+void TestFacetedSearch() {
+	using namespace std;
+	mt19937 generator(13);
+	const vector<string> words = { "cat"s, "dog"s, "rat"s, "pet"s, "fur"s, "tail"s };
+	const vector<DocumentStatus> statuses = { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT,
+		DocumentStatus::BANNED, DocumentStatus::REMOVED };
+	SearchServer search_server(""s);
+	map<int, pair<DocumentStatus, int>> document_data;
+	for (int id = 0; id < 40000; ++id) {
+		string text;
+		for (int i = 0; i < 5; ++i) {
+			text += words[uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] + " "s;
+		}
+		const DocumentStatus status = statuses[id % statuses.size()];
+		const int rating = uniform_int_distribution<int>(-12, 12)(generator);
+		search_server.AddDocument(id, text, status, { rating });
+		document_data[id] = { status, rating };
+	}
+	const string query = "cat dog -fur"s;
+	// счетчики по всем найденным документам, независимо от предиката
+	SearchResults all = search_server.FindAllPages(execution::seq, query,
+		[](int document_id, DocumentStatus status, int rating) { return true; });
+	SearchFacets expected;
+	expected.rating_bucket_width = 5;
+	for (const Document& document : all.NextPage(all.GetMatchedCount())) {
+		const auto [status, rating] = document_data.at(document.id);
+		++expected.status_counts[static_cast<size_t>(status)];
+		++expected.rating_counts[expected.GetRatingBucket(rating)];
+	}
+	assert(expected.GetRatingBucket(-1) == -5 && expected.GetRatingBucket(-5) == -5 && expected.GetRatingBucket(4) == 0);
+	const auto banned = [](int document_id, DocumentStatus status, int rating) { return status == DocumentStatus::BANNED; };
+	for (const bool parallel : { false, true }) {
+		const FacetedDocuments found = parallel
+			? search_server.FindFacetedDocuments(execution::par, query, banned, 5)
+			: search_server.FindFacetedDocuments(execution::seq, query, banned, 5);
+		assert(found.facets.status_counts == expected.status_counts);
+		assert(found.facets.rating_counts == expected.rating_counts);
+		// выдача - та же, что у FindTopDocuments с тем же предикатом
+		const auto top = search_server.FindTopDocuments(query, banned);
+		assert(found.documents.size() == top.size());
+		for (size_t i = 0; i < top.size(); ++i) {
+			assert(found.documents[i].relevance == top[i].relevance && found.documents[i].rating == top[i].rating);
+		}
+	}
+	const FacetedDocuments actual = search_server.FindFacetedDocuments(query);
+	assert(actual.facets.GetStatusCount(DocumentStatus::ACTUAL) == expected.GetStatusCount(DocumentStatus::ACTUAL));
+	assert(actual.facets.rating_counts.size() == 25);
+	try {
+		search_server.FindFacetedDocuments(query, 0);
+		assert(false);
+	} catch (const invalid_argument&) {
+	}
+	cout << "TestFacetedSearch OK"s << endl;
+}
+
+void TestBooleanQueries() {
+	using namespace std;
+	// без включения логических запросов операторы - обычный текст, как раньше
+	{
+		SearchServer plain_server(""s);
+		plain_server.AddDocument(1, "f(x) of c++ code"s, DocumentStatus::ACTUAL, { 1 });
+		plain_server.AddDocument(2, "this OR that"s, DocumentStatus::ACTUAL, { 2 });
+		plain_server.AddDocument(3, "+cat and (dog)"s, DocumentStatus::ACTUAL, { 3 });
+		plain_server.AddDocument(4, "cat AND NOT dog"s, DocumentStatus::ACTUAL, { 4 });
+		const auto find_plain = [&plain_server](const string& query) {
+			set<int> ids;
+			for (const Document& document : plain_server.FindTopDocuments(query)) {
+				ids.insert(document.id);
+			}
+			return ids;
+		};
+		assert(find_plain("f(x)"s) == set<int>({ 1 }));
+		assert(find_plain("c++"s) == set<int>({ 1 }));
+		assert(find_plain("OR"s) == set<int>({ 2 }));
+		assert(find_plain("+cat"s) == set<int>({ 3 }));
+		assert(find_plain("(dog)"s) == set<int>({ 3 }));
+		assert(find_plain("cat AND"s) == set<int>({ 4 }));
+		assert(find_plain("NOT"s) == set<int>({ 4 }));
+		assert(find_plain("cat -(dog)"s) == set<int>({ 4 }));
+		{
+			const auto [words, status] = plain_server.MatchDocument("c++ f(x) OR"s, 1);
+			assert(words == vector<string_view>({ "c++"sv, "f(x)"sv }));
+		}
+		FrozenSearchServer frozen(plain_server);
+		assert(frozen.FindTopDocuments("c++ f(x)"s).size() == 1);
+		assert(frozen.FindTopDocuments("OR"s).front().id == 2);
+	}
+	SearchServer search_server("and"s);
+	search_server.SetBooleanQueriesEnabled(true);
+	search_server.AddDocument(1, "white cat fluffy tail"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "black dog long tail"s, DocumentStatus::ACTUAL, { 2 });
+	search_server.AddDocument(3, "white dog"s, DocumentStatus::ACTUAL, { 3 });
+	search_server.AddDocument(4, "cat and dog friends"s, DocumentStatus::ACTUAL, { 4 });
+	search_server.AddDocument(5, "rat"s, DocumentStatus::ACTUAL, { 5 });
+	const auto find_ids = [&search_server](const string& query) {
+		set<int> ids;
+		for (const Document& document : search_server.FindTopDocuments(query)) {
+			ids.insert(document.id);
+		}
+		return ids;
+	};
+	assert(find_ids("+cat +tail"s) == set<int>({ 1 }));
+	assert(find_ids("+white dog"s) == set<int>({ 1, 3 }));
+	assert(search_server.FindTopDocuments("+white dog"s).front().id == 3);
+	assert(find_ids("cat AND dog"s) == set<int>({ 4 }));
+	assert(find_ids("(cat OR rat) AND NOT white"s) == set<int>({ 4, 5 }));
+	assert(find_ids("tail -(white fluffy)"s) == set<int>({ 2 }));
+	assert(find_ids("white AND (dog OR tail)"s) == set<int>({ 1, 3 }));
+	assert(find_ids("white AND dog OR rat"s) == set<int>({ 3, 5 }));
+	assert(find_ids("+fluff* +white"s) == set<int>({ 1 }));
+	// отрицание без слов не находит ничего, стоп-слово в цепочке AND пропускается
+	assert(find_ids("NOT cat"s).empty());
+	assert(find_ids("cat AND and AND tail"s) == set<int>({ 1 }));
+	// обычный запрос не изменился
+	assert(find_ids("cat tail -fluffy"s) == set<int>({ 2, 4 }));
+	// релевантность считается так же, как у запроса без операторов
+	assert(search_server.FindTopDocuments("+cat +tail"s).front().relevance
+		== search_server.FindTopDocuments("cat tail"s).front().relevance);
+	{
+		const auto [words, status] = search_server.MatchDocument("+cat +tail"s, 2);
+		assert(words.empty());
+	}
+	{
+		const auto [words, status] = search_server.MatchDocument("cat AND dog"s, 4);
+		assert(words == vector<string_view>({ "cat"sv, "dog"sv }));
+	}
+	for (const string& query : { "cat AND"s, "OR cat"s, "cat OR"s, "(cat"s, "cat)"s, "+"s, "++cat"s, "NOT"s, "()"s }) {
+		try {
+			search_server.FindTopDocuments(query);
+			assert(query == "()"s);
+		} catch (const invalid_argument&) {
+		}
+	}
+	// на большом корпусе отбор совпадает с проверкой каждого документа, par - с seq
+	mt19937 generator(17);
+	const vector<string> words = { "cat"s, "dog"s, "rat"s, "pet"s, "fur"s, "tail"s, "paw"s, "ear"s, "owl"s, "elk"s };
+	SearchServer large_server(""s);
+	large_server.SetBooleanQueriesEnabled(true);
+	for (int id = 0; id < 40000; ++id) {
+		string text;
+		for (int i = 0; i < 4; ++i) {
+			// редкие слова в конце словаря
+			const size_t index = min(uniform_int_distribution<size_t>(0, 40)(generator), words.size() - 1);
+			text += words[index] + " "s;
+		}
+		large_server.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 7 });
+	}
+	const auto any_status = [](int document_id, DocumentStatus status, int rating) { return true; };
+	const string query = "+elk +cat dog -rat"s;
+	SearchResults results = large_server.FindAllPages(execution::seq, query, any_status);
+	set<int> found;
+	for (const Document& document : results.NextPage(results.GetMatchedCount())) {
+		found.insert(document.id);
+	}
+	set<int> expected;
+	for (const int id : large_server) {
+		const auto [matched, status] = large_server.MatchDocument("elk cat rat"s, id);
+		if (count(matched.begin(), matched.end(), "elk"sv) && count(matched.begin(), matched.end(), "cat"sv)
+			&& !count(matched.begin(), matched.end(), "rat"sv)) {
+			expected.insert(id);
+		}
+	}
+	assert(!expected.empty() && found == expected);
+	const auto seq_top = large_server.FindTopDocuments(execution::seq, query);
+	const auto par_top = large_server.FindTopDocuments(execution::par, query);
+	assert(seq_top.size() == par_top.size());
+	for (size_t i = 0; i < seq_top.size(); ++i) {
+		assert(seq_top[i].relevance == par_top[i].relevance);
+	}
+	// пересечение просматривает только часть длинных списков
+	QueryProfile profile;
+	large_server.ExplainTopDocuments(query, profile);
+	assert(profile.pruning);
+	for (const TermProfile& term : profile.terms) {
+		if (term.word == "cat"s) {
+			assert(term.postings_skipped > 0);
+		}
+	}
+	cout << "TestBooleanQueries OK"s << endl;
+}
+
+void TestIncrementalStopWords() {
+	using namespace std;
+	const vector<string> texts = { "the cat and the dog"s, "white cat"s, "the white dog and a rat"s, "and the"s,
+		"black rat in the house"s, "a cat in a hat"s };
+	const auto make_server = [&texts](const string& stop_words, bool forward_index, bool positions) {
+		SearchServer search_server(stop_words);
+		search_server.SetBooleanQueriesEnabled(true);
+		search_server.SetForwardIndexEnabled(forward_index);
+		if (positions) {
+			search_server.EnablePositionalIndex();
+		}
+		for (size_t id = 0; id < texts.size(); ++id) {
+			search_server.AddDocument(static_cast<int>(id), texts[id], DocumentStatus::ACTUAL, { static_cast<int>(id) });
+		}
+		return search_server;
+	};
+	// выдача и частоты слов совпадают побитово с сервером, построенным заново
+	const auto assert_same = [&texts](const SearchServer& lhs, const SearchServer& rhs) {
+		for (const string& query : { "cat dog"s, "white rat -dog"s, "the cat"s, "a hat in house"s, "+cat +in"s }) {
+			const auto lhs_found = lhs.FindTopDocuments(query);
+			const auto rhs_found = rhs.FindTopDocuments(query);
+			assert(lhs_found.size() == rhs_found.size());
+			for (size_t i = 0; i < lhs_found.size(); ++i) {
+				assert(lhs_found[i].id == rhs_found[i].id && lhs_found[i].relevance == rhs_found[i].relevance);
+			}
+		}
+		for (const int id : lhs) {
+			const map<string_view, double> lhs_freqs = lhs.GetWordFrequencies(id);
+			const map<string_view, double> rhs_freqs = rhs.GetWordFrequencies(id);
+			assert(lhs_freqs == rhs_freqs);
+			const auto [lhs_words, lhs_status] = lhs.MatchDocument("the cat and a dog"s, id);
+			const auto [rhs_words, rhs_status] = rhs.MatchDocument("the cat and a dog"s, id);
+			assert(lhs_words == rhs_words);
+		}
+	};
+	for (const bool forward_index : { true, false }) {
+		SearchServer search_server = make_server(""s, forward_index, false);
+		const uint64_t version = search_server.GetStopWordsVersion();
+		search_server.SetStopWords("the and a"s);
+		assert(search_server.GetStopWordsVersion() > version);
+		assert_same(search_server, make_server("the and a"s, forward_index, false));
+		assert(search_server.FindTopDocuments("the"s).empty());
+		// возврат слова: документы снова находятся по нему, удаленный за это время - нет
+		search_server.RemoveDocument(0);
+		search_server.RemoveStopWords("the"s);
+		SearchServer expected = make_server("and a"s, forward_index, false);
+		expected.RemoveDocument(0);
+		assert_same(search_server, expected);
+		assert(search_server.FindTopDocuments("the"s).size() == 3);
+		// новые документы индексируются с текущими стоп-словами
+		search_server.AddDocument(10, "the rat and a cat"s, DocumentStatus::ACTUAL, { 1 });
+		expected.AddDocument(10, "the rat and a cat"s, DocumentStatus::ACTUAL, { 1 });
+		assert_same(search_server, expected);
+	}
+	// позиционный индекс: фраза со словом, которое побывало стоп-словом
+	SearchServer search_server = make_server(""s, true, true);
+	search_server.SetStopWords("white"s);
+	assert(search_server.FindTopDocuments("white"s).empty());
+	search_server.RemoveStopWords("white"s);
+	const auto found = search_server.FindTopDocuments("\"white dog\""s);
+	assert(found.size() == 1 && found.front().id == 2);
+
+	// позиции перенумеровываются: фразы и близость слов - как у сервера, построенного заново,
+	// в том числе когда стоп-слова добавляются и убираются по очереди
+	const auto assert_same_positions = [&](SearchServer& lhs, const string& stop_words) {
+		SearchServer rhs = make_server(stop_words, true, true);
+		lhs.SetProximityBoost(0.5);
+		rhs.SetProximityBoost(0.5);
+		assert_same(lhs, rhs);
+		for (const string& query : { "\"cat dog\""s, "\"cat the dog\""s, "\"white dog rat\""s, "\"in the house\""s,
+			"\"rat in house\""s, "\"cat in hat\""s, "\"cat hat\""s, "\"the white dog\""s, "\"white dog a rat\""s,
+			"cat dog"s, "rat house"s, "cat hat"s }) {
+			const auto lhs_found = lhs.FindTopDocuments(query);
+			const auto rhs_found = rhs.FindTopDocuments(query);
+			assert(lhs_found.size() == rhs_found.size());
+			for (size_t i = 0; i < lhs_found.size(); ++i) {
+				assert(lhs_found[i].id == rhs_found[i].id && lhs_found[i].relevance == rhs_found[i].relevance);
+			}
+		}
+	};
+	SearchServer positional = make_server(""s, true, true);
+	positional.SetStopWords("the and a"s);
+	assert_same_positions(positional, "the and a"s);
+	assert(positional.FindTopDocuments("\"cat dog\""s).size() == 1);
+	positional.RemoveStopWords("the"s);
+	assert_same_positions(positional, "and a"s);
+	positional.SetStopWords("in"s);
+	assert_same_positions(positional, "and a in"s);
+	positional.RemoveStopWords("a and"s);
+	assert_same_positions(positional, "in"s);
+	positional.RemoveStopWords("in"s);
+	assert_same_positions(positional, ""s);
+
+	// недопустимые символы отвергаются в обоих направлениях, и стоп-слова не меняются
+	const uint64_t version = positional.GetStopWordsVersion();
+	for (const bool is_remove : { false, true }) {
+		bool is_thrown = false;
+		try {
+			if (is_remove) {
+				positional.RemoveStopWords("cat d\x12og"s);
+			} else {
+				positional.SetStopWords("cat d\x12og"s);
+			}
+		} catch (const invalid_argument&) {
+			is_thrown = true;
+		}
+		assert(is_thrown);
+	}
+	assert(positional.GetStopWordsVersion() == version && positional.FindTopDocuments("cat"s).size() == 3);
+	cout << "TestIncrementalStopWords OK"s << endl;
+}
+
+void TestCorpusLoader() {
+	using namespace std;
+	// плохие строки пропускаются с номером строки, остальные индексируются
+	{
+		SearchServer search_server("and"s);
+		istringstream input(
+			"1\tACTUAL\t1 2 3\twhite cat and yellow hat\n"s
+			"2\tBANNED\t\tcurly cat curly tail\r\n"s
+			"\n"s
+			"3\tUNKNOWN\t1\tnasty dog\n"s
+			"4\tACTUAL\t1 x\tnasty dog\n"s
+			"5\tACTUAL\n"s
+			"1\tACTUAL\t5\tduplicate id\n"s
+			"6\tIRRELEVANT\t-4\tnasty pigeon john"s);
+		const CorpusLoadStats stats = LoadCorpus(search_server, input, CorpusFormat::TSV);
+		assert(stats.documents == 3 && stats.lines == 8 && stats.rejected == 4);
+		assert(stats.errors.size() == 4);
+		assert(stats.errors[0].line_number == 4 && stats.errors[1].line_number == 5);
+		assert(stats.errors[2].line_number == 6 && stats.errors[3].line_number == 7);
+		assert(search_server.GetDocumentCount() == 3);
+		const auto banned = search_server.FindTopDocuments("curly"s, DocumentStatus::BANNED);
+		assert(banned.size() == 1 && banned.front().id == 2 && banned.front().rating == 0);
+		const auto found = search_server.FindTopDocuments("john"s, DocumentStatus::IRRELEVANT);
+		assert(found.size() == 1 && found.front().id == 6 && found.front().rating == -4);
+	}
+	// JSONL: экранирование, лишние поля, необязательные статус и рейтинги
+	{
+		SearchServer search_server(""s);
+		istringstream input(
+			R"({"id": 1, "text": "white \"cat\" and\/or собака", "extra": {"a": [1, null]}})" "\n"s
+			R"({"id": 2, "status": "BANNED", "ratings": [4, -2], "text": "curly dog"})" "\n"s
+			R"({"id": 3, "ratings": [1.5], "text": "bad rating"})" "\n"s
+			R"({"id": 4})" "\n"s
+			R"({"id": 5, "text": "trailing"} x)" "\n"s);
+		const CorpusLoadStats stats = LoadCorpus(search_server, input, CorpusFormat::JSONL);
+		assert(stats.documents == 2 && stats.rejected == 3);
+		assert(stats.errors[0].line_number == 3 && stats.errors[1].line_number == 4 && stats.errors[2].line_number == 5);
+		assert(search_server.FindTopDocuments("\xd1\x81\xd0\xbe\xd0\xb1\xd0\xb0\xd0\xba\xd0\xb0"s).size() == 1);
+		assert(search_server.FindTopDocuments("\"cat\""s).size() == 1);
+		const auto banned = search_server.FindTopDocuments("dog"s, DocumentStatus::BANNED);
+		assert(banned.size() == 1 && banned.front().rating == 1);
+	}
+	// корпус больше блока чтения: из потока и из файла получается один и тот же индекс
+	{
+		mt19937 generator(3);
+		const vector<string> words = { "cat"s, "dog"s, "rat"s, "pet"s, "fur"s, "tail"s, "paw"s, "ear"s };
+		string corpus;
+		for (int id = 0; id < 40000; ++id) {
+			corpus += to_string(id) + "\tACTUAL\t"s + to_string(id % 7) + "\t"s;
+			for (int i = 0; i < 5; ++i) {
+				corpus += words[uniform_int_distribution<size_t>(0, words.size() - 1)(generator)] + " "s;
+			}
+			corpus += "\n"s;
+		}
+		assert(corpus.size() > (1 << 20));
+		SearchServer stream_server(""s);
+		istringstream input(corpus);
+		const CorpusLoadStats stream_stats = LoadCorpus(stream_server, input, CorpusFormat::TSV);
+		assert(stream_stats.documents == 40000 && stream_stats.rejected == 0 && stream_stats.bytes == corpus.size());
+
+		char path[] = "/tmp/corpus_XXXXXX";
+		const int file = mkstemp(path);
+		assert(file >= 0);
+		assert(write(file, corpus.data(), corpus.size()) == static_cast<ssize_t>(corpus.size()));
+		close(file);
+		SearchServer file_server(""s);
+		const CorpusLoadStats file_stats = LoadCorpusFile(file_server, path, CorpusFormat::TSV);
+		unlink(path);
+		assert(file_stats.documents == 40000 && file_stats.lines == 40000);
+		assert(file_stats.GetDocumentsPerSecond() > 0 && file_stats.GetMegabytesPerSecond() > 0);
+		const auto stream_found = stream_server.FindTopDocuments("cat paw -ear"s);
+		const auto file_found = file_server.FindTopDocuments("cat paw -ear"s);
+		assert(stream_found.size() == file_found.size());
+		for (size_t i = 0; i < stream_found.size(); ++i) {
+			assert(stream_found[i].id == file_found[i].id && stream_found[i].relevance == file_found[i].relevance);
+		}
+	}
+	bool is_thrown = false;
+	try {
+		SearchServer search_server(""s);
+		LoadCorpusFile(search_server, "/nonexistent/corpus.tsv"s, CorpusFormat::TSV);
+	} catch (const runtime_error&) {
+		is_thrown = true;
+	}
+	assert(is_thrown);
+	cout << "TestCorpusLoader OK"s << endl;
+}
+
+void TestDurableSearchServer() {
+	using namespace std;
+	// контрольная сумма записей совпадает с CRC-32 из zlib и считается по частям
+	assert(ComputeCrc32("123456789"s) == 0xCBF43926);
+	const string crc_text = "white cat and yellow hat, curly cat curly tail"s;
+	assert(ComputeCrc32(crc_text.substr(13), ComputeCrc32(crc_text.substr(0, 13))) == ComputeCrc32(crc_text));
+
+	char directory_template[] = "/tmp/durable_XXXXXX";
+	const string directory = mkdtemp(directory_template);
+	const string wal_path = directory + "/wal"s;
+	const auto assert_same = [](const SearchServer& lhs, const SearchServer& rhs) {
+		assert(lhs.GetDocumentCount() == rhs.GetDocumentCount());
+		for (const string& query : { "cat dog"s, "white rat -dog"s, "curly tail"s, "+cat +white"s }) {
+			const auto lhs_found = lhs.FindTopDocuments(query);
+			const auto rhs_found = rhs.FindTopDocuments(query);
+			assert(lhs_found.size() == rhs_found.size());
+			for (size_t i = 0; i < lhs_found.size(); ++i) {
+				assert(lhs_found[i].id == rhs_found[i].id && lhs_found[i].relevance == rhs_found[i].relevance
+					&& lhs_found[i].rating == rhs_found[i].rating);
+			}
+		}
+	};
+	const vector<string> texts = { "white cat and yellow hat"s, "curly cat curly tail"s, "nasty dog with big eyes"s,
+		"white rat"s, "cat dog rat"s, "curly white dog"s };
+	WriteAheadLogOptions options;
+	options.sync_every_records = 4;
+	SearchServer expected("and"s);
+	{
+		DurableSearchServer search_server(directory, SearchServer("and"s), options);
+		assert(!search_server.GetRecoveryStats().snapshot_loaded);
+		for (size_t id = 0; id < texts.size(); ++id) {
+			search_server.AddDocument(static_cast<int>(id), texts[id], DocumentStatus::ACTUAL, { static_cast<int>(id), 1 });
+			expected.AddDocument(static_cast<int>(id), texts[id], DocumentStatus::ACTUAL, { static_cast<int>(id), 1 });
+		}
+		// отвергнутое изменение остается в журнале и отвергается при восстановлении
+		bool is_thrown = false;
+		try {
+			search_server.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, {});
+		} catch (const invalid_argument&) {
+			is_thrown = true;
+		}
+		assert(is_thrown);
+		search_server.RemoveDocument(2);
+		search_server.RemoveDocument(100);
+		search_server.SetStopWords("with"s);
+		expected.RemoveDocument(2);
+		expected.SetStopWords("with"s);
+	}
+	{
+		DurableSearchServer search_server(directory, SearchServer("and"s), options);
+		assert(search_server.GetRecoveryStats().replayed_records == 9);
+		assert(search_server.GetRecoveryStats().rejected_records == 1);
+		assert_same(search_server.GetServer(), expected);
+		search_server.Checkpoint();
+		search_server.AddDocument(10, "black cat"s, DocumentStatus::BANNED, { 5 });
+		expected.AddDocument(10, "black cat"s, DocumentStatus::BANNED, { 5 });
+	}
+	filesystem::path saved_wal = directory + "/saved_wal"s;
+	{
+		DurableSearchServer search_server(directory, SearchServer(""s), options);
+		const RecoveryStats& stats = search_server.GetRecoveryStats();
+		assert(stats.snapshot_loaded && stats.replayed_records == 1 && stats.discarded_bytes == 0);
+		assert_same(search_server.GetServer(), expected);
+		// падение между сохранением снимка и очисткой журнала: журнал остается прежним
+		filesystem::copy_file(wal_path, saved_wal);
+		search_server.Checkpoint();
+	}
+	filesystem::copy_file(saved_wal, wal_path, filesystem::copy_options::overwrite_existing);
+	{
+		DurableSearchServer search_server(directory, SearchServer(""s), options);
+		assert(search_server.GetRecoveryStats().skipped_records == 1);
+		assert(search_server.GetRecoveryStats().replayed_records == 0);
+		assert_same(search_server.GetServer(), expected);
+		// номера записей продолжаются после номера снимка
+		search_server.RemoveDocument(10);
+		expected.RemoveDocument(10);
+		search_server.AddDocument(11, "white cat tail"s, DocumentStatus::ACTUAL, { 2 });
+		expected.AddDocument(11, "white cat tail"s, DocumentStatus::ACTUAL, { 2 });
+	}
+	// недописанная последняя запись отрезается, предыдущие восстанавливаются
+	const uintmax_t wal_size = filesystem::file_size(wal_path);
+	filesystem::resize_file(wal_path, wal_size - 3);
+	{
+		DurableSearchServer search_server(directory, SearchServer(""s), options);
+		assert(search_server.GetRecoveryStats().replayed_records == 1);
+		assert(search_server.GetRecoveryStats().discarded_bytes > 0);
+		expected.RemoveDocument(11);
+		assert_same(search_server.GetServer(), expected);
+	}
+	// ошибка записи журнала: изменение не применяется к серверу и не восстанавливается позже
+	{
+		WriteAheadLogOptions sync_options;
+		sync_options.sync_every_records = 1;
+		DurableSearchServer search_server(directory, SearchServer(""s), sync_options);
+		search_server.AddDocument(12, "yellow dog"s, DocumentStatus::ACTUAL, { 3 });
+		expected.AddDocument(12, "yellow dog"s, DocumentStatus::ACTUAL, { 3 });
+		// дескриптор журнала подменяется устройством, запись в которое всегда неудачна
+		const int full = open("/dev/full", O_WRONLY);
+		for (const auto& entry : filesystem::directory_iterator("/proc/self/fd"s)) {
+			error_code error;
+			if (filesystem::read_symlink(entry.path(), error) == filesystem::path(wal_path)) {
+				dup2(full, stoi(entry.path().filename().string()));
+			}
+		}
+		close(full);
+		bool is_thrown = false;
+		try {
+			search_server.AddDocument(13, "white cat"s, DocumentStatus::ACTUAL, { 4 });
+		} catch (const runtime_error&) {
+			is_thrown = true;
+		}
+		assert(is_thrown);
+		assert_same(search_server.GetServer(), expected);
+	}
+	{
+		DurableSearchServer search_server(directory, SearchServer(""s), options);
+		assert(search_server.GetRecoveryStats().replayed_records == 2);
+		assert_same(search_server.GetServer(), expected);
+	}
+
+	// снимок сервера с позиционным индексом и стоп-словами, убранными после индексации
+	SearchServer positional(""s);
+	positional.EnablePositionalIndex();
+	for (size_t id = 0; id < texts.size(); ++id) {
+		positional.AddDocument(static_cast<int>(id), texts[id], DocumentStatus::ACTUAL, { 1 });
+	}
+	positional.SetStopWords("curly"s);
+	stringstream snapshot;
+	positional.SaveSnapshot(snapshot);
+	SearchServer loaded(""s);
+	loaded.LoadSnapshot(snapshot);
+	assert_same(loaded, positional);
+	assert(loaded.FindTopDocuments("\"white cat\""s).size() == 1);
+	loaded.RemoveStopWords("curly"s);
+	positional.RemoveStopWords("curly"s);
+	assert_same(loaded, positional);
+	assert(loaded.FindTopDocuments("\"curly tail\""s).size() == 1);
+	// поврежденный снимок не меняет сервер
+	string corrupted = snapshot.str();
+	corrupted[corrupted.size() / 2] ^= 1;
+	istringstream corrupted_input(corrupted);
+	bool is_thrown = false;
+	try {
+		loaded.LoadSnapshot(corrupted_input);
+	} catch (const runtime_error&) {
+		is_thrown = true;
+	}
+	assert(is_thrown);
+	assert_same(loaded, positional);
+
+	// снимок с верной контрольной суммой, но недопустимыми значениями, тоже отвергается
+	const auto reseal = [](string file) {
+		// сигнатура (8 байт), данные, CRC-32 данных
+		const uint32_t crc = ComputeCrc32(string_view{ file }.substr(8, file.size() - 8 - sizeof(uint32_t)));
+		memcpy(file.data() + file.size() - sizeof(uint32_t), &crc, sizeof(crc));
+		return file;
+	};
+	const auto is_rejected = [](const string& file) {
+		istringstream input(file);
+		SearchServer target(""s);
+		try {
+			target.LoadSnapshot(input);
+		} catch (const runtime_error&) {
+			return true;
+		}
+		return false;
+	};
+	{
+		SearchServer plain(""s);
+		plain.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+		plain.AddDocument(2, "black dog"s, DocumentStatus::BANNED, { 2 });
+		stringstream output;
+		plain.SaveSnapshot(output);
+		const string file = output.str();
+		assert(!is_rejected(reseal(file)));
+		// стоп-слов нет: счетчик и версия стоп-слов, id и рейтинги двух документов, затем статусы
+		string bad_status = file;
+		const int status = 7;
+		memcpy(bad_status.data() + 8 + 8 + 8 + (8 + 2 * 4) + (8 + 2 * 4) + 8, &status, sizeof(status));
+		assert(is_rejected(reseal(bad_status)));
+	}
+	{
+		SearchServer single(""s);
+		single.EnablePositionalIndex();
+		single.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, { 1 });
+		stringstream output;
+		single.SaveSnapshot(output);
+		const string file = output.str();
+		// последний байт позиций единственного слова стоит перед числом стоп-слов и CRC
+		const size_t position_byte = file.size() - sizeof(uint32_t) - sizeof(uint64_t) - 1;
+		assert(file[position_byte] == 0);
+		for (const char value : { '\x05', '\x80' }) {
+			string bad_position = file;
+			bad_position[position_byte] = value;
+			assert(is_rejected(reseal(bad_position)));
+		}
+	}
+	filesystem::remove_all(directory);
+	cout << "TestDurableSearchServer OK"s << endl;
+}
+
+void TestMemoryStats() {
+	using namespace std;
+	const vector<string> texts = { "white cat and yellow hat"s, "curly cat curly tail"s, "nasty dog with big eyes"s,
+		"nasty pigeon john"s, "well groomed starling evgeny"s };
+	SearchServer search_server("and with"s);
+	search_server.EnablePositionalIndex();
+	for (size_t i = 0; i < texts.size(); ++i) {
+		search_server.AddDocument(static_cast<int>(i), texts[i], DocumentStatus::ACTUAL, { 1, 2 });
+	}
+	search_server.FindTopDocuments("cat*"s);
+	const MemoryStats stats = search_server.GetMemoryStats();
+	assert(stats.stop_words == 2 * GetTreeNodeSize<string>());
+	assert(stats.words > 0 && stats.postings > 0 && stats.forward_index > 0 && stats.positions > 0);
+	assert(stats.documents > 0 && stats.documents % texts.size() == 0);
+	assert(stats.term_dictionary > 0 && stats.stopped_postings == 0);
+	assert(stats.positions == search_server.GetPositionalIndexMemoryUsage());
+	assert(stats.object == sizeof(SearchServer));
+	assert(stats.GetTotal() == stats.stop_words + stats.words + stats.postings + stats.term_words + stats.forward_index
+		+ stats.documents + stats.document_ids + stats.slot_columns + stats.positions + stats.stopped_postings
+		+ stats.term_dictionary + stats.object);
+	// длинные строки занимают блок в куче, короткие хранятся в объекте строки
+	assert(GetHeapSize(string(100, 'a')) == GetAllocationSize(101));
+	assert(GetHeapSize("cat"s) == 0);
+
+	// уплотнение не меняет результатов поиска
+	const auto found = search_server.FindTopDocuments("curly nasty cat"s);
+	search_server.ShrinkToFit();
+	const MemoryStats shrunk = search_server.GetMemoryStats();
+	assert(shrunk.GetTotal() < stats.GetTotal() && shrunk.term_dictionary == 0);
+	const auto shrunk_found = search_server.FindTopDocuments("curly nasty cat"s);
+	assert(found.size() == shrunk_found.size());
+	for (size_t i = 0; i < found.size(); ++i) {
+		assert(found[i].id == shrunk_found[i].id && found[i].relevance == shrunk_found[i].relevance);
+	}
+
+	// с бюджетом добавление останавливается до выхода за него, сервер при этом не меняется
+	const size_t budget = shrunk.GetTotal() + 16 * 1024;
+	search_server.SetMemoryBudget(budget);
+	assert(search_server.GetMemoryBudget() == budget);
+	int document_id = static_cast<int>(texts.size());
+	bool is_thrown = false;
+	try {
+		for (; document_id < 10000; ++document_id) {
+			search_server.AddDocument(document_id, "word"s + to_string(document_id) + " cat"s, DocumentStatus::ACTUAL, { 1 });
+		}
+	} catch (const length_error&) {
+		is_thrown = true;
+	}
+	assert(is_thrown);
+	assert(search_server.GetDocumentCount() == static_cast<size_t>(document_id));
+	assert(search_server.FindTopDocuments("word"s + to_string(document_id)).empty());
+	assert(search_server.GetMemoryStats().GetTotal() <= budget);
+	search_server.SetMemoryBudget(0);
+	search_server.AddDocument(document_id, "word"s + to_string(document_id) + " cat"s, DocumentStatus::ACTUAL, { 1 });
+	assert(search_server.FindTopDocuments("word"s + to_string(document_id)).size() == 1);
+	cout << "TestMemoryStats OK"s << endl;
+}
+
+void TestFrozenSearchServer() {
+	using namespace std;
+	SearchServer search_server("and with"s);
+	search_server.SetBooleanQueriesEnabled(true);
+	const vector<string> texts = { "white cat and yellow hat"s, "curly cat curly tail"s, "nasty dog with big eyes"s,
+		"nasty pigeon john"s, "well groomed starling evgeny"s, "curly dog and curly collar"s, "big cat big eyes"s };
+	for (size_t i = 0; i < texts.size(); ++i) {
+		search_server.AddDocument(static_cast<int>(i) * 2, texts[i], i == 3 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL,
+			{ static_cast<int>(i), 5 });
+	}
+	search_server.RemoveDocument(8);
+	const vector<string> queries = { "curly cat"s, "nasty -dog"s, "big eyes -tail"s, "cur* -white"s, "and"s,
+		"-cat* dog"s, "pigeon"s, "missing words"s, "curly curly dog collar hat"s };
+	const auto assert_same = [&queries](const SearchServer& server, const FrozenSearchServer& frozen) {
+		for (const string& query : queries) {
+			for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+				const auto expected = server.FindTopDocuments(query, status);
+				const auto found = frozen.FindTopDocuments(query, status);
+				assert(expected.size() == found.size());
+				for (size_t i = 0; i < found.size(); ++i) {
+					assert(expected[i].id == found[i].id && expected[i].relevance == found[i].relevance
+						&& expected[i].rating == found[i].rating);
+				}
+			}
+		}
+	};
+	// баллы совпадают с сервером побитово при обеих моделях ранжирования
+	const FrozenSearchServer frozen(search_server);
+	assert(frozen.GetDocumentCount() == search_server.GetDocumentCount());
+	assert(vector<int>(frozen.begin(), frozen.end()) == vector<int>(search_server.begin(), search_server.end()));
+	assert_same(search_server, frozen);
+	search_server.SetScorer(make_shared<Bm25Scorer>(1.2, 0.75));
+	assert_same(search_server, FrozenSearchServer(search_server));
+	const auto odd_rating = frozen.FindTopDocuments("curly nasty big"s,
+		[](int document_id, DocumentStatus status, int rating) { return rating % 2 == 1; });
+	assert(!odd_rating.empty());
+	for (const Document& document : odd_rating) {
+		assert(document.rating % 2 == 1);
+	}
+
+	// изменения сервера после заморозки индекс не видит
+	search_server.AddDocument(100, "curly cat"s, DocumentStatus::ACTUAL, { 9 });
+	assert(frozen.GetDocumentCount() + 1 == search_server.GetDocumentCount());
+	for (const Document& document : frozen.FindTopDocuments("curly cat"s)) {
+		assert(document.id != 100);
+	}
+
+	// логические запросы (включенные у сервера) не поддерживаются, ошибки разбора - как у сервера
+	for (const string& query : { "cat OR dog"s, "+cat"s, "(cat dog)"s, "cat --dog"s, "cat -"s, "*"s }) {
+		bool is_thrown = false;
+		try {
+			frozen.FindTopDocuments(query);
+		} catch (const invalid_argument&) {
+			is_thrown = true;
+		}
+		assert(is_thrown);
+	}
+
+	// один объект из нескольких потоков без синхронизации
+	const auto expected = frozen.FindTopDocuments("curly cat -tail"s);
+	vector<thread> threads;
+	vector<int> mismatches(4, 0);
+	for (size_t i = 0; i < mismatches.size(); ++i) {
+		threads.emplace_back([&frozen, &expected, &mismatches, i]() {
+			for (int repeat = 0; repeat < 1000; ++repeat) {
+				const auto found = frozen.FindTopDocuments("curly cat -tail"s);
+				if (found.size() != expected.size() || (!found.empty() && found[0].relevance != expected[0].relevance)) {
+					++mismatches[i];
+				}
+			}
+		});
+	}
+	for (thread& worker : threads) {
+		worker.join();
+	}
+	assert(count(mismatches.begin(), mismatches.end(), 0) == static_cast<int>(mismatches.size()));
+	assert(frozen.GetMemoryUsage() > 0);
+	cout << "TestFrozenSearchServer OK"s << endl;
+}
+void TestHugePages() {
+	using namespace std;
+	// массив, выделенный в одном режиме, освобождается правильно и после смены режима
+	SetHugePageMode(HugePageMode::OFF);
+	IndexVector<int> allocated_before(HUGE_PAGE_SIZE / sizeof(int), 7);
+	for (const HugePageMode mode : { HugePageMode::OFF, HugePageMode::TRANSPARENT, HugePageMode::EXPLICIT }) {
+		SetHugePageMode(mode);
+		assert(GetHugePageMode() == mode);
+		IndexVector<int> small(100, 1);
+		IndexVector<int> large(HUGE_PAGE_SIZE / sizeof(int) + 1);
+		for (size_t i = 0; i < large.size(); ++i) {
+			large[i] = static_cast<int>(i);
+		}
+		assert(accumulate(small.begin(), small.end(), 0) == 100);
+		for (size_t i = 0; i < large.size(); i += 4099) {
+			assert(large[i] == static_cast<int>(i));
+		}
+		// данные выровнены по строке кэша, отображение - по большой странице
+		assert(reinterpret_cast<uintptr_t>(large.data()) % 64 == 0);
+		if (mode != HugePageMode::OFF) {
+			assert((reinterpret_cast<uintptr_t>(large.data()) - 64) % HUGE_PAGE_SIZE == 0);
+			assert(GetHeapSize(large) % HUGE_PAGE_SIZE == 0);
+		}
+		assert(GetHeapSize(large) >= large.capacity() * sizeof(int));
+		// рост вектора переносит данные между отображениями
+		large.resize(2 * large.size(), -1);
+		assert(large[12345] == 12345 && large.back() == -1);
+	}
+	allocated_before = IndexVector<int>();
+	// и наоборот: отображение, выделенное с большими страницами, учитывается и освобождается
+	// по своему заголовку после выключения режима
+	SetHugePageMode(HugePageMode::TRANSPARENT);
+	IndexVector<int> mapped(HUGE_PAGE_SIZE / sizeof(int), 3);
+	SetHugePageMode(HugePageMode::OFF);
+	assert(GetHeapSize(mapped) % HUGE_PAGE_SIZE == 0);
+	assert(reinterpret_cast<uintptr_t>(mapped.data()) % 64 == 0);
+	mapped = IndexVector<int>();
+
+	// индекс, построенный при включенном режиме, ищет так же
+	SearchServer search_server("and with"s);
+	search_server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, { 1 });
+	search_server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 2 });
+	const FrozenSearchServer frozen(search_server);
+	const auto found = frozen.FindTopDocuments("curly cat"s);
+	assert(found.size() == 2 && found[0].id == 2);
+	SetHugePageMode(HugePageMode::OFF);
+	cout << "TestHugePages OK"s << endl;
+}
@@ -1,11 +1,33 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <numeric>
+#include <random>
 #include <sstream>
+#include <thread>
 #include <vector>
 #include <utility>
 
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <tbb/global_control.h>
+#include <tbb/task_arena.h>
+
+#include "corpus_loader.h"
+#include "durable_search_server.h"
+#include "frozen_search_server.h"
+#include "numa_search_server.h"
+#include "paginator.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
 #include "search_server.h"
+#include "shard_socket.h"
+#include "sharded_search_server.h"
 
 using namespace std::string_literals;
 
@@ -15,4 +37,27 @@ void TestRemoveDocument() ;
 void TestSearchServer() ;
 void TestMachDocumentsPar();
 void TesdRemoveDocumentPar();
-void TestFindTopDocsPar();
\ No newline at end of file
+void TestFindTopDocsPar();
+void TestScoringKernels();
+void TestBm25Scorer();
+void TestPhraseQueries();
+void TestPrefixQueries();
+void TestFuzzyMatching();
+void TestForwardIndex();
+void TestRemoveDuplicates();
+void TestMatchDocuments();
+void TestShardedSearchServer();
+void TestNumaSearchServer();
+void TestQueryMetrics();
+void TestExplainTopDocuments();
+void TestAdaptivePolicy();
+void TestRangePartitionedSearch();
+void TestPaginatedSearch();
+void TestFacetedSearch();
+void TestBooleanQueries();
+void TestIncrementalStopWords();
+void TestCorpusLoader();
+void TestDurableSearchServer();
+void TestMemoryStats();
+void TestFrozenSearchServer();
+void TestHugePages();
\ No newline at end of file
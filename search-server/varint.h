@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//Запись числа в формате varint: по 7 бит в байте, старший бит - признак продолжения
+inline void AppendVarint(std::vector<uint8_t>& bytes, uint32_t value) {
+	while (value >= 0x80) {
+		bytes.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back(static_cast<uint8_t>(value));
+}
+
+//Чтение числа в формате varint, возвращает указатель на следующий байт
+inline const uint8_t* ReadVarint(const uint8_t* data, uint32_t& value) {
+	value = 0;
+	int shift = 0;
+	while (*data & 0x80) {
+		value |= static_cast<uint32_t>(*data++ & 0x7F) << shift;
+		shift += 7;
+	}
+	value |= static_cast<uint32_t>(*data++) << shift;
+	return data;
+}
+
+//Запись возрастающей последовательности разностями соседних значений
+inline void AppendDeltaVarints(std::vector<uint8_t>& bytes, const std::vector<uint32_t>& values) {
+	uint32_t previous = 0;
+	for (const uint32_t value : values) {
+		AppendVarint(bytes, value - previous);
+		previous = value;
+	}
+}
+
+//Чтение возрастающей последовательности, записанной разностями, из [begin, end)
+inline void ReadDeltaVarints(const uint8_t* begin, const uint8_t* end, std::vector<uint32_t>& values) {
+	values.clear();
+	uint32_t previous = 0;
+	while (begin != end) {
+		uint32_t delta;
+		begin = ReadVarint(begin, delta);
+		previous += delta;
+		values.push_back(previous);
+	}
+}
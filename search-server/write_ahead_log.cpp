@@ -0,0 +1,297 @@
+#include "write_ahead_log.h"
+#include "binary_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std::string_literals;
+
+namespace {
+
+constexpr std::string_view WAL_MAGIC = "SSWAL001";
+//буфер сбрасывается в файл и до конца группы, если вырос больше этого
+constexpr size_t WAL_BUFFER_LIMIT = 1 << 20;
+constexpr size_t WAL_RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+std::runtime_error SystemError(const std::string& what) {
+	return std::runtime_error(what + ": "s + std::strerror(errno));
+}
+
+void WriteAll(int file, std::string_view data, const std::string& path) {
+	while (!data.empty()) {
+		const ssize_t count = write(file, data.data(), data.size());
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw SystemError("write "s + path);
+		}
+		data.remove_prefix(count);
+	}
+}
+
+//отрезает файл до size после неудачной записи; ошибка здесь не сообщается - уже сообщается исходная
+void ShrinkFile(int file, off_t size) {
+	if (ftruncate(file, size) == 0) {
+		lseek(file, size, SEEK_SET);
+	}
+}
+
+std::string ReadAll(int file, const std::string& path) {
+	std::string data;
+	char chunk[1 << 16];
+	while (true) {
+		const ssize_t count = read(file, chunk, sizeof(chunk));
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw SystemError("read "s + path);
+		}
+		if (count == 0) {
+			return data;
+		}
+		data.append(chunk, count);
+	}
+}
+
+//fsync каталога, чтобы rename или создание файла пережили падение
+void SyncDirectory(const std::string& path) {
+	const size_t slash = path.rfind('/');
+	const std::string directory = slash == std::string::npos ? "."s : slash == 0 ? "/"s : path.substr(0, slash);
+	const int file = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+	if (file < 0) {
+		throw SystemError("open "s + directory);
+	}
+	const int result = fsync(file);
+	close(file);
+	if (result < 0) {
+		throw SystemError("fsync "s + directory);
+	}
+}
+
+//запись с заголовком дописывается прямо в буфер журнала, без промежуточной строки
+void AppendRecord(std::string& out, uint64_t sequence, const WalRecord& record) {
+	const size_t header = out.size();
+	out.append(WAL_RECORD_HEADER_SIZE, '\0');
+	AppendBinary(out, sequence);
+	AppendBinary(out, record.type);
+	AppendBinary(out, record.document_id);
+	AppendBinary(out, record.status);
+	AppendBinaryVector(out, record.ratings);
+	AppendBinaryString(out, record.text);
+	const size_t payload_size = out.size() - header - WAL_RECORD_HEADER_SIZE;
+	const uint32_t size = static_cast<uint32_t>(payload_size);
+	const uint32_t checksum = ComputeCrc32(std::string_view{ out }.substr(header + WAL_RECORD_HEADER_SIZE, payload_size));
+	std::memcpy(&out[header], &size, sizeof(size));
+	std::memcpy(&out[header + sizeof(size)], &checksum, sizeof(checksum));
+}
+
+WalRecord DecodeRecord(std::string_view payload) {
+	BinaryReader reader(payload);
+	WalRecord record;
+	record.sequence = reader.Read<uint64_t>();
+	record.type = reader.Read<WalRecordType>();
+	record.document_id = reader.Read<int>();
+	record.status = reader.Read<DocumentStatus>();
+	record.ratings = reader.ReadVector<int>();
+	record.text = reader.ReadString();
+	if (!reader.AtEnd()) {
+		throw std::runtime_error("trailing bytes in log record"s);
+	}
+	return record;
+}
+
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string& path, const WriteAheadLogOptions& options)
+	: path_(path)
+	, options_(options)
+	, last_sync_(std::chrono::steady_clock::now()) {
+	if (options_.sync_every_records == 0) {
+		throw std::invalid_argument("sync_every_records must be positive"s);
+	}
+	file_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (file_ < 0) {
+		throw SystemError("open "s + path);
+	}
+	try {
+		replay_data_ = ReadAll(file_, path_);
+		//новый журнал или падение до конца записи заголовка
+		if (replay_data_.size() < WAL_MAGIC.size() && WAL_MAGIC.substr(0, replay_data_.size()) == replay_data_) {
+			replay_data_.clear();
+			if (ftruncate(file_, 0) < 0 || lseek(file_, 0, SEEK_SET) < 0) {
+				throw SystemError("ftruncate "s + path_);
+			}
+			WriteAll(file_, WAL_MAGIC, path_);
+			Sync();
+			SyncDirectory(path_);
+			return;
+		}
+		if (replay_data_.compare(0, WAL_MAGIC.size(), WAL_MAGIC) != 0) {
+			throw std::runtime_error("not a write-ahead log: "s + path_);
+		}
+		//целые записи идут подряд; первая неполная или с неверной суммой - начало хвоста,
+		//недописанного при падении
+		size_t position = WAL_MAGIC.size();
+		while (replay_data_.size() - position >= WAL_RECORD_HEADER_SIZE) {
+			BinaryReader header(std::string_view{ replay_data_ }.substr(position, WAL_RECORD_HEADER_SIZE));
+			const uint32_t size = header.Read<uint32_t>();
+			const uint32_t checksum = header.Read<uint32_t>();
+			if (size > replay_data_.size() - position - WAL_RECORD_HEADER_SIZE) {
+				break;
+			}
+			const std::string_view payload = std::string_view{ replay_data_ }.substr(position + WAL_RECORD_HEADER_SIZE, size);
+			if (ComputeCrc32(payload) != checksum) {
+				break;
+			}
+			last_sequence_ = DecodeRecord(payload).sequence;
+			position += WAL_RECORD_HEADER_SIZE + size;
+		}
+		discarded_bytes_ = replay_data_.size() - position;
+		replay_data_.resize(position);
+		if (discarded_bytes_ > 0) {
+			if (ftruncate(file_, position) < 0) {
+				throw SystemError("ftruncate "s + path_);
+			}
+			Sync();
+		}
+		if (lseek(file_, 0, SEEK_END) < 0) {
+			throw SystemError("lseek "s + path_);
+		}
+	} catch (...) {
+		close(file_);
+		throw;
+	}
+}
+
+WriteAheadLog::~WriteAheadLog() {
+	try {
+		Sync();
+	} catch (const std::runtime_error&) {
+	}
+	close(file_);
+}
+
+size_t WriteAheadLog::Replay(const std::function<void(const WalRecord&)>& apply) {
+	size_t count = 0;
+	std::string_view data{ replay_data_ };
+	data.remove_prefix(std::min(data.size(), WAL_MAGIC.size()));
+	while (!data.empty()) {
+		BinaryReader header(data.substr(0, WAL_RECORD_HEADER_SIZE));
+		const uint32_t size = header.Read<uint32_t>();
+		apply(DecodeRecord(data.substr(WAL_RECORD_HEADER_SIZE, size)));
+		data.remove_prefix(WAL_RECORD_HEADER_SIZE + size);
+		++count;
+	}
+	replay_data_.clear();
+	replay_data_.shrink_to_fit();
+	return count;
+}
+
+uint64_t WriteAheadLog::Append(const WalRecord& record) {
+	const size_t buffer_size = buffer_.size();
+	AppendRecord(buffer_, ++last_sequence_, record);
+	const size_t record_size = buffer_.size() - buffer_size;
+	++pending_records_;
+	try {
+		if (pending_records_ >= options_.sync_every_records
+			|| std::chrono::steady_clock::now() - last_sync_ >= options_.sync_interval) {
+			Sync();
+		} else if (buffer_.size() >= WAL_BUFFER_LIMIT) {
+			WriteBuffer();
+		}
+	} catch (...) {
+		//запись убирается из буфера, а если группа уже в файле (ошибка fdatasync) - с конца файла
+		if (buffer_.size() > buffer_size) {
+			buffer_.resize(buffer_size);
+		} else {
+			const off_t end = lseek(file_, 0, SEEK_CUR);
+			if (end >= 0) {
+				ShrinkFile(file_, end - static_cast<off_t>(record_size));
+			}
+		}
+		--last_sequence_;
+		--pending_records_;
+		throw;
+	}
+	return last_sequence_;
+}
+
+void WriteAheadLog::Sync() {
+	WriteBuffer();
+	if (options_.fsync && fdatasync(file_) < 0) {
+		throw SystemError("fdatasync "s + path_);
+	}
+	pending_records_ = 0;
+	last_sync_ = std::chrono::steady_clock::now();
+}
+
+void WriteAheadLog::Truncate() {
+	buffer_.clear();
+	pending_records_ = 0;
+	if (ftruncate(file_, WAL_MAGIC.size()) < 0) {
+		throw SystemError("ftruncate "s + path_);
+	}
+	if (lseek(file_, 0, SEEK_END) < 0) {
+		throw SystemError("lseek "s + path_);
+	}
+	Sync();
+}
+
+uint64_t WriteAheadLog::GetLastSequence() const {
+	return last_sequence_;
+}
+
+void WriteAheadLog::AdvanceSequence(uint64_t sequence) {
+	last_sequence_ = std::max(last_sequence_, sequence);
+}
+
+size_t WriteAheadLog::GetDiscardedBytes() const {
+	return discarded_bytes_;
+}
+
+void WriteAheadLog::WriteBuffer() {
+	if (!buffer_.empty()) {
+		//недописанная группа отрезается, чтобы при повторе не оказаться в середине журнала
+		const off_t size = lseek(file_, 0, SEEK_CUR);
+		try {
+			WriteAll(file_, buffer_, path_);
+		} catch (...) {
+			if (size >= 0) {
+				ShrinkFile(file_, size);
+			}
+			throw;
+		}
+		buffer_.clear();
+	}
+}
+
+void WriteFileDurably(const std::string& path, std::string_view data) {
+	const std::string temporary_path = path + ".tmp"s;
+	const int file = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (file < 0) {
+		throw SystemError("open "s + temporary_path);
+	}
+	try {
+		WriteAll(file, data, temporary_path);
+		if (fsync(file) < 0) {
+			throw SystemError("fsync "s + temporary_path);
+		}
+	} catch (...) {
+		close(file);
+		unlink(temporary_path.c_str());
+		throw;
+	}
+	close(file);
+	if (rename(temporary_path.c_str(), path.c_str()) < 0) {
+		throw SystemError("rename "s + temporary_path);
+	}
+	SyncDirectory(path);
+}
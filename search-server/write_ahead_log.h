@@ -0,0 +1,90 @@
+#pragma once
+
+#include "document.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Изменение индекса в журнале
+enum class WalRecordType : uint8_t { ADD_DOCUMENT = 1, REMOVE_DOCUMENT, SET_STOP_WORDS, REMOVE_STOP_WORDS };
+
+//Запись журнала; text - текст документа или стоп-слова. При чтении журнала text ссылается
+//на буфер чтения и действителен только внутри обработчика записи
+struct WalRecord {
+	uint64_t sequence = 0;
+	WalRecordType type = WalRecordType::ADD_DOCUMENT;
+	int document_id = 0;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	std::vector<int> ratings;
+	std::string_view text;
+};
+
+//Групповая запись журнала: записи копятся в буфере и сбрасываются в файл с fsync одной группой
+struct WriteAheadLogOptions {
+	//записей в группе; 1 - fsync на каждое изменение
+	size_t sync_every_records = 1024;
+	//группа сбрасывается не реже, чем раз в sync_interval (проверяется при добавлении записи)
+	std::chrono::milliseconds sync_interval{ 50 };
+	//false - группа только пишется в файл без fsync: переживает падение процесса, но не ОС
+	bool fsync = true;
+};
+
+//Журнал изменений (write-ahead log): файл только для дописывания из записей
+//[длина][CRC-32][номер, тип, поля]. Изменение, попавшее в сброшенную группу, переживает падение;
+//при открытии недописанный или поврежденный хвост отрезается. Номера записей растут и не сбрасываются
+//при очистке журнала, поэтому по номеру из снимка видно, какие записи в нем уже учтены
+class WriteAheadLog {
+public:
+	//открывает или создает журнал; std::runtime_error при ошибке ввода-вывода или чужом файле
+	explicit WriteAheadLog(const std::string& path, const WriteAheadLogOptions& options = {});
+
+	WriteAheadLog(const WriteAheadLog&) = delete;
+	WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+	//сбрасывает буфер; ошибки при закрытии не сообщаются, для надежной записи есть Sync
+	~WriteAheadLog();
+
+	//Все целые записи журнала по порядку; возвращает их число. Вызывается до первой Append
+	size_t Replay(const std::function<void(const WalRecord&)>& apply);
+
+	//добавляет запись с очередным номером (поле sequence не читается) и возвращает номер;
+	//при ошибке ввода-вывода (std::runtime_error) запись в журнал не попадает и номер не расходуется
+	uint64_t Append(const WalRecord& record);
+
+	//запись буфера в файл и fsync
+	void Sync();
+
+	//очистка журнала (после сохранения снимка); номера записей продолжаются
+	void Truncate();
+
+	uint64_t GetLastSequence() const;
+
+	//номера новых записей будут больше sequence (номер последнего изменения в снимке)
+	void AdvanceSequence(uint64_t sequence);
+
+	//байты поврежденного хвоста, отрезанные при открытии
+	size_t GetDiscardedBytes() const;
+
+private:
+	std::string path_;
+	WriteAheadLogOptions options_;
+	int file_ = -1;
+	std::string buffer_;
+	size_t pending_records_ = 0;
+	std::chrono::steady_clock::time_point last_sync_;
+	uint64_t last_sequence_ = 0;
+	size_t discarded_bytes_ = 0;
+	//содержимое журнала, прочитанное при открытии, до Replay
+	std::string replay_data_;
+
+	void WriteBuffer();
+};
+
+//Запись файла целиком через временный файл, fsync и rename: после падения на месте path
+//остается либо старый, либо новый файл. std::runtime_error при ошибке ввода-вывода
+void WriteFileDurably(const std::string& path, std::string_view data);